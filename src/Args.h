@@ -136,6 +136,9 @@ struct DSiArgs final : public NDSArgs
     std::optional<FATStorage> DSiSDCard;
 
     bool DSPHLE = false;
+
+    /// Whether to run the Teakra DSP core on its own thread.
+    bool DSPThreaded = false;
 };
 }
 #endif //MELONDS_ARGS_H
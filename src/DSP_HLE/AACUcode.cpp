@@ -39,6 +39,16 @@ AACUcode::AACUcode(melonDS::DSi& dsi, int version) : UcodeBase(dsi)
     if (!Decoder)
         Log(LogLevel::Error, "DSP_HLE: failed to initialize AAC decoder\n");
 
+    DecodeBusy = false;
+    DecodePending = false;
+    DecodeResult = false;
+    DecodeLength = 0;
+
+    SemDecodeStart = Platform::Semaphore_Create();
+    SemDecodeDone = Platform::Semaphore_Create();
+    DecodeThreadRunning = true;
+    DecodeThread = Platform::Thread_Create([this]() { DecodeThreadFunc(); });
+
     if (version == -1)
         Log(LogLevel::Info, "DSP_HLE: initializing AAC decoder ucode (DSi sound app)\n");
     else
@@ -47,6 +57,16 @@ AACUcode::AACUcode(melonDS::DSi& dsi, int version) : UcodeBase(dsi)
 
 AACUcode::~AACUcode()
 {
+    WaitForDecode();
+
+    DecodeThreadRunning = false;
+    Platform::Semaphore_Post(SemDecodeStart);
+    Platform::Thread_Wait(DecodeThread);
+    Platform::Thread_Free(DecodeThread);
+
+    Platform::Semaphore_Free(SemDecodeStart);
+    Platform::Semaphore_Free(SemDecodeDone);
+
     if (Decoder)
         Platform::AAC_DeInit(Decoder);
 
@@ -58,6 +78,11 @@ void AACUcode::Reset()
 {
     UcodeBase::Reset();
 
+    WaitForDecode();
+    DecodePending = false;
+    DecodeResult = false;
+    DecodeLength = 0;
+
     CmdState = 0;
     CmdIndex = 0;
     CmdParamCount = 0;
@@ -79,6 +104,20 @@ void AACUcode::DoSavestate(Savestate *file)
     file->Var8(&CmdParamCount);
     file->VarArray(CmdParams, sizeof(CmdParams));
 
+    // a frame that was decoded but not written out yet is part of the state
+    WaitForDecode();
+    if (file->IsAtLeastVersion(14, 1))
+    {
+        file->Bool32(&DecodePending);
+        file->Bool32(&DecodeResult);
+        file->VarArray(OutputBuf, sizeof(OutputBuf));
+    }
+    else
+    {
+        // older states had the output written as soon as the command started
+        DecodePending = false;
+    }
+
     if (!file->Saving)
     {
         LastFrequency = -1;
@@ -87,6 +126,28 @@ void AACUcode::DoSavestate(Savestate *file)
 }
 
 
+void AACUcode::DecodeThreadFunc()
+{
+    for (;;)
+    {
+        Platform::Semaphore_Wait(SemDecodeStart);
+        if (!DecodeThreadRunning) break;
+
+        DecodeResult = Platform::AAC_DecodeFrame(Decoder, InputBuf, DecodeLength, OutputBuf, sizeof(OutputBuf));
+
+        Platform::Semaphore_Post(SemDecodeDone);
+    }
+}
+
+void AACUcode::WaitForDecode()
+{
+    if (!DecodeBusy) return;
+
+    Platform::Semaphore_Wait(SemDecodeDone);
+    DecodeBusy = false;
+}
+
+
 void AACUcode::SendData(u8 index, u16 val)
 {
     UcodeBase::SendData(index, val);
@@ -214,16 +275,21 @@ void AACUcode::CmdDecodeFrame()
     }
 
     // decode the frame
+    // the decoder thread is guaranteed to be idle here, as only one command runs at a time
 
-    if (!Platform::AAC_DecodeFrame(Decoder, InputBuf, framelen, OutputBuf, 1024*2*sizeof(s16)))
-    {
-        Log(LogLevel::Warn, "DSP_HLE: AAC decoding failed, frame addr=%08X len=%d\n", frameaddr, framelen);
+    DecodeLength = framelen;
+    DecodePending = true;
+    DecodeBusy = true;
+    Platform::Semaphore_Post(SemDecodeStart);
 
-        LastFrequency = -1;
-        LastChannels = -1;
-        DSi.ScheduleEvent(Event_DSi_DSPHLE, false, 512, 0, 2);
-        return;
-    }
+    DSi.ScheduleEvent(Event_DSi_DSPHLE, false, (chan==1) ? 60000 : 115000, 0, 0);
+}
+
+void AACUcode::WriteDecodedFrame()
+{
+    u16 chan = CmdParams[3];
+    u32 leftaddr = (CmdParams[6] << 16) | CmdParams[7];
+    u32 rightaddr = (CmdParams[8] << 16) | CmdParams[9];
 
     s16* dataout = OutputBuf;
     if (chan == 1)
@@ -245,12 +311,31 @@ void AACUcode::CmdDecodeFrame()
             rightaddr += 2;
         }
     }
-
-    DSi.ScheduleEvent(Event_DSi_DSPHLE, false, (chan==1) ? 60000 : 115000, 0, 0);
 }
 
 void AACUcode::FinishCmd(u32 param)
 {
+    if (DecodePending)
+    {
+        // blocks if the decoder thread isn't done yet
+        WaitForDecode();
+        DecodePending = false;
+
+        if (DecodeResult)
+        {
+            WriteDecodedFrame();
+        }
+        else
+        {
+            u32 frameaddr = (CmdParams[4] << 16) | CmdParams[5];
+            Log(LogLevel::Warn, "DSP_HLE: AAC decoding failed, frame addr=%08X len=%d\n", frameaddr, CmdParams[0]);
+
+            LastFrequency = -1;
+            LastChannels = -1;
+            param = 2;
+        }
+    }
+
     CmdState = 0;
     CmdParamCount = 0;
 
@@ -50,8 +50,23 @@ protected:
     int LastFrequency;
     int LastChannels;
 
+    // frames are decoded on a separate thread while the command runs
+    // the result is written out when the command ends
+    Platform::Thread* DecodeThread;
+    Platform::Semaphore* SemDecodeStart;
+    Platform::Semaphore* SemDecodeDone;
+    bool DecodeThreadRunning;
+    bool DecodeBusy;
+    bool DecodePending;
+    bool DecodeResult;
+    u16 DecodeLength;
+
+    void DecodeThreadFunc();
+    void WaitForDecode();
+
     void RecvCmdWord();
     void CmdDecodeFrame();
+    void WriteDecodedFrame();
     void FinishCmd(u32 param);
 };
 
@@ -17,6 +17,11 @@
 */
 
 #include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "../DSi.h"
 #include "GraphicsUcode.h"
@@ -205,6 +210,266 @@ void GraphicsUcode::FinishCmd(u32 param)
 }
 
 
+// pixel kernels for the scaling and conversion commands
+// the SSE2 versions give the exact same results as the plain ones
+
+#if defined(__SSE2__)
+
+static inline __m128i MulLo32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+static inline s32 HorizontalSum(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+// top and bottom are (left, right) pixel pairs, with the matching (fx1, fx0) weights in fx
+static inline __m128i BilinearChannel(__m128i top, __m128i bottom, __m128i fx, __m128i fy)
+{
+    __m128i mask = _mm_set1_epi16(0x1F);
+    __m128i t = _mm_madd_epi16(_mm_and_si128(top, mask), fx);
+    __m128i b = _mm_madd_epi16(_mm_and_si128(bottom, mask), fx);
+
+    // both horizontal sums fit in 16 bits, so they can be paired up for the vertical pass
+    return _mm_srli_epi32(_mm_madd_epi16(_mm_or_si128(t, _mm_slli_epi32(b, 16)), fy), 20);
+}
+
+#endif
+
+static void ScaleLineBilinear(const u16* line0, const u16* line1, u16* dst, u32 count,
+                              u32 sx, u32 sx_incr, u32 fy0)
+{
+    u32 fy1 = 0x400 - fy0;
+    u32 dx = 0;
+
+#if defined(__SSE2__)
+    __m128i fy = _mm_set1_epi32(fy1 | (fy0 << 16));
+
+    for (; (dx + 4) <= count; dx += 4)
+    {
+        alignas(16) u32 top[4], bottom[4], fx[4];
+        for (int i = 0; i < 4; i++)
+        {
+            u32 x = sx >> 10;
+            u32 fx0 = sx & 0x3FF;
+            top[i] = line0[x] | (line0[x + 1] << 16);
+            bottom[i] = line1[x] | (line1[x + 1] << 16);
+            fx[i] = (0x400 - fx0) | (fx0 << 16);
+            sx += sx_incr;
+        }
+
+        __m128i vtop = _mm_load_si128((const __m128i*)top);
+        __m128i vbottom = _mm_load_si128((const __m128i*)bottom);
+        __m128i vfx = _mm_load_si128((const __m128i*)fx);
+
+        __m128i r = BilinearChannel(vtop, vbottom, vfx, fy);
+        __m128i g = BilinearChannel(_mm_srli_epi16(vtop, 5), _mm_srli_epi16(vbottom, 5), vfx, fy);
+        __m128i b = BilinearChannel(_mm_srli_epi16(vtop, 10), _mm_srli_epi16(vbottom, 10), vfx, fy);
+
+        __m128i col = _mm_or_si128(r, _mm_or_si128(_mm_slli_epi32(g, 5), _mm_slli_epi32(b, 10)));
+        col = _mm_or_si128(_mm_packs_epi32(col, col), _mm_set1_epi16((s16)0x8000));
+        _mm_storel_epi64((__m128i*)&dst[dx], col);
+    }
+#endif
+
+    for (; dx < count; dx++)
+    {
+        u16 val[4];
+        val[0] = line0[sx >> 10];
+        val[1] = line0[(sx >> 10) + 1];
+        val[2] = line1[sx >> 10];
+        val[3] = line1[(sx >> 10) + 1];
+
+        u32 fx0 = sx & 0x3FF;
+        u32 fx1 = 0x400 - fx0;
+
+        u32 vr[4], vg[4], vb[4];
+        u32 fr, fg, fb;
+
+        for (int i = 0; i < 4; i++)
+        {
+            vr[i] = val[i] & 0x1F;
+            vg[i] = (val[i] >> 5) & 0x1F;
+            vb[i] = (val[i] >> 10) & 0x1F;
+        }
+
+        fr = ((((vr[0] * fx1) + (vr[1] * fx0)) * fy1) +
+              (((vr[2] * fx1) + (vr[3] * fx0)) * fy0)) >> 20;
+        fg = ((((vg[0] * fx1) + (vg[1] * fx0)) * fy1) +
+              (((vg[2] * fx1) + (vg[3] * fx0)) * fy0)) >> 20;
+        fb = ((((vb[0] * fx1) + (vb[1] * fx0)) * fy1) +
+              (((vb[2] * fx1) + (vb[3] * fx0)) * fy0)) >> 20;
+
+        dst[dx] = 0x8000 | (fr & 0x1F) | ((fg & 0x1F) << 5) | ((fb & 0x1F) << 10);
+
+        sx += sx_incr;
+    }
+}
+
+// src points to the top left of the 4x4 source block, lines are stride pixels apart
+// wx and wy are the horizontal and vertical weights, already shifted right by 1
+// the sums fit in 32 bits: the absolute weights of a block add up to at most 2.25 * (1<<24)
+static u16 BicubicPixel(const u16* src, u32 stride, const s32* wx, const s32* wy)
+{
+    s32 tr, tg, tb;
+
+#if defined(__SSE2__)
+    // the 25-bit weights are split in a signed high part and a 15-bit low part,
+    // so the products with the 5-bit color values can be done with 16-bit multiply-adds
+    __m128i vwx = _mm_loadu_si128((const __m128i*)wx);
+    __m128i lomask = _mm_set1_epi32(0x7FFF);
+    __m128i mask = _mm_set1_epi16(0x1F);
+    __m128i ar = _mm_setzero_si128();
+    __m128i ag = _mm_setzero_si128();
+    __m128i ab = _mm_setzero_si128();
+
+    for (int i = 0; i < 4; i += 2)
+    {
+        __m128i w0 = _mm_srai_epi32(MulLo32(vwx, _mm_set1_epi32(wy[i])), 6);
+        __m128i w1 = _mm_srai_epi32(MulLo32(vwx, _mm_set1_epi32(wy[i+1])), 6);
+        __m128i wlo = _mm_packs_epi32(_mm_and_si128(w0, lomask), _mm_and_si128(w1, lomask));
+        __m128i whi = _mm_packs_epi32(_mm_srai_epi32(w0, 15), _mm_srai_epi32(w1, 15));
+
+        __m128i val = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)&src[stride * i]),
+                                         _mm_loadl_epi64((const __m128i*)&src[stride * (i+1)]));
+        __m128i vr = _mm_and_si128(val, mask);
+        __m128i vg = _mm_and_si128(_mm_srli_epi16(val, 5), mask);
+        __m128i vb = _mm_and_si128(_mm_srli_epi16(val, 10), mask);
+
+        ar = _mm_add_epi32(ar, _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(vr, whi), 15), _mm_madd_epi16(vr, wlo)));
+        ag = _mm_add_epi32(ag, _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(vg, whi), 15), _mm_madd_epi16(vg, wlo)));
+        ab = _mm_add_epi32(ab, _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(vb, whi), 15), _mm_madd_epi16(vb, wlo)));
+    }
+
+    tr = HorizontalSum(ar);
+    tg = HorizontalSum(ag);
+    tb = HorizontalSum(ab);
+#else
+    tr = 0; tg = 0; tb = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            u16 val = src[(stride * i) + j];
+
+            s32 vr = val & 0x1F;
+            s32 vg = (val >> 5) & 0x1F;
+            s32 vb = (val >> 10) & 0x1F;
+
+            s32 weight = (wx[j] * wy[i]) >> 6;
+
+            tr += (vr * weight);
+            tg += (vg * weight);
+            tb += (vb * weight);
+        }
+    }
+#endif
+
+    // round and clamp final colors
+    s32 fr = (tr + 0x800000) >> 24;
+    s32 fg = (tg + 0x800000) >> 24;
+    s32 fb = (tb + 0x800000) >> 24;
+
+    fr = std::clamp(fr, 0, 31);
+    fg = std::clamp(fg, 0, 31);
+    fb = std::clamp(fb, 0, 31);
+
+    return 0x8000 | fr | (fg << 5) | (fb << 10);
+}
+
+// each source word holds two pixels (Y1 U Y2 V), each output word the two matching RGB555 pixels
+static void YuvToRgbBlock(const u32* src, u32* dst, u32 count)
+{
+    u32 i = 0;
+
+#if defined(__SSE2__)
+    __m128i bytemask = _mm_set1_epi32(0xFF);
+    __m128i bias = _mm_set1_epi32(128);
+
+    // the chroma terms are computed as pairs of 16-bit products, U in the low half and V in the high half
+    __m128i kr = _mm_set1_epi32(359 << 16);
+    __m128i kg = _mm_set1_epi32((u16)-352 | ((u32)(u16)-731 << 16));
+    __m128i kb = _mm_set1_epi32(1815);
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi16(255);
+
+    for (; (i + 4) <= count; i += 4)
+    {
+        __m128i val = _mm_loadu_si128((const __m128i*)&src[i]);
+
+        __m128i y1 = _mm_and_si128(val, bytemask);
+        __m128i y2 = _mm_and_si128(_mm_srli_epi32(val, 16), bytemask);
+        __m128i u = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(val, 8), bytemask), bias);
+        __m128i v = _mm_sub_epi32(_mm_srli_epi32(val, 24), bias);
+        __m128i uv = _mm_or_si128(_mm_and_si128(u, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(v, 16));
+
+        __m128i r = _mm_srai_epi32(_mm_madd_epi16(uv, kr), 8);
+        __m128i g = _mm_srai_epi32(_mm_madd_epi16(uv, kg), 10);
+        __m128i b = _mm_srai_epi32(_mm_madd_epi16(uv, kb), 10);
+
+        // first pixels in the low half, second pixels in the high half
+        __m128i r12 = _mm_packs_epi32(_mm_add_epi32(y1, r), _mm_add_epi32(y2, r));
+        __m128i g12 = _mm_packs_epi32(_mm_add_epi32(y1, g), _mm_add_epi32(y2, g));
+        __m128i b12 = _mm_packs_epi32(_mm_add_epi32(y1, b), _mm_add_epi32(y2, b));
+
+        r12 = _mm_srli_epi16(_mm_min_epi16(_mm_max_epi16(r12, zero), max), 3);
+        g12 = _mm_srli_epi16(_mm_min_epi16(_mm_max_epi16(g12, zero), max), 3);
+        b12 = _mm_srli_epi16(_mm_min_epi16(_mm_max_epi16(b12, zero), max), 3);
+
+        __m128i col = _mm_or_si128(r12, _mm_or_si128(_mm_slli_epi16(g12, 5), _mm_slli_epi16(b12, 10)));
+        col = _mm_or_si128(col, _mm_set1_epi16((s16)0x8000));
+        col = _mm_unpacklo_epi16(col, _mm_unpackhi_epi64(col, col));
+        _mm_storeu_si128((__m128i*)&dst[i], col);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        u32 val = src[i];
+
+        s32 y1 = val & 0xFF;
+        s32 u = (val >> 8) & 0xFF;
+        s32 y2 = (val >> 16) & 0xFF;
+        s32 v = (val >> 24) & 0xFF;
+
+        u -= 128;
+        v -= 128;
+
+        // the ucode uses a bitshift based conversion
+        // the formulas below are an equivalent
+
+        s32 r = (v * 359) >> 8;
+        s32 g = -((u * 352) + (v * 731)) >> 10;
+        s32 b = (u * 1815) >> 10;
+
+        s32 r1 = y1 + r;
+        s32 g1 = y1 + g;
+        s32 b1 = y1 + b;
+
+        s32 r2 = y2 + r;
+        s32 g2 = y2 + g;
+        s32 b2 = y2 + b;
+
+        r1 = std::clamp(r1, 0, 255); g1 = std::clamp(g1, 0, 255); b1 = std::clamp(b1, 0, 255);
+        r2 = std::clamp(r2, 0, 255); g2 = std::clamp(g2, 0, 255); b2 = std::clamp(b2, 0, 255);
+
+        u32 col1 = (r1 >> 3) | ((g1 >> 3) << 5) | ((b1 >> 3) << 10) | 0x8000;
+        u32 col2 = (r2 >> 3) | ((g2 >> 3) << 5) | ((b2 >> 3) << 10) | 0x8000;
+
+        dst[i] = col1 | (col2 << 16);
+    }
+}
+
+
 void GraphicsUcode::CmdScalingNearest()
 {
     u32 src_addr = (CmdParams[1] << 16) | CmdParams[0];
@@ -298,7 +563,7 @@ void GraphicsUcode::CmdScalingBilinear()
 
     u32 sx_incr = ((rect_width - 2) << 10) / (dst_width - 1);
     u32 sy_incr = ((rect_height - 2) << 10) / (dst_height - 1);
-    u32 sx, sy;
+    u32 sy;
 
     src_addr += (((rect_yoffset * src_width) + rect_xoffset) << 1);
     sy = 0x200;
@@ -313,42 +578,7 @@ void GraphicsUcode::CmdScalingBilinear()
 
     for (u32 dy = 0; dy < dst_height; dy++)
     {
-        sx = 0x200;
-
-        for (u32 dx = 0; dx < dst_width; dx++)
-        {
-            u16 val[4];
-            val[0] = src_mem[sx >> 10];
-            val[1] = src_mem[(sx >> 10) + 1];
-            val[2] = src_mem[rect_width + (sx >> 10)];
-            val[3] = src_mem[rect_width + (sx >> 10) + 1];
-
-            u32 fx0 = sx & 0x3FF;
-            u32 fx1 = 0x400 - fx0;
-            u32 fy0 = sy & 0x3FF;
-            u32 fy1 = 0x400 - fy0;
-
-            u32 vr[4], vg[4], vb[4];
-            u32 fr, fg, fb;
-
-            for (int i = 0; i < 4; i++)
-            {
-                vr[i] = val[i] & 0x1F;
-                vg[i] = (val[i] >> 5) & 0x1F;
-                vb[i] = (val[i] >> 10) & 0x1F;
-            }
-
-            fr = ((((vr[0] * fx1) + (vr[1] * fx0)) * fy1) +
-                  (((vr[2] * fx1) + (vr[3] * fx0)) * fy0)) >> 20;
-            fg = ((((vg[0] * fx1) + (vg[1] * fx0)) * fy1) +
-                  (((vg[2] * fx1) + (vg[3] * fx0)) * fy0)) >> 20;
-            fb = ((((vb[0] * fx1) + (vb[1] * fx0)) * fy1) +
-                  (((vb[2] * fx1) + (vb[3] * fx0)) * fy0)) >> 20;
-
-            dst_mem[dx] = 0x8000 | (fr & 0x1F) | ((fg & 0x1F) << 5) | ((fb & 0x1F) << 10);
-
-            sx += sx_incr;
-        }
+        ScaleLineBilinear(src_mem, &src_mem[rect_width], dst_mem, dst_width, 0x200, sx_incr, sy & 0x3FF);
 
         // store scaled line
         WriteARM9Mem(dst_mem, dst_addr, dst_width << 1);
@@ -428,6 +658,23 @@ void GraphicsUcode::CmdScalingBicubic()
     u32 sy_incr = ((rect_height - 4) << 10) / (dst_height - 1);
     u32 sx, sy;
 
+    // the horizontal positions and weights are the same for every line
+    std::vector<u32> col_x(dst_width);
+    std::vector<s32> col_wx(dst_width * 4);
+    sx = 0x200;
+    for (u32 dx = 0; dx < dst_width; dx++)
+    {
+        u32 fx = sx & 0x3FF;
+
+        col_x[dx] = sx >> 10;
+        col_wx[dx*4 + 0] = CalcBicubicWeight(0x400 + fx) >> 1;
+        col_wx[dx*4 + 1] = CalcBicubicWeight(fx) >> 1;
+        col_wx[dx*4 + 2] = CalcBicubicWeight(0x400 - fx) >> 1;
+        col_wx[dx*4 + 3] = CalcBicubicWeight(0x800 - fx) >> 1;
+
+        sx += sx_incr;
+    }
+
     src_addr += (((rect_yoffset * src_width) + rect_xoffset) << 1);
     sy = 0x200;
 
@@ -441,56 +688,16 @@ void GraphicsUcode::CmdScalingBicubic()
 
     for (u32 dy = 0; dy < dst_height; dy++)
     {
-        sx = 0x200;
-
-        for (u32 dx = 0; dx < dst_width; dx++)
-        {
-            u32 fx = sx & 0x3FF;
-            u32 fy = sy & 0x3FF;
-
-            s32 wx[4], wy[4];
-            wx[0] = CalcBicubicWeight(0x400 + fx);
-            wx[1] = CalcBicubicWeight(fx);
-            wx[2] = CalcBicubicWeight(0x400 - fx);
-            wx[3] = CalcBicubicWeight(0x800 - fx);
-            wy[0] = CalcBicubicWeight(0x400 + fy);
-            wy[1] = CalcBicubicWeight(fy);
-            wy[2] = CalcBicubicWeight(0x400 - fy);
-            wy[3] = CalcBicubicWeight(0x800 - fy);
-
-            s64 tr = 0, tg = 0, tb = 0;
-
-            for (int i = 0; i < 4; i++)
-            {
-                for (int j = 0; j < 4; j++)
-                {
-                    u16 val = src_mem[(rect_width * i) + (sx >> 10) + j];
-
-                    s32 vr = val & 0x1F;
-                    s32 vg = (val >> 5) & 0x1F;
-                    s32 vb = (val >> 10) & 0x1F;
-
-                    s32 weight = ((wx[j] >> 1) * (wy[i] >> 1)) >> 6;
-
-                    tr += (vr * weight);
-                    tg += (vg * weight);
-                    tb += (vb * weight);
-                }
-            }
+        u32 fy = sy & 0x3FF;
 
-            // round and clamp final colors
-            s32 fr = (s32)((tr + 0x800000L) >> 24);
-            s32 fg = (s32)((tg + 0x800000L) >> 24);
-            s32 fb = (s32)((tb + 0x800000L) >> 24);
+        s32 wy[4];
+        wy[0] = CalcBicubicWeight(0x400 + fy) >> 1;
+        wy[1] = CalcBicubicWeight(fy) >> 1;
+        wy[2] = CalcBicubicWeight(0x400 - fy) >> 1;
+        wy[3] = CalcBicubicWeight(0x800 - fy) >> 1;
 
-            fr = std::clamp(fr, 0, 31);
-            fg = std::clamp(fg, 0, 31);
-            fb = std::clamp(fb, 0, 31);
-
-            dst_mem[dx] = 0x8000 | (fr & 0x1F) | ((fg & 0x1F) << 5) | ((fb & 0x1F) << 10);
-
-            sx += sx_incr;
-        }
+        for (u32 dx = 0; dx < dst_width; dx++)
+            dst_mem[dx] = BicubicPixel(&src_mem[col_x[dx]], rect_width, &col_wx[dx * 4], wy);
 
         // store scaled line
         WriteARM9Mem(dst_mem, dst_addr, dst_width << 1);
@@ -587,45 +794,31 @@ void GraphicsUcode::CmdYuvToRgb()
     u32 src_addr = (CmdParams[3] << 16) | CmdParams[2];
     u32 dst_addr = (CmdParams[5] << 16) | CmdParams[4];
 
-    for (u32 i = 0; i < len; i += 4)
-    {
-        u32 val = DSi.ARM9Read32(src_addr);
-        src_addr += 4;
-
-        s32 y1 = val & 0xFF;
-        s32 u = (val >> 8) & 0xFF;
-        s32 y2 = (val >> 16) & 0xFF;
-        s32 v = (val >> 24) & 0xFF;
+    // convert in chunks, the conversion itself doesn't depend on where the data comes from
+    u32 src[64], dst[64];
+    u32 count = (len + 3) >> 2;
 
-        u -= 128;
-        v -= 128;
-
-        // the ucode uses a bitshift based conversion
-        // the formulas below are an equivalent
-
-        s32 r = (v * 359) >> 8;
-        s32 g = -((u * 352) + (v * 731)) >> 10;
-        s32 b = (u * 1815) >> 10;
-
-        s32 r1 = y1 + r;
-        s32 g1 = y1 + g;
-        s32 b1 = y1 + b;
+    while (count)
+    {
+        u32 chunk = std::min(count, 64u);
 
-        s32 r2 = y2 + r;
-        s32 g2 = y2 + g;
-        s32 b2 = y2 + b;
+        for (u32 i = 0; i < chunk; i++)
+        {
+            src[i] = DSi.ARM9Read32(src_addr);
+            src_addr += 4;
+        }
 
-        r1 = std::clamp(r1, 0, 255); g1 = std::clamp(g1, 0, 255); b1 = std::clamp(b1, 0, 255);
-        r2 = std::clamp(r2, 0, 255); g2 = std::clamp(g2, 0, 255); b2 = std::clamp(b2, 0, 255);
+        YuvToRgbBlock(src, dst, chunk);
 
-        u32 col1 = (r1 >> 3) | ((g1 >> 3) << 5) | ((b1 >> 3) << 10) | 0x8000;
-        u32 col2 = (r2 >> 3) | ((g2 >> 3) << 5) | ((b2 >> 3) << 10) | 0x8000;
+        for (u32 i = 0; i < chunk; i++)
+        {
+            DSi.ARM9Write32(dst_addr, dst[i]);
+            dst_addr += 4;
+        }
 
-        DSi.ARM9Write32(dst_addr, col1 | (col2 << 16));
-        dst_addr += 4;
+        count -= chunk;
     }
 }
 
-
 }
 }
@@ -123,6 +123,7 @@ DSi::DSi(DSiArgs&& args, void* userdata) noexcept :
     NWRAM_C = JIT.Memory.GetNWRAM_C();
 
     SetDSPHLE(args.DSPHLE);
+    SetDSPThreaded(args.DSPThreaded);
 }
 
 DSi::~DSi() noexcept
@@ -155,6 +156,7 @@ void DSi::Reset()
     //ARM9.CP15Write(0x910, 0x0D00000A);
     //ARM9.CP15Write(0x911, 0x00000020);
     //ARM9.CP15Write(0x100, ARM9.CP15Read(0x100) | 0x00050000);
+    DSP.SyncThread();
     NDS::Reset();
 
     // The SOUNDBIAS register does nothing on DSi
@@ -240,6 +242,11 @@ void DSi::SetDSPHLE(bool hle)
     DSP.SetDSPHLE(hle);
 }
 
+void DSi::SetDSPThreaded(bool threaded)
+{
+    DSP.SetThreaded(threaded);
+}
+
 u32 DSi::GetSavestateConfig()
 {
     u32 ret = NDS::GetSavestateConfig();
@@ -254,6 +261,8 @@ void DSi::DoSavestateExtra(Savestate* file)
 {
     file->Section("DSIG");
 
+    DSP.SyncThread();
+
     file->VarArray(NWRAM_A, NWRAMSize);
     file->VarArray(NWRAM_B, NWRAMSize);
     file->VarArray(NWRAM_C, NWRAMSize);
@@ -1204,6 +1213,8 @@ void DSi::MapNWRAM_B(u32 num, u8 val)
     u8 oldval = (MBK[0][mbkn] >> mbks) & 0xFF;
     if (oldval == val) return;
 
+    // the DSP thread accesses NWRAM through these mappings
+    DSP.SyncThread();
     JIT.Memory.RemapNWRAM(1);
 
     MBK[0][mbkn] &= ~(0xFF << mbks);
@@ -1232,6 +1243,8 @@ void DSi::MapNWRAM_B(u32 num, u8 val)
             NWRAMMap_B[mVal & 0x03][(mVal >> 2) & 0x7] = ptr;
         }
     }
+
+    DSP.InvalidateProgramCache();
 }
 
 void DSi::MapNWRAM_C(u32 num, u8 val)
@@ -1251,6 +1264,8 @@ void DSi::MapNWRAM_C(u32 num, u8 val)
     u8 oldval = (MBK[0][mbkn] >> mbks) & 0xFF;
     if (oldval == val) return;
 
+    // the DSP thread accesses NWRAM through these mappings
+    DSP.SyncThread();
     JIT.Memory.RemapNWRAM(2);
 
     MBK[0][mbkn] &= ~(0xFF << mbks);
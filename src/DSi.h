@@ -190,6 +190,7 @@ public:
     u8 GPIO_WiFi;
 
     void SetDSPHLE(bool hle);
+    void SetDSPThreaded(bool threaded);
 
 private:
     bool FullBIOSBoot;
@@ -16,6 +16,9 @@
     with melonDS. If not, see http://www.gnu.org/licenses/.
 */
 
+#include <algorithm>
+#include <thread>
+
 #include "teakra/include/teakra/teakra.h"
 #include "DSP_HLE/AACUcode.h"
 #include "DSP_HLE/G711Ucode.h"
@@ -51,6 +54,7 @@ DSi_DSP::DSi_DSP(melonDS::DSi& dsi) : DSi(dsi)
 DSi_DSP::~DSi_DSP()
 {
     //if (PDATAWriteFifo) delete PDATAWriteFifo;
+    SetThreaded(false);
     StopDSP();
 
     //PDATAReadFifo = NULL;
@@ -61,6 +65,8 @@ DSi_DSP::~DSi_DSP()
 
 void DSi_DSP::Reset()
 {
+    SyncThread();
+
     DSPTimestamp = 0;
 
     DSP_PADR = 0;
@@ -75,6 +81,8 @@ void DSi_DSP::Reset()
 
     PDATAReadFifo.Clear();
     //PDATAWriteFifo->Clear();
+    SampleInput.Clear();
+    SampleOutput.Clear();
     if (DSPHLE)
         StopDSP();
     else if (DSPCore)
@@ -87,6 +95,18 @@ void DSi_DSP::DoSavestate(Savestate* file)
 {
     file->Section("DSPi");
 
+    SyncThread();
+    if (file->Saving)
+    {
+        // hand any pending I2S samples to the core, so they're part of its state
+        ProcessSamples(SampleInput, SampleOutput);
+    }
+    else
+    {
+        SampleInput.Clear();
+        SampleOutput.Clear();
+    }
+
     PDATAReadFifo.DoSavestate(file);
 
     file->Var64(&DSPTimestamp);
@@ -266,6 +286,8 @@ void DSi_DSP::StartDSPHLE()
 
 void DSi_DSP::StopDSP()
 {
+    SyncThread();
+
     if (DSPCore) delete DSPCore;
     DSPCore = nullptr;
 }
@@ -290,17 +312,19 @@ void DSi_DSP::StartDSPLLE()
 
     // these happen instantaneously and without too much regard for bus aribtration
     // rules, so, this might have to be changed later on
+    // when running on the DSP thread, these wait for the ARM side to sync up with the DSP
     Teakra::AHBMCallback cb;
-    cb.read8 = [this](auto addr) { return DSi.ARM9Read8(addr); };
-    cb.write8 = [this](auto addr, auto val) { DSi.ARM9Write8(addr, val); };
-    cb.read16 = [this](auto addr) { return DSi.ARM9Read16(addr); };
-    cb.write16 = [this](auto addr, auto val) { DSi.ARM9Write16(addr, val); };
-    cb.read32 = [this](auto addr) { return DSi.ARM9Read32(addr); };
-    cb.write32 = [this](auto addr, auto val) { DSi.ARM9Write32(addr, val); };
+    cb.read8 = [this](auto addr) { WaitForEmuParked(); return DSi.ARM9Read8(addr); };
+    cb.write8 = [this](auto addr, auto val) { WaitForEmuParked(); DSi.ARM9Write8(addr, val); };
+    cb.read16 = [this](auto addr) { WaitForEmuParked(); return DSi.ARM9Read16(addr); };
+    cb.write16 = [this](auto addr, auto val) { WaitForEmuParked(); DSi.ARM9Write16(addr, val); };
+    cb.read32 = [this](auto addr) { WaitForEmuParked(); return DSi.ARM9Read32(addr); };
+    cb.write32 = [this](auto addr, auto val) { WaitForEmuParked(); DSi.ARM9Write32(addr, val); };
     teakra->SetAHBMCallback(cb);
 
     teakra->SetMicEnableCallback([this](bool enable)
      {
+         WaitForEmuParked();
          if (enable)
              DSi.Mic.Start(Mic_DSi_DSP);
          else
@@ -309,23 +333,32 @@ void DSi_DSP::StartDSPLLE()
 }
 
 
+void DSi_DSP::RaiseIRQ()
+{
+    // IRQs raised from the DSP thread are delivered once the ARM side syncs up
+    if (ThreadActive)
+        ThreadIRQ = true;
+    else
+        DSi.SetIRQ(0, IRQ_DSi_DSP);
+}
+
 void DSi_DSP::IrqRep0()
 {
-    if (DSP_PCFG & (1<< 9)) DSi.SetIRQ(0, IRQ_DSi_DSP);
+    if (DSP_PCFG & (1<< 9)) RaiseIRQ();
 }
 void DSi_DSP::IrqRep1()
 {
-    if (DSP_PCFG & (1<<10)) DSi.SetIRQ(0, IRQ_DSi_DSP);
+    if (DSP_PCFG & (1<<10)) RaiseIRQ();
 }
 void DSi_DSP::IrqRep2()
 {
-    if (DSP_PCFG & (1<<11)) DSi.SetIRQ(0, IRQ_DSi_DSP);
+    if (DSP_PCFG & (1<<11)) RaiseIRQ();
 }
 void DSi_DSP::IrqSem()
 {
     DSP_PSTS |= 1<<9;
     // apparently these are always fired?
-    DSi.SetIRQ(0, IRQ_DSi_DSP);
+    RaiseIRQ();
 }
 
 u16 DSi_DSP::DSPRead16(u32 addr)
@@ -360,6 +393,29 @@ void DSi_DSP::DSPWrite16(u32 addr, u16 val)
 
 void DSi_DSP::SampleClock(s16 output[2], s16 input)
 {
+    if (Threaded)
+    {
+        if (SampleInput.IsFull()) SampleInput.Read();
+        SampleInput.Write(input);
+
+        // if the DSP thread is idle, the sample can be handled right away
+        if (!ThreadActive)
+            ProcessSamples(SampleInput, SampleOutput);
+
+        if (SampleOutput.IsEmpty())
+        {
+            output[0] = 0;
+            output[1] = 0;
+        }
+        else
+        {
+            u32 val = SampleOutput.Read();
+            output[0] = (s16)(val & 0xFFFF);
+            output[1] = (s16)(val >> 16);
+        }
+        return;
+    }
+
     if (DSPCore)
     {
         DSPCore->SampleClock(output, input);
@@ -371,6 +427,198 @@ void DSi_DSP::SampleClock(s16 output[2], s16 input)
     }
 }
 
+void DSi_DSP::ProcessSamples(FIFO<s16, 16>& input, FIFO<u32, 16>& output)
+{
+    while (!input.IsEmpty())
+    {
+        s16 in = input.Read();
+        s16 out[2] = {0, 0};
+
+        if (DSPCore)
+            DSPCore->SampleClock(out, in);
+
+        // keep the most recent samples if the output isn't consumed quickly enough
+        if (output.IsFull()) output.Read();
+        output.Write((u16)out[0] | ((u32)(u16)out[1] << 16));
+    }
+}
+
+
+void DSi_DSP::SetThreaded(bool threaded)
+{
+    if (threaded == Threaded) return;
+
+    if (threaded)
+    {
+        SemThreadStart = Platform::Semaphore_Create();
+        SemThreadWake = Platform::Semaphore_Create();
+        SemThreadDone = Platform::Semaphore_Create();
+        SemEmuParked = Platform::Semaphore_Create();
+
+        ThreadRunning = true;
+        DSPThread = Platform::Thread_Create([this]() { ThreadFunc(); });
+    }
+    else
+    {
+        SyncThread();
+
+        ThreadRunning = false;
+        Platform::Semaphore_Post(SemThreadStart);
+        Platform::Thread_Wait(DSPThread);
+        Platform::Thread_Free(DSPThread);
+        DSPThread = nullptr;
+
+        Platform::Semaphore_Free(SemThreadStart);
+        Platform::Semaphore_Free(SemThreadWake);
+        Platform::Semaphore_Free(SemThreadDone);
+        Platform::Semaphore_Free(SemEmuParked);
+        SemThreadStart = nullptr;
+        SemThreadWake = nullptr;
+        SemThreadDone = nullptr;
+        SemEmuParked = nullptr;
+
+        ProcessSamples(SampleInput, SampleOutput);
+    }
+
+    Threaded = threaded;
+}
+
+void DSi_DSP::ThreadFunc()
+{
+    for (;;)
+    {
+        Platform::Semaphore_Wait(SemThreadStart);
+        if (!ThreadRunning) break;
+
+        for (;;)
+        {
+            u64 limit = ThreadLimit.load(std::memory_order_acquire);
+            if (DSPTimestamp < limit)
+            {
+                u64 next = (DSPTimestamp + ThreadStep) & ~(ThreadStep - 1);
+                if (next > limit) next = limit;
+
+                DSPCore->Run((u32)(next - DSPTimestamp));
+                DSPTimestamp = next;
+            }
+            else if (ThreadParked.load(std::memory_order_acquire))
+            {
+                // the limit is final once the ARM side is parked
+                if (DSPTimestamp >= ThreadLimit.load(std::memory_order_acquire))
+                    break;
+            }
+            else
+                WaitForThreadLimit(limit);
+        }
+
+        Platform::Semaphore_Post(SemThreadDone);
+    }
+}
+
+void DSi_DSP::WaitForThreadLimit(u64 limit)
+{
+    // the ARM side is usually not far ahead, so don't go to sleep right away
+    for (int i = 0; i < 64; i++)
+    {
+        if (ThreadLimit.load() != limit || ThreadParked.load())
+            return;
+
+        std::this_thread::yield();
+    }
+
+    ThreadWaiting = true;
+    if (ThreadLimit.load() != limit || ThreadParked.load())
+    {
+        // if the flag was already taken, the ARM side is posting the wakeup
+        if (ThreadWaiting.exchange(false))
+            return;
+    }
+
+    Platform::Semaphore_Wait(SemThreadWake);
+}
+
+bool DSi_DSP::StartThread()
+{
+    // only the Teakra core is worth running on a separate thread
+    if (!DSPCore || DSPCore->GetID() != Teakra::ID) return false;
+    if (!IsDSPCoreEnabled()) return false;
+
+    ThreadStartTimestamp = DSPTimestamp;
+    ThreadLimit = DSPTimestamp;
+    ThreadParked = false;
+    ThreadEmuParked = false;
+    ThreadIRQ = false;
+    ThreadActive = true;
+    Platform::Semaphore_Post(SemThreadStart);
+    return true;
+}
+
+void DSi_DSP::UpdateThreadLimit(u64 timestamp)
+{
+    if (!ThreadActive && !StartThread())
+        return;
+
+    // only hand out whole steps, the rest is done when the ARM side syncs up
+    timestamp &= ~(ThreadStep - 1);
+    if (timestamp <= ThreadLimit.load(std::memory_order_relaxed))
+        return;
+
+    ThreadLimit.store(timestamp, std::memory_order_release);
+    if (ThreadWaiting.exchange(false))
+        Platform::Semaphore_Post(SemThreadWake);
+}
+
+void DSi_DSP::WaitForEmuParked()
+{
+    // called from the DSP thread before it accesses the rest of the system
+    // this is only safe while the ARM side is waiting for the DSP thread to catch up
+    if (!ThreadActive || ThreadEmuParked) return;
+
+    Platform::Semaphore_Wait(SemEmuParked);
+    ThreadEmuParked = true;
+}
+
+void DSi_DSP::InvalidateProgramCache()
+{
+    if (DSPCore) DSPCore->InvalidateProgramCache();
+}
+
+void DSi_DSP::SyncThread()
+{
+    if (!ThreadActive) return;
+
+    // the DSP thread only ever runs behind the ARM9, so it's caught up right here,
+    // as it would be without the thread
+    // (the ARM9 timestamp only goes backwards when a savestate is being loaded)
+    u64 target = std::max(DSi.ARM9Timestamp, ThreadLimit.load(std::memory_order_relaxed));
+    ThreadLimit.store(target, std::memory_order_release);
+    ThreadParked.store(true, std::memory_order_release);
+    if (ThreadWaiting.exchange(false))
+        Platform::Semaphore_Post(SemThreadWake);
+
+    // let the DSP thread access the rest of the system while we wait for it
+    Platform::Semaphore_Post(SemEmuParked);
+    Platform::Semaphore_Wait(SemThreadDone);
+    Platform::Semaphore_Reset(SemEmuParked);
+
+    ThreadActive = false;
+    ThreadParked = false;
+
+    ProcessSamples(SampleInput, SampleOutput);
+
+    if (ThreadIRQ)
+    {
+        ThreadIRQ = false;
+        DSi.SetIRQ(0, IRQ_DSi_DSP);
+    }
+
+    if (DSPTimestamp > ThreadStartTimestamp)
+    {
+        DSi.CancelEvent(Event_DSi_DSP);
+        DSi.ScheduleEvent(Event_DSi_DSP, false, 4096, 0, 0);
+    }
+}
+
 
 bool DSi_DSP::IsRstReleased() const
 {
@@ -752,6 +1000,8 @@ void DSi_DSP::Write32(u32 addr, u32 val)
 
 bool DSi_DSP::DSPCatchUp()
 {
+    SyncThread();
+
     if (!IsDSPCoreEnabled())
     {
         // nothing to do, but advance the current time so that we don't do an
@@ -788,7 +1038,10 @@ void DSi_DSP::Run(u32 cycles)
     }
 
     if (DSPCore)
+    {
+        ProcessSamples(SampleInput, SampleOutput);
         DSPCore->Run(cycles);
+    }
 
     DSPTimestamp += cycles;
 
@@ -19,9 +19,12 @@
 #ifndef DSI_DSP_H
 #define DSI_DSP_H
 
+#include <atomic>
+
 #include "types.h"
 #include "Savestate.h"
 #include "FIFO.h"
+#include "Platform.h"
 
 // TODO: for actual sound output
 // * audio callbacks
@@ -84,6 +87,8 @@ public:
     // core
     virtual void Start() {};
     virtual void Run(unsigned cycle) {};
+    // called when program memory was changed from outside the DSP
+    virtual void InvalidateProgramCache() {};
 
     virtual void SampleClock(s16 output[2], s16 input) = 0;
 };
@@ -99,6 +104,24 @@ public:
     bool GetDSPHLE() { return DSPHLE; }
     void SetDSPHLE(bool hle);
 
+    // threaded mode: the Teakra core follows the ARM9 on a separate thread, without ever running past it
+    // the ARM side waits for it to catch up wherever the DSP would be caught up without the thread,
+    // which is also where its IRQs are raised and where it gets to access the rest of the system
+    bool GetThreaded() { return Threaded; }
+    void SetThreaded(bool threaded);
+
+    // catches the DSP thread up with the ARM9 and takes the core back from it
+    void SyncThread();
+
+    // lets the DSP thread run up to the given ARM9 timestamp, called once per scheduler slice
+    void SetThreadLimit(u64 timestamp)
+    {
+        if (Threaded) UpdateThreadLimit(timestamp);
+    }
+
+    // to be called when the NWRAM mapped to the DSP's program memory changes
+    void InvalidateProgramCache();
+
     void StartDSPLLE();
     void StartDSPHLE();
     void StopDSP();
@@ -150,6 +173,30 @@ private:
 
     u64 DSPTimestamp;
 
+    bool Threaded = false;
+    Platform::Thread* DSPThread = nullptr;
+    Platform::Semaphore* SemThreadStart = nullptr;
+    Platform::Semaphore* SemThreadWake = nullptr;
+    Platform::Semaphore* SemThreadDone = nullptr;
+    Platform::Semaphore* SemEmuParked = nullptr;
+    bool ThreadRunning = false;
+    bool ThreadActive = false;   // the DSP thread owns the core, the ARM side must not touch it
+    bool ThreadEmuParked = false;
+    bool ThreadIRQ = false;
+    u64 ThreadStartTimestamp = 0;
+    std::atomic<u64> ThreadLimit = 0;        // the DSP thread may run up to this ARM9 timestamp
+    std::atomic_bool ThreadParked = false;   // the ARM side is waiting for the DSP thread to reach ThreadLimit
+    std::atomic_bool ThreadWaiting = false;  // the DSP thread is waiting for ThreadLimit to move
+
+    // the DSP thread runs the core in steps aligned to this many ARM9 cycles
+    // so that it's always run in the same steps, no matter how far behind it is
+    static constexpr u64 ThreadStep = 512;
+
+    // with the DSP thread, I2S samples go through these, and reach the core when the ARM side syncs up with it
+    // the output is delayed by a few samples
+    FIFO<s16, 16> SampleInput;
+    FIFO<u32, 16> SampleOutput;
+
     FIFO<u16, 16> PDATAReadFifo/*, *PDATAWriteFifo*/;
     int PDataDMALen;
 
@@ -162,6 +209,14 @@ private:
 
     bool DSPCatchUp();
 
+    void ThreadFunc();
+    void WaitForThreadLimit(u64 limit);
+    bool StartThread();
+    void UpdateThreadLimit(u64 timestamp);
+    void WaitForEmuParked();
+    void RaiseIRQ();
+    void ProcessSamples(FIFO<s16, 16>& input, FIFO<u32, 16>& output);
+
     void PDataDMAWrite(u16 wrval);
     u16 PDataDMARead();
     void PDataDMAFetch();
@@ -122,6 +122,10 @@ void GPU::ResetVRAMCache() noexcept
     memset(VRAMFlat_BOBJExtPal, 0, sizeof(VRAMFlat_BOBJExtPal));
     memset(VRAMFlat_Texture, 0, sizeof(VRAMFlat_Texture));
     memset(VRAMFlat_TexPal, 0, sizeof(VRAMFlat_TexPal));
+    VRAMFlatStale_Texture = 0;
+    VRAMFlatStale_TexPal = 0;
+    SnapshotDirty_Texture.Clear();
+    SnapshotDirty_TexPal.Clear();
 }
 
 void GPU::Reset() noexcept
@@ -134,6 +138,12 @@ void GPU::Reset() noexcept
     NextVCount = 0;
     TotalScanlines = 0;
 
+    FrameSkipCount = 0;
+    SkipRendering = false;
+    Skipped3D = false;
+    Stale3D = false;
+    CaptureUsed = false;
+
     DispStat[0] = 0;
     DispStat[1] = 0;
     VMatch[0] = 0;
@@ -177,6 +187,8 @@ void GPU::Reset() noexcept
     memset(VRAMPtr_AOBJ, 0, sizeof(VRAMPtr_AOBJ));
     memset(VRAMPtr_BBG, 0, sizeof(VRAMPtr_BBG));
     memset(VRAMPtr_BOBJ, 0, sizeof(VRAMPtr_BOBJ));
+    memset(VRAMPtr_Texture, 0, sizeof(VRAMPtr_Texture));
+    memset(VRAMPtr_TexPal, 0, sizeof(VRAMPtr_TexPal));
 
     memset(VRAMCaptureBlockFlags, 0, sizeof(VRAMCaptureBlockFlags));
 
@@ -295,6 +307,10 @@ void GPU::DoSavestate(Savestate* file) noexcept
             VRAMPtr_BOBJ[i] = GetUniqueBankPtr(VRAMMap_BOBJ[i], i << 14);
             VRAMCBF_BOBJ[i] = GetUniqueBankCBF(VRAMMap_BOBJ[i], i);
         }
+        for (int i = 0; i < 4; i++)
+            VRAMPtr_Texture[i] = GetUniqueBankPtr(VRAMMap_Texture[i], i << 17);
+        for (int i = 0; i < 8; i++)
+            VRAMPtr_TexPal[i] = GetUniqueBankPtr(VRAMMap_TexPal[i], i << 14);
     }
 
     GPU2D_A.DoSavestate(file);
@@ -617,6 +633,7 @@ void GPU::MapVRAM_AB(u32 bank, u8 cnt) noexcept
 
         case 3: // texture
             VRAMMap_Texture[oldofs] &= ~bankmask;
+            VRAMPtr_Texture[oldofs] = GetUniqueBankPtr(VRAMMap_Texture[oldofs], oldofs << 17);
             break;
         }
     }
@@ -642,6 +659,7 @@ void GPU::MapVRAM_AB(u32 bank, u8 cnt) noexcept
 
         case 3: // texture
             VRAMMap_Texture[ofs] |= bankmask;
+            VRAMPtr_Texture[ofs] = GetUniqueBankPtr(VRAMMap_Texture[ofs], ofs << 17);
             break;
         }
     }
@@ -682,6 +700,7 @@ void GPU::MapVRAM_CD(u32 bank, u8 cnt) noexcept
 
         case 3: // texture
             VRAMMap_Texture[oldofs] &= ~bankmask;
+            VRAMPtr_Texture[oldofs] = GetUniqueBankPtr(VRAMMap_Texture[oldofs], oldofs << 17);
             break;
 
         case 4: // BBG/BOBJ
@@ -722,6 +741,7 @@ void GPU::MapVRAM_CD(u32 bank, u8 cnt) noexcept
 
         case 3: // texture
             VRAMMap_Texture[ofs] |= bankmask;
+            VRAMPtr_Texture[ofs] = GetUniqueBankPtr(VRAMMap_Texture[ofs], ofs << 17);
             break;
 
         case 4: // BBG/BOBJ
@@ -772,7 +792,7 @@ void GPU::MapVRAM_E(u32 bank, u8 cnt) noexcept
             break;
 
         case 3: // texture palette
-            UNMAP_RANGE(TexPal, 0, 4);
+            UNMAP_RANGE_PTR(TexPal, 0, 4);
             break;
 
         case 4: // ABG ext palette
@@ -800,7 +820,7 @@ void GPU::MapVRAM_E(u32 bank, u8 cnt) noexcept
             break;
 
         case 3: // texture palette
-            MAP_RANGE(TexPal, 0, 4);
+            MAP_RANGE_PTR(TexPal, 0, 4);
             break;
 
         case 4: // ABG ext palette
@@ -856,7 +876,11 @@ void GPU::MapVRAM_FG(u32 bank, u8 cnt) noexcept
             break;
 
         case 3: // texture palette
-            VRAMMap_TexPal[(oldofs & 0x1) + ((oldofs & 0x2) << 1)] &= ~bankmask;
+            {
+                u32 base = (oldofs & 0x1) + ((oldofs & 0x2) << 1);
+                VRAMMap_TexPal[base] &= ~bankmask;
+                VRAMPtr_TexPal[base] = GetUniqueBankPtr(VRAMMap_TexPal[base], base << 14);
+            }
             break;
 
         case 4: // ABG ext palette
@@ -903,7 +927,11 @@ void GPU::MapVRAM_FG(u32 bank, u8 cnt) noexcept
             break;
 
         case 3: // texture palette
-            VRAMMap_TexPal[(ofs & 0x1) + ((ofs & 0x2) << 1)] |= bankmask;
+            {
+                u32 base = (ofs & 0x1) + ((ofs & 0x2) << 1);
+                VRAMMap_TexPal[base] |= bankmask;
+                VRAMPtr_TexPal[base] = GetUniqueBankPtr(VRAMMap_TexPal[base], base << 14);
+            }
             break;
 
         case 4: // ABG ext palette
@@ -1135,9 +1163,46 @@ void GPU::StartFrame() noexcept
     RunFIFO = UsesDisplayFIFO() || NDS.DMAsInMode(0, 0x04);
 
     TotalScanlines = 0;
+
+    // whether this frame is drawn was decided when its 3D scene was due to be rendered
+    SkipRendering = Skipped3D;
+
     StartScanline(0);
 }
 
+void GPU::SetFrameSkip(u32 frames) noexcept
+{
+    FrameSkip = frames;
+    FrameSkipCount = 0;
+}
+
+void GPU::SnapshotTextureVRAM() noexcept
+{
+    // bring the flat copies up to date without handing the changes to the renderer yet
+    auto textureDirty = VRAMDirty_Texture.DeriveState(VRAMMap_Texture, *this);
+    auto texPalDirty = VRAMDirty_TexPal.DeriveState(VRAMMap_TexPal, *this);
+
+    MakeVRAMFlat_TextureCoherent(textureDirty);
+    MakeVRAMFlat_TexPalCoherent(texPalDirty);
+
+    SnapshotDirty_Texture |= textureDirty;
+    SnapshotDirty_TexPal |= texPalDirty;
+}
+
+void GPU::Start3DRendering() noexcept
+{
+    // if a 3D scene was skipped, the renderer's output is older than what
+    // the 3D engine considers to be the previous frame
+    if (Stale3D)
+    {
+        GPU3D.RenderFrameIdentical = false;
+        Stale3D = false;
+    }
+
+    Skipped3D = false;
+    Rend->Start3DRendering();
+}
+
 void GPU::StartHBlank(u32 line) noexcept
 {
     DispStat[0] |= (1<<1);
@@ -1153,20 +1218,50 @@ void GPU::StartHBlank(u32 line) noexcept
     {
         // draw
         // note: this should start 48 cycles after the scanline start
-        if (line < 192)
-            Rend->DrawScanline(line);
-        if (line < 191)
-            Rend->DrawSprites(line+1);
+        if (SkipRendering)
+        {
+            GPU2D_A.SkipScanline();
+            GPU2D_B.SkipScanline();
+        }
+        else
+        {
+            if (line < 192)
+                Rend->DrawScanline(line);
+            if (line < 191)
+                Rend->DrawSprites(line+1);
+        }
 
         NDS.CheckDMAs(0, 0x02);
     }
     else if (VCount == 215)
     {
-        Rend->Start3DRendering();
+        // the 3D scene rendered here is shown during the next frame
+        // so this is where it's decided whether the next frame is skipped
+        // frames that may be captured are rendered as usual, as capture writes them to VRAM.
+        // games that use capture generally do so every frame
+        bool capture = CaptureUsed || (CaptureCnt & (1<<31));
+        CaptureUsed = false;
+
+        if (FrameSkipCount < FrameSkip && !capture)
+        {
+            FrameSkipCount++;
+            Skipped3D = true;
+            Stale3D = true;
+
+            // capture may still be enabled before the next frame starts, the scene then has
+            // to be rendered from the texture VRAM of this point
+            SnapshotTextureVRAM();
+        }
+        else
+        {
+            FrameSkipCount = 0;
+            Start3DRendering();
+        }
     }
     else if (VCount == 262)
     {
         // sprites are pre-rendered one scanline in advance
+        // this is also done for skipped frames, in case they end up being drawn for display capture
         Rend->DrawSprites(0);
     }
 
@@ -1184,14 +1279,18 @@ void GPU::StartHBlank(u32 line) noexcept
 
 void GPU::FinishFrame(u32 lines) noexcept
 {
-    Rend->SwapBuffers();
+    // skipped frames leave the last rendered frame in place
+    if (!SkipRendering)
+        Rend->SwapBuffers();
 
     TotalScanlines = lines;
 
     if (GPU3D.AbortFrame)
     {
+        // restarting also renders the next frame's 3D scene
         Rend->Restart3DRendering();
         GPU3D.AbortFrame = false;
+        Skipped3D = false;
     }
 }
 
@@ -1264,7 +1363,22 @@ void GPU::StartScanline(u32 line) noexcept
         if (CaptureCnt & (1<<31))
         {
             CaptureEnable = true;
+            CaptureUsed = true;
             CheckCaptureStart();
+
+            // display capture writes to VRAM, so the frame has to be rendered after all
+            // this is only reached if capture wasn't used for the previous frame
+            if (SkipRendering)
+            {
+                SkipRendering = false;
+                if (Skipped3D)
+                {
+                    // the scene is rendered from texture VRAM as it was at VCount 215
+                    Render3DFromSnapshot = true;
+                    Start3DRendering();
+                    Render3DFromSnapshot = false;
+                }
+            }
         }
     }
     else if (VCount == 192)
@@ -1286,7 +1400,8 @@ void GPU::StartScanline(u32 line) noexcept
         // texture memory anyway and only update it before the start
         // of the next frame.
         // So we can give the rasteriser a bit more headroom
-        Rend->Finish3DRendering();
+        if (!Skipped3D)
+            Rend->Finish3DRendering();
 
         DispStat[0] |= (1<<0);
         DispStat[1] |= (1<<0);
@@ -1298,7 +1413,8 @@ void GPU::StartScanline(u32 line) noexcept
 
         GPU3D.VBlank();
 
-        Rend->VBlank();
+        if (!SkipRendering)
+            Rend->VBlank();
 
         if (CaptureEnable)
         {
@@ -1465,13 +1581,112 @@ template NonStupidBitField<512*1024/VRAMDirtyGranularity> VRAMTrackingSet<512*10
 
 bool GPU::MakeVRAMFlat_TextureCoherent(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty) noexcept
 {
+    // catch up on pages MakeVRAMPages_Texture() didn't copy
+    for (u32 i = 0; i < 4; i++)
+    {
+        if (VRAMFlatStale_Texture & (1 << i))
+            dirty.SetRange(i * (128*1024/VRAMDirtyGranularity), 128*1024/VRAMDirtyGranularity);
+    }
+    VRAMFlatStale_Texture = 0;
+
     return CopyLinearVRAM<128*1024>(VRAMFlat_Texture, VRAMMap_Texture, dirty, &GPU::ReadVRAM_Texture<u64>);
 }
 bool GPU::MakeVRAMFlat_TexPalCoherent(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty) noexcept
 {
+    for (u32 i = 0; i < 8; i++)
+    {
+        if (VRAMFlatStale_TexPal & (1 << i))
+            dirty.SetRange(i * (16*1024/VRAMDirtyGranularity), 16*1024/VRAMDirtyGranularity);
+    }
+    VRAMFlatStale_TexPal = 0;
+
     return CopyLinearVRAM<16*1024>(VRAMFlat_TexPal, VRAMMap_TexPal, dirty, &GPU::ReadVRAM_TexPal<u64>);
 }
 
+bool GPU::MakeVRAMPages_Texture(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept
+{
+    return MakeLinearVRAMPages<128*1024>(VRAMFlat_Texture, VRAMMap_Texture, VRAMPtr_Texture, VRAMFlatStale_Texture, dirty, pages, &GPU::ReadVRAM_Texture<u64>);
+}
+bool GPU::MakeVRAMPages_TexPal(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept
+{
+    return MakeLinearVRAMPages<16*1024>(VRAMFlat_TexPal, VRAMMap_TexPal, VRAMPtr_TexPal, VRAMFlatStale_TexPal, dirty, pages, &GPU::ReadVRAM_TexPal<u64>);
+}
+
+bool GPU::UpdateVRAMFlat_Texture(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty) noexcept
+{
+    if (Render3DFromSnapshot)
+    {
+        // the flat copy already holds the snapshot
+        // anything written since stays tracked for the next scene
+        dirty = SnapshotDirty_Texture;
+    }
+    else
+    {
+        dirty = VRAMDirty_Texture.DeriveState(VRAMMap_Texture, *this);
+        MakeVRAMFlat_TextureCoherent(dirty);
+        dirty |= SnapshotDirty_Texture;
+    }
+
+    SnapshotDirty_Texture.Clear();
+    return dirty;
+}
+bool GPU::UpdateVRAMFlat_TexPal(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty) noexcept
+{
+    if (Render3DFromSnapshot)
+    {
+        dirty = SnapshotDirty_TexPal;
+    }
+    else
+    {
+        dirty = VRAMDirty_TexPal.DeriveState(VRAMMap_TexPal, *this);
+        MakeVRAMFlat_TexPalCoherent(dirty);
+        dirty |= SnapshotDirty_TexPal;
+    }
+
+    SnapshotDirty_TexPal.Clear();
+    return dirty;
+}
+
+bool GPU::UpdateVRAMPages_Texture(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept
+{
+    if (Render3DFromSnapshot)
+    {
+        // the banks may have changed since the snapshot
+        for (u32 i = 0; i < 4; i++)
+            pages[i] = &VRAMFlat_Texture[i << 17];
+        return UpdateVRAMFlat_Texture(dirty);
+    }
+
+    dirty = VRAMDirty_Texture.DeriveState(VRAMMap_Texture, *this);
+    bool change = MakeVRAMPages_Texture(dirty, pages);
+    if (SnapshotDirty_Texture)
+    {
+        dirty |= SnapshotDirty_Texture;
+        SnapshotDirty_Texture.Clear();
+        change = true;
+    }
+    return change;
+}
+bool GPU::UpdateVRAMPages_TexPal(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept
+{
+    if (Render3DFromSnapshot)
+    {
+        for (u32 i = 0; i < 8; i++)
+            pages[i] = &VRAMFlat_TexPal[i << 14];
+        return UpdateVRAMFlat_TexPal(dirty);
+    }
+
+    dirty = VRAMDirty_TexPal.DeriveState(VRAMMap_TexPal, *this);
+    bool change = MakeVRAMPages_TexPal(dirty, pages);
+    if (SnapshotDirty_TexPal)
+    {
+        dirty |= SnapshotDirty_TexPal;
+        SnapshotDirty_TexPal.Clear();
+        change = true;
+    }
+    return change;
+}
+
 bool GPU::MakeVRAMFlat_ABGCoherent(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty) noexcept
 {
     return CopyLinearVRAM<16*1024>(VRAMFlat_ABG, VRAMMap_ABG, dirty, &GPU::ReadVRAM_ABG<u64>);
@@ -68,6 +68,13 @@ public:
     const Renderer& GetRenderer() const noexcept { return *Rend; }
     Renderer& GetRenderer() noexcept { return *Rend; }
 
+    // frameskip: skipped frames aren't drawn and their 3D scene isn't rendered,
+    // but everything visible to the emulated system still happens
+    // frames using display capture are always rendered
+    void SetFrameSkip(u32 frames) noexcept;
+    u32 GetFrameSkip() const noexcept { return FrameSkip; }
+    bool IsFrameSkipped() const noexcept { return SkipRendering; }
+
     // return value for GetFramebuffers:
     // true -> pointers to RAM framebuffers are returned via the parameters
     // false -> this renderer doesn't use RAM framebuffers
@@ -613,6 +620,21 @@ public:
     bool MakeVRAMFlat_TextureCoherent(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty) noexcept;
     bool MakeVRAMFlat_TexPalCoherent(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty) noexcept;
 
+    // same as MakeVRAMFlat_*Coherent, except that pages with only one bank mapped aren't copied
+    // pages[] is filled with where each page can be read from: the bank itself, or the flat copy
+    // the banks may only be read from while their mapping and contents can't change
+    bool MakeVRAMPages_Texture(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept;
+    bool MakeVRAMPages_TexPal(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept;
+
+    // the 3D renderers get texture VRAM through these rather than MakeVRAMFlat_*/MakeVRAMPages_*
+    // when a frame is skipped, the texture VRAM its 3D scene would have been rendered from is kept
+    // in the flat copies, and a scene that has to be rendered late after all is rendered from that
+    // dirty receives every page that changed since the renderer last got texture VRAM
+    bool UpdateVRAMFlat_Texture(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty) noexcept;
+    bool UpdateVRAMFlat_TexPal(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty) noexcept;
+    bool UpdateVRAMPages_Texture(NonStupidBitField<512*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept;
+    bool UpdateVRAMPages_TexPal(NonStupidBitField<128*1024/VRAMDirtyGranularity>& dirty, u8** pages) noexcept;
+
     melonDS::NDS& NDS;
 
     bool ScreensEnabled = false;
@@ -668,6 +690,8 @@ public:
     u8* VRAMPtr_AOBJ[0x10] {};
     u8* VRAMPtr_BBG[0x8] {};
     u8* VRAMPtr_BOBJ[0x8] {};
+    u8* VRAMPtr_Texture[4] {};
+    u8* VRAMPtr_TexPal[8] {};
 
     melonDS::GPU2D GPU2D_A;
     melonDS::GPU2D GPU2D_B;
@@ -701,6 +725,15 @@ public:
     alignas(u64) u8 VRAMFlat_Texture[512*1024] {};
     alignas(u64) u8 VRAMFlat_TexPal[128*1024] {};
 
+    // pages that MakeVRAMPages_* left out of the flat copy
+    u8 VRAMFlatStale_Texture = 0;
+    u8 VRAMFlatStale_TexPal = 0;
+
+    // pages copied into the flat copies by SnapshotTextureVRAM() that no renderer has seen yet
+    NonStupidBitField<512*1024/VRAMDirtyGranularity> SnapshotDirty_Texture;
+    NonStupidBitField<128*1024/VRAMDirtyGranularity> SnapshotDirty_TexPal;
+    bool Render3DFromSnapshot = false;
+
     u32 OAMDirty = 0;
     u32 PaletteDirty = 0;
 
@@ -782,6 +815,45 @@ private:
         return change;
     }
 
+    template <u32 MappingGranularity, u32 Size>
+    bool MakeLinearVRAMPages(u8* flat, const u32* mappings, u8* const* bankptrs, u8& stale, NonStupidBitField<Size>& dirty, u8** pages, u64 (GPU::* const slowAccess)(u32) const noexcept) noexcept
+    {
+        const u32 VRAMBitsPerMapping = MappingGranularity / VRAMDirtyGranularity;
+        const u32 NumPages = Size / VRAMBitsPerMapping;
+
+        bool change = false;
+
+        for (u32 i = 0; i < NumPages; i++)
+        {
+            u32 start = i * VRAMBitsPerMapping;
+            if (bankptrs[i])
+            {
+                // the bank is read directly, the flat copy of this page falls behind
+                pages[i] = bankptrs[i];
+                stale |= (1 << i);
+
+                if (dirty.CheckRange(start, VRAMBitsPerMapping))
+                {
+                    change = true;
+                    for (u32 j = start; j < start + VRAMBitsPerMapping; j++)
+                        dirty[j] = false;
+                }
+            }
+            else
+            {
+                pages[i] = flat + i * MappingGranularity;
+                if (stale & (1 << i))
+                {
+                    dirty.SetRange(start, VRAMBitsPerMapping);
+                    stale &= ~(1 << i);
+                }
+            }
+        }
+
+        change |= CopyLinearVRAM<MappingGranularity>(flat, mappings, dirty, slowAccess);
+        return change;
+    }
+
     u16* GetUniqueBankCBF(u32 mask, u32 offset);
     void VRAMCBFlagsSet(u32 bank, u32 block, u16 val);
     void VRAMCBFlagsClear(u32 bank, u32 block);
@@ -802,6 +874,16 @@ private:
 
     bool RunFIFO = false;
 
+    u32 FrameSkip = 0;
+    u32 FrameSkipCount = 0;
+    bool SkipRendering = false; // the current frame isn't drawn
+    bool Skipped3D = false;     // the 3D scene for the current frame wasn't rendered
+    bool Stale3D = false;       // a 3D scene was skipped since the last one was rendered
+    bool CaptureUsed = false;   // display capture was enabled for the current frame
+
+    void SnapshotTextureVRAM() noexcept;
+    void Start3DRendering() noexcept;
+
     u16 VMatch[2] {};
 
     std::unique_ptr<Renderer> Rend = nullptr;
@@ -828,6 +910,13 @@ struct RendererSettings
 
     // "improved polygon splitting" (regular OpenGL renderer)
     bool BetterPolygons;
+
+    // scale factor for the software renderer (1-4)
+    // this is separate from ScaleFactor, as the software renderer still
+    // outputs native resolution framebuffers through GetFramebuffers()
+    // the upscaled output is only available through SoftRenderer::GetHiresFramebuffers(),
+    // the frontend doesn't set this or show it yet
+    int SoftScaleFactor;
 };
 
 class Renderer
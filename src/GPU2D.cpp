@@ -668,6 +668,38 @@ void GPU2D::UpdateWindows(u32 line)
     else if (line == Win1Coords[2]) Win1Active |=  0x1;
 }
 
+void GPU2D::SkipScanline()
+{
+    if (!Enabled || ForcedBlank) return;
+
+    // the horizontal window state is updated while calculating the window mask
+    // when a scanline isn't drawn, it still needs to go through the same changes
+
+    if (DispCnt & (1<<14))
+    {
+        u8 x1 = Win1Coords[0];
+        u8 x2 = Win1Coords[1];
+
+        for (int i = 0; i < 256; i++)
+        {
+            if (i == x2)      Win1Active &= ~0x2;
+            else if (i == x1) Win1Active |=  0x2;
+        }
+    }
+
+    if (DispCnt & (1<<13))
+    {
+        u8 x1 = Win0Coords[0];
+        u8 x2 = Win0Coords[1];
+
+        for (int i = 0; i < 256; i++)
+        {
+            if (i == x2)      Win0Active &= ~0x2;
+            else if (i == x1) Win0Active |=  0x2;
+        }
+    }
+}
+
 void GPU2D::CalculateWindowMask(u8* windowMask, const u8* objWindow)
 {
     for (u32 i = 0; i < 256; i++)
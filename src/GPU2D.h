@@ -52,6 +52,7 @@ public:
     void UpdateRegistersPreDraw(bool reset);
     void UpdateRegistersPostDraw(bool reset);
     void UpdateWindows(u32 line);
+    void SkipScanline();
 
     u16* GetBGExtPal(u32 slot, u32 pal);
     u16* GetOBJExtPal();
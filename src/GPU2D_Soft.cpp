@@ -40,6 +40,11 @@ void SoftRenderer2D::Reset()
     memset(OBJWindow, 0, sizeof(OBJWindow));
 
     NumSprites = 0;
+
+    ContentVersion = 0;
+    SpriteStateValid = false;
+    for (int i = 0; i < 192; i++)
+        LineCache[i].Valid = false;
 }
 
 u32 SoftRenderer2D::ColorComposite(int i, u32 val1, u32 val2) const
@@ -138,27 +143,124 @@ void SoftRenderer2D::DrawScanline(u32 line)
         return;
     }
 
+    UpdateVRAM();
+
+    // if nothing this scanline depends on changed since the previous frame,
+    // the previous output can be reused
+    // the 3D layer isn't tracked, so scanlines that may show it are always redrawn
+    CachedLine& cached = LineCache[line];
+    LineState state;
+    GetLineState(state);
+    bool cacheable = SpriteStateValid && !(GPU2D.Num == 0 && (GPU2D.DispCnt & (1<<3)));
+
+    if (cacheable && cached.Valid &&
+        !memcmp(&state, &cached.State, sizeof(LineState)) &&
+        !memcmp(&SpriteState, &cached.SpriteState, sizeof(LineState)))
+    {
+        memcpy(dst, cached.Output, sizeof(cached.Output));
+
+        // window state is updated while drawing
+        GPU2D.Win0Active = cached.Win0Active;
+        GPU2D.Win1Active = cached.Win1Active;
+        return;
+    }
+
+    // render BG layers and sprites
+    DrawScanline_BGOBJ(line, dst);
+
+    cached.Valid = cacheable;
+    if (cacheable)
+    {
+        cached.State = state;
+        cached.SpriteState = SpriteState;
+        cached.Win0Active = GPU2D.Win0Active;
+        cached.Win1Active = GPU2D.Win1Active;
+        memcpy(cached.Output, dst, sizeof(cached.Output));
+    }
+}
+
+void SoftRenderer2D::UpdateVRAM()
+{
+    // BG and OBJ VRAM are both synced here, so that any change is noticed
+    // whichever of DrawSprites and DrawScanline comes next
+    bool changed = false;
+
     if (GPU2D.Num == 0)
     {
         auto bgDirty = GPU.VRAMDirty_ABG.DeriveState(GPU.VRAMMap_ABG, GPU);
-        GPU.MakeVRAMFlat_ABGCoherent(bgDirty);
+        changed |= GPU.MakeVRAMFlat_ABGCoherent(bgDirty);
         auto bgExtPalDirty = GPU.VRAMDirty_ABGExtPal.DeriveState(GPU.VRAMMap_ABGExtPal, GPU);
-        GPU.MakeVRAMFlat_ABGExtPalCoherent(bgExtPalDirty);
+        changed |= GPU.MakeVRAMFlat_ABGExtPalCoherent(bgExtPalDirty);
+        auto objDirty = GPU.VRAMDirty_AOBJ.DeriveState(GPU.VRAMMap_AOBJ, GPU);
+        changed |= GPU.MakeVRAMFlat_AOBJCoherent(objDirty);
         auto objExtPalDirty = GPU.VRAMDirty_AOBJExtPal.DeriveState(&GPU.VRAMMap_AOBJExtPal, GPU);
-        GPU.MakeVRAMFlat_AOBJExtPalCoherent(objExtPalDirty);
+        changed |= GPU.MakeVRAMFlat_AOBJExtPalCoherent(objExtPalDirty);
     }
     else
     {
         auto bgDirty = GPU.VRAMDirty_BBG.DeriveState(GPU.VRAMMap_BBG, GPU);
-        GPU.MakeVRAMFlat_BBGCoherent(bgDirty);
+        changed |= GPU.MakeVRAMFlat_BBGCoherent(bgDirty);
         auto bgExtPalDirty = GPU.VRAMDirty_BBGExtPal.DeriveState(GPU.VRAMMap_BBGExtPal, GPU);
-        GPU.MakeVRAMFlat_BBGExtPalCoherent(bgExtPalDirty);
+        changed |= GPU.MakeVRAMFlat_BBGExtPalCoherent(bgExtPalDirty);
+        auto objDirty = GPU.VRAMDirty_BOBJ.DeriveState(GPU.VRAMMap_BOBJ, GPU);
+        changed |= GPU.MakeVRAMFlat_BOBJCoherent(objDirty);
         auto objExtPalDirty = GPU.VRAMDirty_BOBJExtPal.DeriveState(&GPU.VRAMMap_BOBJExtPal, GPU);
-        GPU.MakeVRAMFlat_BOBJExtPalCoherent(objExtPalDirty);
+        changed |= GPU.MakeVRAMFlat_BOBJExtPalCoherent(objExtPalDirty);
     }
 
-    // render BG layers and sprites
-    DrawScanline_BGOBJ(line, dst);
+    u32 palmask = (GPU2D.Num == 0) ? 0x13 : 0x4C;
+    u32 oammask = 1 << GPU2D.Num;
+    if ((GPU.PaletteDirty & palmask) || (GPU.OAMDirty & oammask))
+    {
+        GPU.PaletteDirty &= ~palmask;
+        GPU.OAMDirty &= ~oammask;
+        changed = true;
+    }
+
+    if (changed)
+        ContentVersion++;
+}
+
+void SoftRenderer2D::GetLineState(LineState& state) const
+{
+    // cleared first so padding doesn't get in the way of comparisons
+    memset(&state, 0, sizeof(LineState));
+
+    state.ContentVersion = ContentVersion;
+    state.DispCnt = GPU2D.DispCnt;
+    state.LayerEnable = GPU2D.LayerEnable;
+    state.OBJEnable = GPU2D.OBJEnable;
+    for (int i = 0; i < 4; i++)
+    {
+        state.BGCnt[i] = GPU2D.BGCnt[i];
+        state.BGXPos[i] = GPU2D.BGXPos[i];
+        state.BGYPos[i] = GPU2D.BGYPos[i];
+        state.Win0Coords[i] = GPU2D.Win0Coords[i];
+        state.Win1Coords[i] = GPU2D.Win1Coords[i];
+        state.WinCnt[i] = GPU2D.WinCnt[i];
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        state.BGXRefInternal[i] = GPU2D.BGXRefInternal[i];
+        state.BGYRefInternal[i] = GPU2D.BGYRefInternal[i];
+        state.BGRotA[i] = GPU2D.BGRotA[i];
+        state.BGRotB[i] = GPU2D.BGRotB[i];
+        state.BGRotC[i] = GPU2D.BGRotC[i];
+        state.BGRotD[i] = GPU2D.BGRotD[i];
+        state.BGMosaicSize[i] = GPU2D.BGMosaicSize[i];
+        state.OBJMosaicSize[i] = GPU2D.OBJMosaicSize[i];
+    }
+    state.Win0Active = GPU2D.Win0Active;
+    state.Win1Active = GPU2D.Win1Active;
+    state.BGMosaicY = GPU2D.BGMosaicY;
+    state.BGMosaicYMax = GPU2D.BGMosaicYMax;
+    state.OBJMosaicY = GPU2D.OBJMosaicY;
+    state.BGMosaicLine = GPU2D.BGMosaicLine;
+    state.OBJMosaicLine = GPU2D.OBJMosaicLine;
+    state.BlendCnt = GPU2D.BlendCnt;
+    state.EVA = GPU2D.EVA;
+    state.EVB = GPU2D.EVB;
+    state.EVY = GPU2D.EVY;
 }
 
 #define DoDrawBG(type, line, num) \
@@ -357,6 +459,46 @@ void SoftRenderer2D::DrawScanline_BGOBJ(u32 line, u32* dst)
     }
 }
 
+void SoftRenderer2D::CompositeHires(u32* dst, const u32* line3D, int scale) const
+{
+    const u32* output = Parent.Output2D[GPU2D.Num];
+
+    for (int i = 0; i < 256; i++)
+    {
+        u32 val1 = BGOBJLine[i];
+        u32 val2 = BGOBJLine[256+i];
+        bool is3D1 = ((val1 >> 24) & 0xC0) == 0x40;
+        bool is3D2 = ((val2 >> 24) & 0xC0) == 0x40;
+
+        if (!(is3D1 || is3D2))
+        {
+            // the 3D layer isn't visible here, the native pixel can be used as-is
+            for (int j = 0; j < scale; j++)
+                *dst++ = output[i];
+
+            continue;
+        }
+
+        // only the two topmost layers are known here
+        // if the upscaled 3D pixel is transparent, whatever was under it is used
+        // with nothing to blend with
+        for (int j = 0; j < scale; j++)
+        {
+            u32 c = line3D[(i * scale) + j];
+            u32 top = val1, bottom = val2;
+
+            if (is3D1)
+            {
+                if (c >> 24) top = c | 0x40000000;
+                else { top = val2; bottom = 0; }
+            }
+            else if (c >> 24)
+                bottom = c | 0x40000000;
+
+            *dst++ = ColorComposite(i, top, bottom);
+        }
+    }
+}
 
 void SoftRenderer2D::DrawPixel(u32* dst, u16 color, u32 flag)
 {
@@ -1024,20 +1166,17 @@ void SoftRenderer2D::InterleaveSprites(u32 prio)
 void SoftRenderer2D::DrawSprites(u32 line)
 {
     // the OBJ buffers don't get updated at all if the 2D engine is disabled
+    // the stale buffers aren't tracked, so the next scanline can't be reused
     if (!GPU2D.Enabled)
-        return;
-
-    if (GPU2D.Num == 0)
     {
-        auto objDirty = GPU.VRAMDirty_AOBJ.DeriveState(GPU.VRAMMap_AOBJ, GPU);
-        GPU.MakeVRAMFlat_AOBJCoherent(objDirty);
-    }
-    else
-    {
-        auto objDirty = GPU.VRAMDirty_BOBJ.DeriveState(GPU.VRAMMap_BOBJ, GPU);
-        GPU.MakeVRAMFlat_BOBJCoherent(objDirty);
+        SpriteStateValid = false;
+        return;
     }
 
+    UpdateVRAM();
+    GetLineState(SpriteState);
+    SpriteStateValid = true;
+
     NumSprites = 0;
     memset(OBJLine, 0, sizeof(OBJLine));
     memset(OBJWindow, 0, sizeof(OBJWindow));
@@ -37,6 +37,10 @@ public:
     void VBlank() override {}
     void VBlankEnd() override {};
 
+    // composites one row of upscaled output from the layers of the last
+    // drawn scanline, replacing the 3D layer with the given upscaled one
+    void CompositeHires(u32* dst, const u32* line3D, int scale) const;
+
 private:
     SoftRenderer& Parent;
 
@@ -60,6 +64,47 @@ private:
 
     u32 NumSprites;
 
+    // everything a scanline's output depends on besides the renderer inputs
+    // (VRAM, palette, OAM) which are tracked through ContentVersion
+    struct LineState
+    {
+        u32 ContentVersion;
+        u32 DispCnt;
+        u8 LayerEnable, OBJEnable;
+        u16 BGCnt[4];
+        u16 BGXPos[4];
+        u16 BGYPos[4];
+        s32 BGXRefInternal[2];
+        s32 BGYRefInternal[2];
+        s16 BGRotA[2], BGRotB[2], BGRotC[2], BGRotD[2];
+        u8 Win0Coords[4], Win1Coords[4];
+        u8 WinCnt[4];
+        u8 Win0Active, Win1Active;
+        u8 BGMosaicSize[2], OBJMosaicSize[2];
+        u8 BGMosaicY, BGMosaicYMax, OBJMosaicY;
+        u32 BGMosaicLine, OBJMosaicLine;
+        u16 BlendCnt;
+        u8 EVA, EVB, EVY;
+    };
+
+    // output of the previous frame, reused for scanlines whose inputs didn't change
+    struct CachedLine
+    {
+        bool Valid;
+        LineState SpriteState;
+        LineState State;
+        u8 Win0Active, Win1Active;
+        alignas(8) u32 Output[256];
+    };
+
+    u32 ContentVersion;
+    bool SpriteStateValid;
+    LineState SpriteState;
+    CachedLine LineCache[192];
+
+    void UpdateVRAM();
+    void GetLineState(LineState& state) const;
+
     u8* CurBGXMosaicTable;
     array2d<u8, 16, 256> MosaicTable = []() constexpr
     {
@@ -105,24 +105,30 @@ SoftRenderer3D::SoftRenderer3D(melonDS::GPU3D& gpu3D, SoftRenderer& parent) noex
     RenderThreadRunning = false;
     RenderThreadRendering = false;
     RenderThread = nullptr;
+
+    Sema_BandDone = Platform::Semaphore_Create();
+    SetupBuffers(1);
 }
 
 SoftRenderer3D::~SoftRenderer3D()
 {
     StopRenderThread();
+    StopBandWorkers();
 
     Platform::Semaphore_Free(Sema_RenderStart);
     Platform::Semaphore_Free(Sema_RenderDone);
     Platform::Semaphore_Free(Sema_ScanlineCount);
+    Platform::Semaphore_Free(Sema_BandDone);
 }
 
 void SoftRenderer3D::Reset()
 {
-    memset(ColorBuffer, 0, BufferSize * 2 * 4);
-    memset(DepthBuffer, 0, BufferSize * 2 * 4);
-    memset(AttrBuffer, 0, BufferSize * 2 * 4);
+    std::fill(ColorBuffer.begin(), ColorBuffer.end(), 0);
+    std::fill(DepthBuffer.begin(), DepthBuffer.end(), 0);
+    std::fill(AttrBuffer.begin(), AttrBuffer.end(), 0);
 
-    PrevIsShadowMask = false;
+    for (auto& band : Bands)
+        band->PrevIsShadowMask = false;
 
     SetupRenderThread();
     EnableRenderThread();
@@ -196,10 +202,10 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
     case 1: // A3I5
         {
             vramaddr += ((t * width) + s);
-            u8 pixel = GPU.ReadVRAMFlat_Texture<u8>(vramaddr);
+            u8 pixel = ReadTexture<u8>(vramaddr);
 
             texpal <<= 4;
-            *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + ((pixel&0x1F)<<1));
+            *color = ReadTexPal<u16>(texpal + ((pixel&0x1F)<<1));
             *alpha = ((pixel >> 3) & 0x1C) + (pixel >> 6);
         }
         break;
@@ -207,12 +213,12 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
     case 2: // 4-color
         {
             vramaddr += (((t * width) + s) >> 2);
-            u8 pixel = GPU.ReadVRAMFlat_Texture<u8>(vramaddr);
+            u8 pixel = ReadTexture<u8>(vramaddr);
             pixel >>= ((s & 0x3) << 1);
             pixel &= 0x3;
 
             texpal <<= 3;
-            *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + (pixel<<1));
+            *color = ReadTexPal<u16>(texpal + (pixel<<1));
             *alpha = (pixel==0) ? alpha0 : 31;
         }
         break;
@@ -220,12 +226,12 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
     case 3: // 16-color
         {
             vramaddr += (((t * width) + s) >> 1);
-            u8 pixel = GPU.ReadVRAMFlat_Texture<u8>(vramaddr);
+            u8 pixel = ReadTexture<u8>(vramaddr);
             if (s & 0x1) pixel >>= 4;
             else         pixel &= 0xF;
 
             texpal <<= 4;
-            *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + (pixel<<1));
+            *color = ReadTexPal<u16>(texpal + (pixel<<1));
             *alpha = (pixel==0) ? alpha0 : 31;
         }
         break;
@@ -233,10 +239,10 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
     case 4: // 256-color
         {
             vramaddr += ((t * width) + s);
-            u8 pixel = GPU.ReadVRAMFlat_Texture<u8>(vramaddr);
+            u8 pixel = ReadTexture<u8>(vramaddr);
 
             texpal <<= 4;
-            *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + (pixel<<1));
+            *color = ReadTexPal<u16>(texpal + (pixel<<1));
             *alpha = (pixel==0) ? alpha0 : 31;
         }
         break;
@@ -256,31 +262,31 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
                 val = 0;
             else
             {
-                val = GPU.ReadVRAMFlat_Texture<u8>(vramaddr);
+                val = ReadTexture<u8>(vramaddr);
                 val >>= (2 * (s & 0x3));
             }
 
-            u16 palinfo = GPU.ReadVRAMFlat_Texture<u16>(slot1addr);
+            u16 palinfo = ReadTexture<u16>(slot1addr);
             u32 paloffset = (palinfo & 0x3FFF) << 2;
             texpal <<= 4;
 
             switch (val & 0x3)
             {
             case 0:
-                *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset);
+                *color = ReadTexPal<u16>(texpal + paloffset);
                 *alpha = 31;
                 break;
 
             case 1:
-                *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset + 2);
+                *color = ReadTexPal<u16>(texpal + paloffset + 2);
                 *alpha = 31;
                 break;
 
             case 2:
                 if ((palinfo >> 14) == 1)
                 {
-                    u16 color0 = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset);
-                    u16 color1 = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset + 2);
+                    u16 color0 = ReadTexPal<u16>(texpal + paloffset);
+                    u16 color1 = ReadTexPal<u16>(texpal + paloffset + 2);
 
                     u32 r0 = color0 & 0x001F;
                     u32 g0 = color0 & 0x03E0;
@@ -297,8 +303,8 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
                 }
                 else if ((palinfo >> 14) == 3)
                 {
-                    u16 color0 = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset);
-                    u16 color1 = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset + 2);
+                    u16 color0 = ReadTexPal<u16>(texpal + paloffset);
+                    u16 color1 = ReadTexPal<u16>(texpal + paloffset + 2);
 
                     u32 r0 = color0 & 0x001F;
                     u32 g0 = color0 & 0x03E0;
@@ -314,20 +320,20 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
                     *color = r | g | b;
                 }
                 else
-                    *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset + 4);
+                    *color = ReadTexPal<u16>(texpal + paloffset + 4);
                 *alpha = 31;
                 break;
 
             case 3:
                 if ((palinfo >> 14) == 2)
                 {
-                    *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset + 6);
+                    *color = ReadTexPal<u16>(texpal + paloffset + 6);
                     *alpha = 31;
                 }
                 else if ((palinfo >> 14) == 3)
                 {
-                    u16 color0 = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset);
-                    u16 color1 = GPU.ReadVRAMFlat_TexPal<u16>(texpal + paloffset + 2);
+                    u16 color0 = ReadTexPal<u16>(texpal + paloffset);
+                    u16 color1 = ReadTexPal<u16>(texpal + paloffset + 2);
 
                     u32 r0 = color0 & 0x001F;
                     u32 g0 = color0 & 0x03E0;
@@ -356,10 +362,10 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
     case 6: // A5I3
         {
             vramaddr += ((t * width) + s);
-            u8 pixel = GPU.ReadVRAMFlat_Texture<u8>(vramaddr);
+            u8 pixel = ReadTexture<u8>(vramaddr);
 
             texpal <<= 4;
-            *color = GPU.ReadVRAMFlat_TexPal<u16>(texpal + ((pixel&0x7)<<1));
+            *color = ReadTexPal<u16>(texpal + ((pixel&0x7)<<1));
             *alpha = (pixel >> 3);
         }
         break;
@@ -367,7 +373,7 @@ void SoftRenderer3D::TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16*
     case 7: // direct color
         {
             vramaddr += (((t * width) + s) << 1);
-            *color = GPU.ReadVRAMFlat_Texture<u16>(vramaddr);
+            *color = ReadTexture<u16>(vramaddr);
             *alpha = (*color & 0x8000) ? 31 : 0;
         }
         break;
@@ -605,7 +611,7 @@ void SoftRenderer3D::SetupPolygonLeftEdge(SoftRenderer3D::RendererPolygon* rp, s
 {
     Polygon* polygon = rp->PolyData;
 
-    while (y >= polygon->Vertices[rp->NextVL]->FinalPosition[1] && rp->CurVL != polygon->VBottom)
+    while (y >= rp->Position[rp->NextVL][1] && rp->CurVL != rp->VBottom)
     {
         rp->CurVL = rp->NextVL;
 
@@ -623,8 +629,8 @@ void SoftRenderer3D::SetupPolygonLeftEdge(SoftRenderer3D::RendererPolygon* rp, s
         }
     }
 
-    rp->XL = rp->SlopeL.Setup(polygon->Vertices[rp->CurVL]->FinalPosition[0], polygon->Vertices[rp->NextVL]->FinalPosition[0],
-                              polygon->Vertices[rp->CurVL]->FinalPosition[1], polygon->Vertices[rp->NextVL]->FinalPosition[1],
+    rp->XL = rp->SlopeL.Setup(rp->Position[rp->CurVL][0], rp->Position[rp->NextVL][0],
+                              rp->Position[rp->CurVL][1], rp->Position[rp->NextVL][1],
                               polygon->FinalW[rp->CurVL], polygon->FinalW[rp->NextVL], y, polygon->WBuffer);
 }
 
@@ -632,7 +638,7 @@ void SoftRenderer3D::SetupPolygonRightEdge(SoftRenderer3D::RendererPolygon* rp,
 {
     Polygon* polygon = rp->PolyData;
 
-    while (y >= polygon->Vertices[rp->NextVR]->FinalPosition[1] && rp->CurVR != polygon->VBottom)
+    while (y >= rp->Position[rp->NextVR][1] && rp->CurVR != rp->VBottom)
     {
         rp->CurVR = rp->NextVR;
 
@@ -650,12 +656,12 @@ void SoftRenderer3D::SetupPolygonRightEdge(SoftRenderer3D::RendererPolygon* rp,
         }
     }
 
-    rp->XR = rp->SlopeR.Setup(polygon->Vertices[rp->CurVR]->FinalPosition[0], polygon->Vertices[rp->NextVR]->FinalPosition[0],
-                              polygon->Vertices[rp->CurVR]->FinalPosition[1], polygon->Vertices[rp->NextVR]->FinalPosition[1],
+    rp->XR = rp->SlopeR.Setup(rp->Position[rp->CurVR][0], rp->Position[rp->NextVR][0],
+                              rp->Position[rp->CurVR][1], rp->Position[rp->NextVR][1],
                               polygon->FinalW[rp->CurVR], polygon->FinalW[rp->NextVR], y, polygon->WBuffer);
 }
 
-void SoftRenderer3D::SetupPolygon(SoftRenderer3D::RendererPolygon* rp, Polygon* polygon) const
+void SoftRenderer3D::SetupPolygon(SoftRenderer3D::RendererPolygon* rp, Polygon* polygon, s32 ystart) const
 {
     u32 nverts = polygon->NumVertices;
 
@@ -664,6 +670,55 @@ void SoftRenderer3D::SetupPolygon(SoftRenderer3D::RendererPolygon* rp, Polygon*
 
     rp->PolyData = polygon;
 
+    if (ScaleFactor == 1)
+    {
+        for (u32 i = 0; i < nverts; i++)
+        {
+            rp->Position[i][0] = polygon->Vertices[i]->FinalPosition[0];
+            rp->Position[i][1] = polygon->Vertices[i]->FinalPosition[1];
+        }
+    }
+    else
+    {
+        for (u32 i = 0; i < nverts; i++)
+        {
+            Vertex* vtx = polygon->Vertices[i];
+            if (HiresCoordinates)
+            {
+                rp->Position[i][0] = (vtx->HiresPosition[0] * ScaleFactor) >> 4;
+                rp->Position[i][1] = (vtx->HiresPosition[1] * ScaleFactor) >> 4;
+            }
+            else
+            {
+                rp->Position[i][0] = vtx->FinalPosition[0] * ScaleFactor;
+                rp->Position[i][1] = vtx->FinalPosition[1] * ScaleFactor;
+            }
+        }
+
+        // hi-res coordinates may not be ordered the same way as the native ones,
+        // so the bounds need to be determined again, the same way GPU3D does
+        ytop = ScreenHeight; ybot = 0;
+        s32 xbot = 0;
+        for (u32 i = 0; i < nverts; i++)
+        {
+            if (rp->Position[i][1] < ytop)
+            {
+                ytop = rp->Position[i][1];
+                vtop = i;
+            }
+            if (rp->Position[i][1] > ybot || (rp->Position[i][1] == ybot && rp->Position[i][0] > xbot))
+            {
+                xbot = rp->Position[i][0];
+                ybot = rp->Position[i][1];
+                vbot = i;
+            }
+        }
+        if (ybot > ScreenHeight) ybot = ScreenHeight;
+    }
+
+    rp->VTop = vtop; rp->VBottom = vbot;
+    rp->YTop = ytop; rp->YBottom = ybot;
+
     rp->CurVL = vtop;
     rp->CurVR = vtop;
 
@@ -688,27 +743,49 @@ void SoftRenderer3D::SetupPolygon(SoftRenderer3D::RendererPolygon* rp, Polygon*
         int i;
 
         i = 1;
-        if (polygon->Vertices[i]->FinalPosition[0] < polygon->Vertices[vtop]->FinalPosition[0]) vtop = i;
-        if (polygon->Vertices[i]->FinalPosition[0] > polygon->Vertices[vbot]->FinalPosition[0]) vbot = i;
+        if (rp->Position[i][0] < rp->Position[vtop][0]) vtop = i;
+        if (rp->Position[i][0] > rp->Position[vbot][0]) vbot = i;
 
         i = nverts - 1;
-        if (polygon->Vertices[i]->FinalPosition[0] < polygon->Vertices[vtop]->FinalPosition[0]) vtop = i;
-        if (polygon->Vertices[i]->FinalPosition[0] > polygon->Vertices[vbot]->FinalPosition[0]) vbot = i;
+        if (rp->Position[i][0] < rp->Position[vtop][0]) vtop = i;
+        if (rp->Position[i][0] > rp->Position[vbot][0]) vbot = i;
 
         rp->CurVL = vtop; rp->NextVL = vtop;
         rp->CurVR = vbot; rp->NextVR = vbot;
 
-        rp->XL = rp->SlopeL.SetupDummy(polygon->Vertices[rp->CurVL]->FinalPosition[0], polygon->WBuffer);
-        rp->XR = rp->SlopeR.SetupDummy(polygon->Vertices[rp->CurVR]->FinalPosition[0], polygon->WBuffer);
+        rp->XL = rp->SlopeL.SetupDummy(rp->Position[rp->CurVL][0], polygon->WBuffer);
+        rp->XR = rp->SlopeR.SetupDummy(rp->Position[rp->CurVR][0], polygon->WBuffer);
     }
     else
     {
-        SetupPolygonLeftEdge(rp, ytop);
-        SetupPolygonRightEdge(rp, ytop);
+        // when rendering a band that starts below the top of the polygon,
+        // the edges are set up as if all the lines above had been stepped through
+        if (ystart < ytop) ystart = ytop;
+        SetupPolygonLeftEdge(rp, ystart);
+        SetupPolygonRightEdge(rp, ystart);
     }
 }
 
-void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
+void SoftRenderer3D::SeedBand(RenderBand& band)
+{
+    // take whatever part of the stencil state this band hasn't set up itself yet
+    // from the end of the band above
+    RenderBand& above = *band.Above;
+    Platform::Semaphore_Wait(above.Sema_Final);
+
+    if (!band.Started)
+        band.PrevIsShadowMask = above.PrevIsShadowMask;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (band.StencilCleared & (1 << i)) continue;
+        std::copy_n(&above.StencilBuffer[ScreenWidth * i], ScreenWidth, &band.StencilBuffer[ScreenWidth * i]);
+    }
+
+    band.SeedPending = false;
+}
+
+void SoftRenderer3D::RenderShadowMaskScanline(RenderBand& band, RendererPolygon* rp, s32 y)
 {
     Polygon* polygon = rp->PolyData;
 
@@ -726,25 +803,35 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
     else
         fnDepthTest = DepthTest_LessThan;
 
-    if (!PrevIsShadowMask)
-        memset(&StencilBuffer[256 * (y&0x1)], 0, 256);
+    u8* stencilbuf = &band.StencilBuffer[ScreenWidth * (y&0x1)];
+    if (band.SeedPending &&
+        (!band.Started || (band.PrevIsShadowMask && !(band.StencilCleared & (1 << (y&0x1))))))
+        SeedBand(band);
 
-    PrevIsShadowMask = true;
+    if (!band.PrevIsShadowMask)
+    {
+        memset(stencilbuf, 0, ScreenWidth);
+        band.StencilCleared |= (1 << (y&0x1));
+    }
+
+    band.PrevIsShadowMask = true;
+    band.Started = true;
 
-    if (polygon->YTop != polygon->YBottom)
+    if (rp->YTop != rp->YBottom)
     {
-        if (y >= polygon->Vertices[rp->NextVL]->FinalPosition[1] && rp->CurVL != polygon->VBottom)
+        if (y >= rp->Position[rp->NextVL][1] && rp->CurVL != rp->VBottom)
         {
             SetupPolygonLeftEdge(rp, y);
         }
 
-        if (y >= polygon->Vertices[rp->NextVR]->FinalPosition[1] && rp->CurVR != polygon->VBottom)
+        if (y >= rp->Position[rp->NextVR][1] && rp->CurVR != rp->VBottom)
         {
             SetupPolygonRightEdge(rp, y);
         }
     }
 
     Vertex *vlcur, *vlnext, *vrcur, *vrnext;
+    s32 xlnext, xrnext;
     s32 xstart, xend;
     bool l_filledge, r_filledge;
     s32 l_edgelen, r_edgelen;
@@ -773,6 +860,8 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         vlnext = polygon->Vertices[rp->NextVR];
         vrcur = polygon->Vertices[rp->CurVL];
         vrnext = polygon->Vertices[rp->NextVL];
+        xlnext = rp->Position[rp->NextVR][0];
+        xrnext = rp->Position[rp->NextVL][0];
 
         interp_start = &rp->SlopeR.Interp;
         interp_end = &rp->SlopeL.Interp;
@@ -793,10 +882,10 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         else
         {
             l_filledge = (rp->SlopeR.Negative || !rp->SlopeR.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (xlnext != xrnext);
             r_filledge = (!rp->SlopeL.Negative && rp->SlopeL.XMajor)
                 || (!(rp->SlopeL.Negative && rp->SlopeL.XMajor) && rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (xlnext != xrnext);
         }
     }
     else
@@ -805,6 +894,8 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         vlnext = polygon->Vertices[rp->NextVL];
         vrcur = polygon->Vertices[rp->CurVR];
         vrnext = polygon->Vertices[rp->NextVR];
+        xlnext = rp->Position[rp->NextVL][0];
+        xrnext = rp->Position[rp->NextVR][0];
 
         interp_start = &rp->SlopeL.Interp;
         interp_end = &rp->SlopeR.Interp;
@@ -821,10 +912,10 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         else
         {
             l_filledge = ((rp->SlopeL.Negative || !rp->SlopeL.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]))
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (xlnext != xrnext))
                 || (rp->SlopeL.Increment == rp->SlopeR.Increment) && (xstart+l_edgelen == xend+1);
             r_filledge = (!rp->SlopeR.Negative && rp->SlopeR.XMajor) || (rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (xlnext != xrnext);
         }
     }
 
@@ -839,8 +930,8 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
     // in wireframe mode, there are special rules for equal Z (TODO)
 
     int yedge = 0;
-    if (y == polygon->YTop)           yedge = 0x4;
-    else if (y == polygon->YBottom-1) yedge = 0x8;
+    if (y == rp->YTop)           yedge = 0x4;
+    else if (y == rp->YBottom-1) yedge = 0x8;
     int edge;
 
     s32 x = xstart;
@@ -856,7 +947,7 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
     edge = yedge | 0x1;
     xlimit = xstart+l_edgelen;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
 
     if (!l_filledge) x = xlimit;
     else
@@ -870,13 +961,13 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         u32 dstattr = AttrBuffer[pixeladdr];
 
         if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
-            StencilBuffer[256*(y&0x1) + x] = 1;
+            stencilbuf[x] = 1;
 
         if (dstattr & 0xF)
         {
             pixeladdr += BufferSize;
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, AttrBuffer[pixeladdr]))
-                StencilBuffer[256*(y&0x1) + x] |= 0x2;
+                stencilbuf[x] |= 0x2;
         }
     }
 
@@ -884,7 +975,7 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
     edge = yedge;
     xlimit = xend-r_edgelen+1;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
     if (wireframe && !edge) x = std::max(x, xlimit);
     else for (; x < xlimit; x++)
     {
@@ -896,20 +987,20 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         u32 dstattr = AttrBuffer[pixeladdr];
 
         if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
-            StencilBuffer[256*(y&0x1) + x] = 1;
+            stencilbuf[x] = 1;
 
         if (dstattr & 0xF)
         {
             pixeladdr += BufferSize;
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, AttrBuffer[pixeladdr]))
-                StencilBuffer[256*(y&0x1) + x] |= 0x2;
+                stencilbuf[x] |= 0x2;
         }
     }
 
     // part 3: right edge
     edge = yedge | 0x2;
     xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
 
     if (r_filledge)
     for (; x < xlimit; x++)
@@ -922,13 +1013,13 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
         u32 dstattr = AttrBuffer[pixeladdr];
 
         if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
-            StencilBuffer[256*(y&0x1) + x] = 1;
+            stencilbuf[x] = 1;
 
         if (dstattr & 0xF)
         {
             pixeladdr += BufferSize;
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, AttrBuffer[pixeladdr]))
-                StencilBuffer[256*(y&0x1) + x] |= 0x2;
+                stencilbuf[x] |= 0x2;
         }
     }
 
@@ -936,7 +1027,7 @@ void SoftRenderer3D::RenderShadowMaskScanline(RendererPolygon* rp, s32 y)
     rp->XR = rp->SlopeR.Step();
 }
 
-void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
+void SoftRenderer3D::RenderPolygonScanline(RenderBand& band, RendererPolygon* rp, s32 y)
 {
     Polygon* polygon = rp->PolyData;
 
@@ -954,22 +1045,28 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
     else
         fnDepthTest = DepthTest_LessThan;
 
-    PrevIsShadowMask = false;
+    u8* stencilbuf = &band.StencilBuffer[ScreenWidth * (y&0x1)];
+    if (band.SeedPending && polygon->IsShadow && !(band.StencilCleared & (1 << (y&0x1))))
+        SeedBand(band);
+
+    band.PrevIsShadowMask = false;
+    band.Started = true;
 
-    if (polygon->YTop != polygon->YBottom)
+    if (rp->YTop != rp->YBottom)
     {
-        if (y >= polygon->Vertices[rp->NextVL]->FinalPosition[1] && rp->CurVL != polygon->VBottom)
+        if (y >= rp->Position[rp->NextVL][1] && rp->CurVL != rp->VBottom)
         {
             SetupPolygonLeftEdge(rp, y);
         }
 
-        if (y >= polygon->Vertices[rp->NextVR]->FinalPosition[1] && rp->CurVR != polygon->VBottom)
+        if (y >= rp->Position[rp->NextVR][1] && rp->CurVR != rp->VBottom)
         {
             SetupPolygonRightEdge(rp, y);
         }
     }
 
     Vertex *vlcur, *vlnext, *vrcur, *vrnext;
+    s32 xlnext, xrnext;
     s32 xstart, xend;
     bool l_filledge, r_filledge;
     s32 l_edgelen, r_edgelen;
@@ -1002,6 +1099,8 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         vlnext = polygon->Vertices[rp->NextVR];
         vrcur = polygon->Vertices[rp->CurVL];
         vrnext = polygon->Vertices[rp->NextVL];
+        xlnext = rp->Position[rp->NextVR][0];
+        xrnext = rp->Position[rp->NextVL][0];
 
         interp_start = &rp->SlopeR.Interp;
         interp_end = &rp->SlopeL.Interp;
@@ -1028,10 +1127,10 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         else
         {
             l_filledge = (rp->SlopeR.Negative || !rp->SlopeR.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (xlnext != xrnext);
             r_filledge = (!rp->SlopeL.Negative && rp->SlopeL.XMajor)
                 || (!(rp->SlopeL.Negative && rp->SlopeL.XMajor) && rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (xlnext != xrnext);
         }
     }
     else
@@ -1040,6 +1139,8 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         vlnext = polygon->Vertices[rp->NextVL];
         vrcur = polygon->Vertices[rp->CurVR];
         vrnext = polygon->Vertices[rp->NextVR];
+        xlnext = rp->Position[rp->NextVL][0];
+        xrnext = rp->Position[rp->NextVR][0];
 
         interp_start = &rp->SlopeL.Interp;
         interp_end = &rp->SlopeR.Interp;
@@ -1063,10 +1164,10 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         else
         {
             l_filledge = ((rp->SlopeL.Negative || !rp->SlopeL.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]))
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (xlnext != xrnext))
                 || (rp->SlopeL.Increment == rp->SlopeR.Increment) && (xstart+l_edgelen == xend+1);
             r_filledge = (!rp->SlopeR.Negative && rp->SlopeR.XMajor) || (rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (xlnext != xrnext);
         }
     }
 
@@ -1089,8 +1190,8 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
     // in wireframe mode, there are special rules for equal Z (TODO)
 
     int yedge = 0;
-    if (y == polygon->YTop)           yedge = 0x4;
-    else if (y == polygon->YBottom-1) yedge = 0x8;
+    if (y == rp->YTop)           yedge = 0x4;
+    else if (y == rp->YBottom-1) yedge = 0x8;
     int edge;
 
     s32 x = xstart;
@@ -1105,7 +1206,7 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
     edge = yedge | 0x1;
     xlimit = xstart+l_edgelen;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
     if (l_edgecov & (1<<31))
     {
         xcov = (l_edgecov >> 12) & 0x3FF;
@@ -1122,7 +1223,7 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         // check stencil buffer for shadows
         if (polygon->IsShadow)
         {
-            u8 stencil = StencilBuffer[256*(y&0x1) + x];
+            u8 stencil = stencilbuf[x];
             if (!stencil)
                 continue;
             if (!(stencil & 0x1))
@@ -1206,7 +1307,7 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
     edge = yedge;
     xlimit = xend-r_edgelen+1;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
 
     if (wireframe && !edge) x = std::max(x, xlimit);
     else
@@ -1218,7 +1319,7 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         // check stencil buffer for shadows
         if (polygon->IsShadow)
         {
-            u8 stencil = StencilBuffer[256*(y&0x1) + x];
+            u8 stencil = stencilbuf[x];
             if (!stencil)
                 continue;
             if (!(stencil & 0x1))
@@ -1294,7 +1395,7 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
     // part 3: right edge
     edge = yedge | 0x2;
     xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
     if (r_edgecov & (1<<31))
     {
         xcov = (r_edgecov >> 12) & 0x3FF;
@@ -1310,7 +1411,7 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
         // check stencil buffer for shadows
         if (polygon->IsShadow)
         {
-            u8 stencil = StencilBuffer[256*(y&0x1) + x];
+            u8 stencil = stencilbuf[x];
             if (!stencil)
                 continue;
             if (!(stencil & 0x1))
@@ -1394,19 +1495,70 @@ void SoftRenderer3D::RenderPolygonScanline(RendererPolygon* rp, s32 y)
     rp->XR = rp->SlopeR.Step();
 }
 
-void SoftRenderer3D::RenderScanline(s32 y, int npolys)
+void SoftRenderer3D::BinPolygons(RenderBand& band, int npolys)
 {
+    // sort the polygons into bins of BinHeight scanlines, keeping their order
+    // this way, every scanline only goes through the polygons that may cover it,
+    // and scanlines no polygon reaches are skipped altogether
+
+    u32* binstart = band.BinStart.data();
+    std::fill(binstart, binstart + band.NumBins + 1, 0);
+
+    s32 ylast = band.YEnd - 1;
+    for (int i = 0; i < npolys; i++)
+    {
+        RendererPolygon* rp = &band.PolygonList[i];
+        s32 ystart = std::max(rp->YTop, band.YStart);
+        s32 yend = std::min(std::max(rp->YBottom - 1, rp->YTop), ylast);
+        if (ystart > yend) continue;
+
+        s32 b0 = (ystart / BinHeight) - band.FirstBin;
+        s32 b1 = (yend / BinHeight) - band.FirstBin;
+        for (s32 b = b0; b <= b1; b++)
+            binstart[b+1]++;
+    }
+
+    for (s32 b = 0; b < band.NumBins; b++)
+        binstart[b+1] += binstart[b];
+
+    if (band.BinPolygons.size() < binstart[band.NumBins])
+        band.BinPolygons.resize(binstart[band.NumBins]);
+
+    u32* binfill = band.BinFill.data();
+    std::copy(binstart, binstart + band.NumBins, binfill);
+    u16* binpolys = band.BinPolygons.data();
+
     for (int i = 0; i < npolys; i++)
     {
-        RendererPolygon* rp = &PolygonList[i];
+        RendererPolygon* rp = &band.PolygonList[i];
+        s32 ystart = std::max(rp->YTop, band.YStart);
+        s32 yend = std::min(std::max(rp->YBottom - 1, rp->YTop), ylast);
+        if (ystart > yend) continue;
+
+        s32 b0 = (ystart / BinHeight) - band.FirstBin;
+        s32 b1 = (yend / BinHeight) - band.FirstBin;
+        for (s32 b = b0; b <= b1; b++)
+            binpolys[binfill[b]++] = i;
+    }
+}
+
+void SoftRenderer3D::RenderScanline(RenderBand& band, s32 y)
+{
+    s32 bin = (y / BinHeight) - band.FirstBin;
+    u32 start = band.BinStart[bin];
+    u32 end = band.BinStart[bin+1];
+
+    for (u32 i = start; i < end; i++)
+    {
+        RendererPolygon* rp = &band.PolygonList[band.BinPolygons[i]];
         Polygon* polygon = rp->PolyData;
 
-        if (y >= polygon->YTop && (y < polygon->YBottom || (y == polygon->YTop && polygon->YBottom == polygon->YTop)))
+        if (y >= rp->YTop && (y < rp->YBottom || (y == rp->YTop && rp->YBottom == rp->YTop)))
         {
             if (polygon->IsShadowMask)
-                RenderShadowMaskScanline(rp, y);
+                RenderShadowMaskScanline(band, rp, y);
             else
-                RenderPolygonScanline(rp, y);
+                RenderPolygonScanline(band, rp, y);
         }
     }
 }
@@ -1461,7 +1613,7 @@ void SoftRenderer3D::ScanlineFinalPass(s32 y)
         // edge marking
         // only applied to topmost pixels
 
-        for (int x = 0; x < 256; x++)
+        for (int x = 0; x < ScreenWidth; x++)
         {
             u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
 
@@ -1509,7 +1661,7 @@ void SoftRenderer3D::ScanlineFinalPass(s32 y)
         u32 fogB = (GPU3D.RenderFogColor >> 9) & 0x3E; if (fogB) fogB++;
         u32 fogA = (GPU3D.RenderFogColor >> 16) & 0x1F;
 
-        for (int x = 0; x < 256; x++)
+        for (int x = 0; x < ScreenWidth; x++)
         {
             u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
             u32 density, srccolor, srcR, srcG, srcB, srcA;
@@ -1574,7 +1726,7 @@ void SoftRenderer3D::ScanlineFinalPass(s32 y)
         // edges were flagged and their coverages calculated during rendering
         // this is where such edge pixels are blended with the pixels underneath
 
-        for (int x = 0; x < 256; x++)
+        for (int x = 0; x < ScreenWidth; x++)
         {
             u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
 
@@ -1634,17 +1786,17 @@ void SoftRenderer3D::ClearBuffers()
         AttrBuffer[x] = polyid;
     }
 
-    for (int x = ScanlineWidth; x < ScanlineWidth*193; x+=ScanlineWidth)
+    for (int x = ScanlineWidth; x < ScanlineWidth*(NumScanlines-1); x+=ScanlineWidth)
     {
         ColorBuffer[x] = 0;
         DepthBuffer[x] = clearz;
         AttrBuffer[x] = polyid;
-        ColorBuffer[x+257] = 0;
-        DepthBuffer[x+257] = clearz;
-        AttrBuffer[x+257] = polyid;
+        ColorBuffer[x+ScanlineWidth-1] = 0;
+        DepthBuffer[x+ScanlineWidth-1] = clearz;
+        AttrBuffer[x+ScanlineWidth-1] = polyid;
     }
 
-    for (int x = ScanlineWidth*193; x < ScanlineWidth*194; x++)
+    for (int x = ScanlineWidth*(NumScanlines-1); x < ScanlineWidth*NumScanlines; x++)
     {
         ColorBuffer[x] = 0;
         DepthBuffer[x] = clearz;
@@ -1658,12 +1810,17 @@ void SoftRenderer3D::ClearBuffers()
         u8 xoff = (GPU3D.RenderClearAttr2 >> 16) & 0xFF;
         u8 yoff = (GPU3D.RenderClearAttr2 >> 24) & 0xFF;
 
-        for (int y = 0; y < ScanlineWidth*192; y+=ScanlineWidth)
+        // when upscaling, the clear bitmap is simply stretched
+        for (int y = 0; y < ScreenHeight; y++)
         {
+            u8 ybmp = yoff + (y / ScaleFactor);
+            u32 pixeladdr = FirstPixelOffset + (y * ScanlineWidth);
+
             for (int x = 0; x < 256; x++)
             {
-                u16 val2 = GPU.ReadVRAMFlat_Texture<u16>(0x40000 + (yoff << 9) + (xoff << 1));
-                u16 val3 = GPU.ReadVRAMFlat_Texture<u16>(0x60000 + (yoff << 9) + (xoff << 1));
+                u8 xbmp = xoff + x;
+                u16 val2 = ReadTexture<u16>(0x40000 + (ybmp << 9) + (xbmp << 1));
+                u16 val3 = ReadTexture<u16>(0x60000 + (ybmp << 9) + (xbmp << 1));
 
                 // TODO: confirm color conversion
                 u32 r = (val2 << 1) & 0x3E; if (r) r++;
@@ -1674,15 +1831,13 @@ void SoftRenderer3D::ClearBuffers()
 
                 u32 z = ((val3 & 0x7FFF) * 0x200) + 0x1FF;
 
-                u32 pixeladdr = FirstPixelOffset + y + x;
-                ColorBuffer[pixeladdr] = color;
-                DepthBuffer[pixeladdr] = z;
-                AttrBuffer[pixeladdr] = polyid | (val3 & 0x8000);
-
-                xoff++;
+                for (int i = 0; i < ScaleFactor; i++, pixeladdr++)
+                {
+                    ColorBuffer[pixeladdr] = color;
+                    DepthBuffer[pixeladdr] = z;
+                    AttrBuffer[pixeladdr] = polyid | (val3 & 0x8000);
+                }
             }
-
-            yoff++;
         }
     }
     else
@@ -1696,9 +1851,9 @@ void SoftRenderer3D::ClearBuffers()
 
         polyid |= (GPU3D.RenderClearAttr1 & 0x8000);
 
-        for (int y = 0; y < ScanlineWidth*192; y+=ScanlineWidth)
+        for (int y = 0; y < ScanlineWidth*ScreenHeight; y+=ScanlineWidth)
         {
-            for (int x = 0; x < 256; x++)
+            for (int x = 0; x < ScreenWidth; x++)
             {
                 u32 pixeladdr = FirstPixelOffset + y + x;
                 ColorBuffer[pixeladdr] = color;
@@ -1711,32 +1866,242 @@ void SoftRenderer3D::ClearBuffers()
 
 void SoftRenderer3D::RenderPolygons(bool threaded, Polygon** polygons, int npolys)
 {
+    if (Bands.size() > 1)
+    {
+        // upscaled rendering: every band is rasterized by its own thread
+        // the final pass can only start once all the bands are rasterized,
+        // as edge marking looks at the neighbouring scanlines
+
+        BandPolygons = polygons;
+        BandNumPolygons = npolys;
+        int nworkers = Bands.size() - 1;
+
+        // the first band picks up where the last one left off on the previous frame
+        Bands[0]->StencilBuffer = Bands.back()->StencilBuffer;
+        Bands[0]->PrevIsShadowMask = Bands.back()->PrevIsShadowMask;
+        for (auto& band : Bands)
+        {
+            band->SeedPending = (band->Above != nullptr);
+            band->Started = false;
+            band->StencilCleared = 0;
+            Platform::Semaphore_Reset(band->Sema_Final);
+        }
+
+        for (int phase = 0; phase < 2; phase++)
+        {
+            BandPhase = phase;
+            for (int i = 0; i < nworkers; i++)
+                Platform::Semaphore_Post(Sema_BandStart[i]);
+
+            if (phase == 0)
+                RenderBandPolygons(*Bands[0], polygons, npolys);
+            else
+                RenderBandFinalPass(*Bands[0]);
+
+            for (int i = 0; i < nworkers; i++)
+                Platform::Semaphore_Wait(Sema_BandDone);
+        }
+
+        if (threaded)
+            Platform::Semaphore_Post(Sema_ScanlineCount, 192);
+
+        return;
+    }
+
+    RenderBand& band = *Bands[0];
+
     int j = 0;
     for (int i = 0; i < npolys; i++)
     {
         if (polygons[i]->Degenerate) continue;
-        SetupPolygon(&PolygonList[j++], polygons[i]);
+        SetupPolygon(&band.PolygonList[j++], polygons[i], 0);
     }
 
-    RenderScanline(0, j);
+    BinPolygons(band, j);
+
+    RenderScanline(band, 0);
 
-    for (s32 y = 1; y < 192; y++)
+    for (s32 y = 1; y < ScreenHeight; y++)
     {
-        RenderScanline(y, j);
+        RenderScanline(band, y);
         ScanlineFinalPass(y-1);
 
-        if (threaded)
+        if (threaded && (y % ScaleFactor) == 0)
             // Notify the main thread that we're done with a scanline.
             Platform::Semaphore_Post(Sema_ScanlineCount);
     }
 
-    ScanlineFinalPass(191);
+    ScanlineFinalPass(ScreenHeight-1);
 
     if (threaded)
         // If this renderer is threaded, notify the main thread that we're done with the frame.
         Platform::Semaphore_Post(Sema_ScanlineCount);
 }
 
+void SoftRenderer3D::RenderBandPolygons(RenderBand& band, Polygon** polygons, int npolys)
+{
+    int j = 0;
+    for (int i = 0; i < npolys; i++)
+    {
+        if (polygons[i]->Degenerate) continue;
+
+        RendererPolygon* rp = &band.PolygonList[j];
+        SetupPolygon(rp, polygons[i], band.YStart);
+
+        // polygons that don't touch this band can be skipped entirely
+        s32 ylast = std::max(rp->YBottom - 1, rp->YTop);
+        if (rp->YTop >= band.YEnd || ylast < band.YStart)
+            continue;
+
+        j++;
+    }
+
+    BinPolygons(band, j);
+
+    for (s32 y = band.YStart; y < band.YEnd; y++)
+        RenderScanline(band, y);
+
+    if (band.Sema_Final)
+    {
+        // whatever this band didn't set up itself is passed on from the band above
+        if (band.SeedPending && (!band.Started || band.StencilCleared != 0x3))
+            SeedBand(band);
+
+        Platform::Semaphore_Post(band.Sema_Final);
+    }
+}
+
+void SoftRenderer3D::RenderBandFinalPass(RenderBand& band)
+{
+    for (s32 y = band.YStart; y < band.YEnd; y++)
+        ScanlineFinalPass(y);
+}
+
+void SoftRenderer3D::BandWorkerFunc(int num)
+{
+    RenderBand& band = *Bands[num + 1];
+
+    for (;;)
+    {
+        Platform::Semaphore_Wait(Sema_BandStart[num]);
+        if (!BandWorkersRunning) return;
+
+        if (BandPhase == 0)
+            RenderBandPolygons(band, BandPolygons, BandNumPolygons);
+        else
+            RenderBandFinalPass(band);
+
+        Platform::Semaphore_Post(Sema_BandDone);
+    }
+}
+
+void SoftRenderer3D::StartBandWorkers()
+{
+    int nworkers = Bands.size() - 1;
+    if (nworkers < 1) return;
+
+    for (int i = 0; i < (int)Bands.size(); i++)
+    {
+        Bands[i]->Above = (i > 0) ? Bands[i-1].get() : nullptr;
+        Bands[i]->Sema_Final = Platform::Semaphore_Create();
+    }
+
+    BandWorkersRunning = true;
+    for (int i = 0; i < nworkers; i++)
+    {
+        Sema_BandStart.push_back(Platform::Semaphore_Create());
+        BandWorkers.push_back(Platform::Thread_Create([this, i]() {
+            BandWorkerFunc(i);
+        }));
+    }
+}
+
+void SoftRenderer3D::StopBandWorkers()
+{
+    if (!BandWorkersRunning) return;
+
+    BandWorkersRunning = false;
+    for (Platform::Semaphore* sema : Sema_BandStart)
+        Platform::Semaphore_Post(sema);
+
+    for (Platform::Thread* thread : BandWorkers)
+    {
+        Platform::Thread_Wait(thread);
+        Platform::Thread_Free(thread);
+    }
+    for (Platform::Semaphore* sema : Sema_BandStart)
+        Platform::Semaphore_Free(sema);
+
+    BandWorkers.clear();
+    Sema_BandStart.clear();
+
+    for (auto& band : Bands)
+    {
+        Platform::Semaphore_Free(band->Sema_Final);
+        band->Sema_Final = nullptr;
+        band->Above = nullptr;
+    }
+}
+
+void SoftRenderer3D::SetupBuffers(int scale)
+{
+    StopBandWorkers();
+
+    ScaleFactor = scale;
+    ScreenWidth = 256 * scale;
+    ScreenHeight = 192 * scale;
+    ScanlineWidth = ScreenWidth + 2;
+    NumScanlines = ScreenHeight + 2;
+    BufferSize = ScanlineWidth * NumScanlines;
+    FirstPixelOffset = ScanlineWidth + 1;
+
+    ColorBuffer.assign(BufferSize * 2, 0);
+    DepthBuffer.assign(BufferSize * 2, 0);
+    AttrBuffer.assign(BufferSize * 2, 0);
+    HiresScrolledLine.assign(ScreenWidth, 0);
+
+    // at 1x, everything is rendered in one go, like it always was
+    // when upscaling, the work is split across as many threads as there are cores
+    int nbands = 1;
+    if (scale > 1)
+        nbands = std::clamp((int)std::thread::hardware_concurrency(), 1, 8);
+
+    Bands.clear();
+    for (int i = 0; i < nbands; i++)
+    {
+        auto band = std::make_unique<RenderBand>();
+        band->StencilBuffer.assign(ScreenWidth * 2, 0);
+        band->PrevIsShadowMask = false;
+        band->SeedPending = false;
+        band->Started = false;
+        band->StencilCleared = 0;
+        band->YStart = (ScreenHeight * i) / nbands;
+        band->YEnd = (ScreenHeight * (i+1)) / nbands;
+        band->FirstBin = band->YStart / BinHeight;
+        band->NumBins = ((band->YEnd - 1) / BinHeight) - band->FirstBin + 1;
+        band->BinStart.assign(band->NumBins + 1, 0);
+        band->BinFill.assign(band->NumBins, 0);
+        Bands.push_back(std::move(band));
+    }
+
+    StartBandWorkers();
+}
+
+void SoftRenderer3D::SetScaleFactor(int scale, bool hirescoords) noexcept
+{
+    scale = std::clamp(scale, 1, MaxScaleFactor);
+    HiresCoordinates = hirescoords;
+
+    if (scale == ScaleFactor)
+        return;
+
+    // the render thread must not be touching the buffers while they're reallocated
+    StopRenderThread();
+    SetupBuffers(scale);
+    SetupRenderThread();
+    EnableRenderThread();
+}
+
 void SoftRenderer3D::FinishRendering()
 {
     if (RenderThreadRunning.load(std::memory_order_relaxed) && !GPU3D.AbortFrame)
@@ -1745,11 +2110,28 @@ void SoftRenderer3D::FinishRendering()
 
 void SoftRenderer3D::RenderFrame()
 {
-    auto textureDirty = GPU.VRAMDirty_Texture.DeriveState(GPU.VRAMMap_Texture, GPU);
-    auto texPalDirty = GPU.VRAMDirty_TexPal.DeriveState(GPU.VRAMMap_TexPal, GPU);
+    NonStupidBitField<512*1024/VRAMDirtyGranularity> textureDirty;
+    NonStupidBitField<128*1024/VRAMDirtyGranularity> texPalDirty;
 
-    bool textureChanged = GPU.MakeVRAMFlat_TextureCoherent(textureDirty);
-    bool texPalChanged = GPU.MakeVRAMFlat_TexPalCoherent(texPalDirty);
+    bool textureChanged, texPalChanged;
+    if (RenderThreadRunning.load(std::memory_order_relaxed))
+    {
+        // the render thread keeps going while the game remaps and rewrites VRAM
+        // so it has to work off a copy
+        textureChanged = GPU.UpdateVRAMFlat_Texture(textureDirty);
+        texPalChanged = GPU.UpdateVRAMFlat_TexPal(texPalDirty);
+
+        for (int i = 0; i < 4; i++)
+            TexturePages[i] = &GPU.VRAMFlat_Texture[i << 17];
+        for (int i = 0; i < 8; i++)
+            TexPalPages[i] = &GPU.VRAMFlat_TexPal[i << 14];
+    }
+    else
+    {
+        // the frame is rendered right here, pages with only one bank mapped can be read in place
+        textureChanged = GPU.UpdateVRAMPages_Texture(textureDirty, TexturePages);
+        texPalChanged = GPU.UpdateVRAMPages_TexPal(texPalDirty, TexPalPages);
+    }
 
     FrameIdentical = !(textureChanged || texPalChanged) && GPU3D.RenderFrameIdentical;
 
@@ -1822,7 +2204,20 @@ u32* SoftRenderer3D::GetLine(int line)
             Platform::Semaphore_Wait(Sema_ScanlineCount);
     }
 
-    u32* rawline = &ColorBuffer[(line * ScanlineWidth) + FirstPixelOffset];
+    u32* rawline;
+    if (ScaleFactor == 1)
+        rawline = &ColorBuffer[(line * ScanlineWidth) + FirstPixelOffset];
+    else
+    {
+        // the native output (used for display capture) is point-sampled
+        // from the upscaled output
+        u32* hiresline = &ColorBuffer[(line * ScaleFactor * ScanlineWidth) + FirstPixelOffset];
+        for (int i = 0; i < 256; i++)
+            DownscaledLine[i] = hiresline[i * ScaleFactor];
+
+        rawline = DownscaledLine;
+    }
+
     u16 xpos = GPU3D.RenderXPos;
     if (xpos == 0)
         return rawline;
@@ -1849,4 +2244,43 @@ u32* SoftRenderer3D::GetLine(int line)
     return ScrolledLine;
 }
 
+u32* SoftRenderer3D::GetHiresLine(int line, int subline)
+{
+    u32* dst = HiresScrolledLine.data();
+
+    if (GPU3D.AbortFrame)
+    {
+        memset(dst, 0, ScreenWidth * sizeof(u32));
+        return dst;
+    }
+
+    u32* rawline = &ColorBuffer[(((line * ScaleFactor) + subline) * ScanlineWidth) + FirstPixelOffset];
+    u16 xpos = GPU3D.RenderXPos;
+    if (xpos == 0)
+        return rawline;
+
+    // apply X scroll, same as above but in upscaled pixels
+
+    int width = ScreenWidth;
+    int scroll = (xpos & 0x1FF) * ScaleFactor;
+    if (xpos & 0x100)
+    {
+        int i = 0, j = scroll;
+        for (; j < width*2; i++, j++)
+            dst[i] = 0;
+        for (j = 0; i < width; i++, j++)
+            dst[i] = rawline[j];
+    }
+    else
+    {
+        int i = 0, j = scroll;
+        for (; j < width; i++, j++)
+            dst[i] = rawline[j];
+        for (; i < width; i++)
+            dst[i] = 0;
+    }
+
+    return dst;
+}
+
 }
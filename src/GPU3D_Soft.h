@@ -23,6 +23,8 @@
 #include "Platform.h"
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <vector>
 
 namespace melonDS
 {
@@ -38,12 +40,22 @@ public:
     void SetThreaded(bool threaded) noexcept;
     [[nodiscard]] bool IsThreaded() const noexcept { return Threaded; }
 
+    // upscaling: the 3D scene is rasterized at 1x..4x the native resolution
+    // GetLine() still returns native 256-pixel lines (used for display capture)
+    void SetScaleFactor(int scale, bool hirescoords) noexcept;
+    [[nodiscard]] int GetScaleFactor() const noexcept { return ScaleFactor; }
+    static constexpr int MaxScaleFactor = 4;
+
     void RenderFrame() override;
     void FinishRendering() override;
     void RestartFrame() override;
 
     u32* GetLine(int line) override;
 
+    // returns one row of the upscaled output, for the given native line
+    // GetLine() must have been called for that line beforehand
+    u32* GetHiresLine(int line, int subline);
+
     void SetupRenderThread();
     void EnableRenderThread();
     void StopRenderThread();
@@ -131,6 +143,18 @@ private:
             this->x = x;
             if ((xdiff != 0) && ((!linear) || wbuffer))
             {
+                if (xdiff > 0x1FF)
+                {
+                    // spans this wide only occur when upscaling
+                    // the 32-bit path below would overflow
+                    u64 num = ((u64)x * w0n) << shift;
+                    u64 den = ((u64)x * w0d) + ((u64)(xdiff-x) * w1d);
+
+                    if (den == 0) yfactor = 0;
+                    else          yfactor = num / den;
+                    return;
+                }
+
                 u32 num = (x * w0n) << shift;
                 u32 den = (x * w0d) + ((xdiff-x) * w1d);
 
@@ -368,7 +392,7 @@ private:
             if (Negative) startx = xlen - startx;
             if (side)     startx = startx - *length + 1;
 
-            s32 startcov = (((startx << 10) + 0x1FF) * ylen) / xlen;
+            s32 startcov = (((s64)(startx << 10) + 0x1FF) * ylen) / xlen;
             *coverage = (1<<31) | ((startcov & 0x3FF) << 12) | (xcov_incr & 0x3FF);
 
             if constexpr (swapped) *length = 1;
@@ -442,39 +466,97 @@ private:
         u32 CurVL, CurVR;
         u32 NextVL, NextVR;
 
+        // vertex positions and bounds at the current render scale
+        // at 1x, these are the same as the polygon's
+        s32 Position[10][2];
+        u32 VTop, VBottom;
+        s32 YTop, YBottom;
+    };
+
+    // state that is private to one horizontal band of the screen
+    // when upscaling, each band is rasterized by a separate thread
+    struct RenderBand
+    {
+        RendererPolygon PolygonList[2048];
+        std::vector<u8> StencilBuffer;
+        bool PrevIsShadowMask;
+
+        // the stencil state carries over from one scanline to the next, so a band starts
+        // where the band above left off. that is only known once the band above is done,
+        // so it's only waited for if this band actually needs it
+        RenderBand* Above = nullptr;
+        Platform::Semaphore* Sema_Final = nullptr; // posted once the band's end state is final
+        bool SeedPending;
+        bool Started;       // a polygon was rendered, so PrevIsShadowMask is this band's own
+        u8 StencilCleared;  // stencil lines (by parity) that were cleared within this band
+
+        s32 YStart, YEnd;
+
+        // polygon indices for each group of BinHeight scanlines, in rendering order
+        s32 FirstBin, NumBins;
+        std::vector<u32> BinStart;
+        std::vector<u32> BinFill;
+        std::vector<u16> BinPolygons;
     };
 
-    RendererPolygon PolygonList[2048];
+    // scanlines covered by one polygon bin
+    static constexpr int BinHeight = 8;
+
+    template <typename T>
+    T ReadTexture(u32 addr) const
+    {
+        return *(T*)&TexturePages[(addr >> 17) & 0x3][addr & 0x1FFFF];
+    }
+    template <typename T>
+    T ReadTexPal(u32 addr) const
+    {
+        return *(T*)&TexPalPages[(addr >> 14) & 0x7][addr & 0x3FFF];
+    }
+
     void TextureLookup(u32 texparam, u32 texpal, s16 s, s16 t, u16* color, u8* alpha) const;
     u32 RenderPixel(const Polygon* polygon, u8 vr, u8 vg, u8 vb, s16 s, s16 t) const;
     void PlotTranslucentPixel(u32 pixeladdr, u32 color, u32 z, u32 polyattr, u32 shadow);
     void SetupPolygonLeftEdge(RendererPolygon* rp, s32 y) const;
     void SetupPolygonRightEdge(RendererPolygon* rp, s32 y) const;
-    void SetupPolygon(RendererPolygon* rp, Polygon* polygon) const;
-    void RenderShadowMaskScanline(RendererPolygon* rp, s32 y);
-    void RenderPolygonScanline(RendererPolygon* rp, s32 y);
-    void RenderScanline(s32 y, int npolys);
+    void SetupPolygon(RendererPolygon* rp, Polygon* polygon, s32 ystart) const;
+    void SeedBand(RenderBand& band);
+    void RenderShadowMaskScanline(RenderBand& band, RendererPolygon* rp, s32 y);
+    void RenderPolygonScanline(RenderBand& band, RendererPolygon* rp, s32 y);
+    void BinPolygons(RenderBand& band, int npolys);
+    void RenderScanline(RenderBand& band, s32 y);
     u32 CalculateFogDensity(u32 pixeladdr) const;
     void ScanlineFinalPass(s32 y);
     void ClearBuffers();
     void RenderPolygons(bool threaded, Polygon** polygons, int npolys);
+    void RenderBandPolygons(RenderBand& band, Polygon** polygons, int npolys);
+    void RenderBandFinalPass(RenderBand& band);
 
     void RenderThreadFunc();
 
-    // buffer dimensions are 258x194 to add a offscreen 1px border
+    void SetupBuffers(int scale);
+    void StartBandWorkers();
+    void StopBandWorkers();
+    void BandWorkerFunc(int num);
+
+    // buffer dimensions are 258x194 (at 1x) to add a offscreen 1px border
     // which simplifies edge marking tests
     // buffer is duplicated to keep track of the two topmost pixels
     // TODO: check if the hardware can accidentally plot pixels
     // offscreen in that border
 
-    static constexpr int ScanlineWidth = 258;
-    static constexpr int NumScanlines = 194;
-    static constexpr int BufferSize = ScanlineWidth * NumScanlines;
-    static constexpr int FirstPixelOffset = ScanlineWidth + 1;
+    int ScaleFactor = 1;
+    bool HiresCoordinates = false;
+
+    int ScreenWidth = 256;
+    int ScreenHeight = 192;
+    int ScanlineWidth = 258;
+    int NumScanlines = 194;
+    int BufferSize = 258 * 194;
+    int FirstPixelOffset = 258 + 1;
 
-    u32 ColorBuffer[BufferSize * 2];
-    u32 DepthBuffer[BufferSize * 2];
-    u32 AttrBuffer[BufferSize * 2];
+    std::vector<u32> ColorBuffer;
+    std::vector<u32> DepthBuffer;
+    std::vector<u32> AttrBuffer;
 
     // attribute buffer:
     // bit0-3: edge flags (left/right/top/bottom)
@@ -485,14 +567,29 @@ private:
     // bit22: translucent flag
     // bit24-29: polygon ID for opaque pixels
 
-    u8 StencilBuffer[256*2];
-    bool PrevIsShadowMask;
-
     bool Enabled;
 
     bool FrameIdentical;
 
+    // where texture and texture palette memory are read from for the current frame,
+    // per 128K/16K page, either the VRAM bank itself or GPU's flat copy
+    u8* TexturePages[4] {};
+    u8* TexPalPages[8] {};
+
     u32 ScrolledLine[256];
+    u32 DownscaledLine[256];
+    std::vector<u32> HiresScrolledLine;
+
+    // band 0 is rendered by whichever thread renders the frame,
+    // the other bands by worker threads (only used when upscaling)
+    std::vector<std::unique_ptr<RenderBand>> Bands;
+    std::vector<Platform::Thread*> BandWorkers;
+    std::atomic_bool BandWorkersRunning = false;
+    Polygon** BandPolygons = nullptr;
+    int BandNumPolygons = 0;
+    int BandPhase = 0;
+    std::vector<Platform::Semaphore*> Sema_BandStart;
+    Platform::Semaphore* Sema_BandDone = nullptr;
 
     // threading
 
@@ -94,11 +94,11 @@ public:
 
     bool Update(u8& clrBitmapDirty)
     {
-        auto textureDirty = GPU.VRAMDirty_Texture.DeriveState(GPU.VRAMMap_Texture, GPU);
-        auto texPalDirty = GPU.VRAMDirty_TexPal.DeriveState(GPU.VRAMMap_TexPal, GPU);
+        NonStupidBitField<512*1024/VRAMDirtyGranularity> textureDirty;
+        NonStupidBitField<128*1024/VRAMDirtyGranularity> texPalDirty;
 
-        bool textureChanged = GPU.MakeVRAMFlat_TextureCoherent(textureDirty);
-        bool texPalChanged = GPU.MakeVRAMFlat_TexPalCoherent(texPalDirty);
+        bool textureChanged = GPU.UpdateVRAMFlat_Texture(textureDirty);
+        bool texPalChanged = GPU.UpdateVRAMFlat_TexPal(texPalDirty);
 
         clrBitmapDirty = 0;
 
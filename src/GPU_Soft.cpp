@@ -54,6 +54,10 @@ void SoftRenderer::Reset()
     memset(Framebuffer[1][0], 0, len);
     memset(Framebuffer[1][1], 0, len);
 
+    for (int i = 0; i < 2; i++)
+        for (int j = 0; j < 2; j++)
+            std::fill(HiresFramebuffer[i][j].begin(), HiresFramebuffer[i][j].end(), 0);
+
     Rend2D_A->Reset();
     Rend2D_B->Reset();
     Rend3D->Reset();
@@ -67,6 +71,10 @@ void SoftRenderer::Stop()
     memset(Framebuffer[0][1], 0, len);
     memset(Framebuffer[1][0], 0, len);
     memset(Framebuffer[1][1], 0, len);
+
+    for (int i = 0; i < 2; i++)
+        for (int j = 0; j < 2; j++)
+            std::fill(HiresFramebuffer[i][j].begin(), HiresFramebuffer[i][j].end(), 0);
 }
 
 
@@ -89,13 +97,28 @@ void SoftRenderer::SetRenderSettings(RendererSettings& settings)
 {
     auto rend3d = dynamic_cast<SoftRenderer3D*>(Rend3D.get());
     rend3d->SetThreaded(settings.Threaded);
+    rend3d->SetScaleFactor(settings.SoftScaleFactor, settings.HiresCoordinates);
+
+    int scale = rend3d->GetScaleFactor();
+    if (scale != ScaleFactor)
+    {
+        ScaleFactor = scale;
+
+        size_t len = (scale > 1) ? (256 * 192 * scale * scale) : 0;
+        for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+                HiresFramebuffer[i][j].assign(len, 0);
+    }
 }
 
 
 void SoftRenderer::DrawScanline(u32 line)
 {
+    // the framebuffer line, which VCOUNT writes don't affect
+    u32 fbline = line;
+
     u32 *dstA, *dstB;
-    u32 dstoffset = 256 * line;
+    u32 dstoffset = 256 * fbline;
     if (GPU.ScreenSwap)
     {
         dstA = &Framebuffer[BackBuffer][0][dstoffset];
@@ -155,6 +178,63 @@ void SoftRenderer::DrawScanline(u32 line)
             dstB[i] = 0xFF000000;
         }
     }
+
+    if (ScaleFactor > 1)
+        DrawHiresScanline(fbline, dstA, dstB);
+}
+
+void SoftRenderer::DrawHiresScanline(u32 line, u32* dstA, u32* dstB)
+{
+    int width = 256 * ScaleFactor;
+    u32 dstoffset = width * ScaleFactor * line;
+    u32 *hiresA, *hiresB;
+    if (GPU.ScreenSwap)
+    {
+        hiresA = &HiresFramebuffer[BackBuffer][0][dstoffset];
+        hiresB = &HiresFramebuffer[BackBuffer][1][dstoffset];
+    }
+    else
+    {
+        hiresA = &HiresFramebuffer[BackBuffer][1][dstoffset];
+        hiresB = &HiresFramebuffer[BackBuffer][0][dstoffset];
+    }
+
+    // the 3D layer is the only one that has more detail when upscaled
+    // everything else is just stretched
+    u32 dispcnt = GPU.GPU2D_A.DispCnt;
+    bool hires3D = GPU.ScreensEnabled && (GPU.VCount < 192) &&
+        GPU.GPU2D_A.Enabled && !GPU.GPU2D_A.ForcedBlank &&
+        (((dispcnt >> 16) & 0x3) == 1) && (dispcnt & (1<<3)) && (GPU.GPU2D_A.LayerEnable & (1<<0));
+
+    if (hires3D)
+    {
+        auto rend2d = dynamic_cast<SoftRenderer2D*>(Rend2D_A.get());
+        auto rend3d = dynamic_cast<SoftRenderer3D*>(Rend3D.get());
+
+        for (int i = 0; i < ScaleFactor; i++)
+        {
+            u32* dst = &hiresA[width * i];
+            rend2d->CompositeHires(dst, rend3d->GetHiresLine(GPU.VCount, i), ScaleFactor);
+            ApplyMasterBrightness(GPU.MasterBrightnessA, dst, width);
+            ExpandColor(dst, width);
+        }
+    }
+    else
+    {
+        for (int x = 0; x < 256; x++)
+            for (int j = 0; j < ScaleFactor; j++)
+                hiresA[(x * ScaleFactor) + j] = dstA[x];
+
+        for (int i = 1; i < ScaleFactor; i++)
+            memcpy(&hiresA[width * i], hiresA, width * sizeof(u32));
+    }
+
+    for (int x = 0; x < 256; x++)
+        for (int j = 0; j < ScaleFactor; j++)
+            hiresB[(x * ScaleFactor) + j] = dstB[x];
+
+    for (int i = 1; i < ScaleFactor; i++)
+        memcpy(&hiresB[width * i], hiresB, width * sizeof(u32));
 }
 
 void SoftRenderer::DrawSprites(u32 line)
@@ -402,7 +482,7 @@ void SoftRenderer::DoCapture(u32 line)
     }
 }
 
-void SoftRenderer::ApplyMasterBrightness(u16 regval, u32* dst)
+void SoftRenderer::ApplyMasterBrightness(u16 regval, u32* dst, int width)
 {
     u16 mode = regval >> 14;
     if (mode == 1)
@@ -411,7 +491,7 @@ void SoftRenderer::ApplyMasterBrightness(u16 regval, u32* dst)
         u32 factor = regval & 0x1F;
         if (factor > 16) factor = 16;
 
-        for (int i = 0; i < 256; i++)
+        for (int i = 0; i < width; i++)
             dst[i] = ColorBrightnessUp(dst[i], factor, 0x0);
     }
     else if (mode == 2)
@@ -420,17 +500,17 @@ void SoftRenderer::ApplyMasterBrightness(u16 regval, u32* dst)
         u32 factor = regval & 0x1F;
         if (factor > 16) factor = 16;
 
-        for (int i = 0; i < 256; i++)
+        for (int i = 0; i < width; i++)
             dst[i] = ColorBrightnessDown(dst[i], factor, 0xF);
     }
 }
 
-void SoftRenderer::ExpandColor(u32* dst)
+void SoftRenderer::ExpandColor(u32* dst, int width)
 {
     // convert to 32-bit BGRA
     // note: 32-bit RGBA would be more straightforward, but
     // BGRA seems to be more compatible (Direct2D soft, cairo...)
-    for (int i = 0; i < 256; i+=2)
+    for (int i = 0; i < width; i+=2)
     {
         u64 c = *(u64*)&dst[i];
 
@@ -452,4 +532,15 @@ bool SoftRenderer::GetFramebuffers(void** top, void** bottom)
     return true;
 }
 
+bool SoftRenderer::GetHiresFramebuffers(void** top, void** bottom)
+{
+    if (ScaleFactor < 2)
+        return false;
+
+    int frontbuf = BackBuffer ^ 1;
+    *top = HiresFramebuffer[frontbuf][0].data();
+    *bottom = HiresFramebuffer[frontbuf][1].data();
+    return true;
+}
+
 }
@@ -19,6 +19,8 @@
 #ifndef GPU_SOFT_H
 #define GPU_SOFT_H
 
+#include <vector>
+
 #include "GPU.h"
 #include "GPU2D_Soft.h"
 #include "GPU3D_Soft.h"
@@ -51,22 +53,32 @@ public:
 
     bool GetFramebuffers(void** top, void** bottom) override;
 
+    // upscaled output, only available if SoftScaleFactor is greater than 1
+    // the framebuffers are 32-bit BGRA, (256*scale)x(192*scale) for each screen
+    [[nodiscard]] int GetScaleFactor() const noexcept { return ScaleFactor; }
+    bool GetHiresFramebuffers(void** top, void** bottom);
+
 private:
     friend class SoftRenderer2D;
     friend class SoftRenderer3D;
 
     u32* Framebuffer[2][2];
 
+    int ScaleFactor = 1;
+    std::vector<u32> HiresFramebuffer[2][2];
+
     u32* Output3D;
     alignas(8) u32 Output2D[2][256];
 
     void DrawScanlineA(u32 line, u32* dst);
     void DrawScanlineB(u32 line, u32* dst);
 
+    void DrawHiresScanline(u32 line, u32* dstA, u32* dstB);
+
     void DoCapture(u32 line);
 
-    void ApplyMasterBrightness(u16 regval, u32* dst);
-    void ExpandColor(u32* dst);
+    void ApplyMasterBrightness(u16 regval, u32* dst, int width = 256);
+    void ExpandColor(u32* dst, int width = 256);
 };
 
 }
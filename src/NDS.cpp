@@ -698,6 +698,9 @@ bool NDS::DoSavestate(Savestate* file)
 
     file->VarArray(DMA9Fill, 4*sizeof(u32));
 
+    if (file->Saving)
+        Wifi.FlushTimer();
+
     for (int i = 0; i < Event_MAX; i++)
     {
         SchedEvent& evt = SchedList[i];
@@ -842,6 +845,13 @@ void NDS::RunSystem(u64 timestamp)
 {
     SysTimestamp = timestamp;
 
+    // with batched mixing, the samples that fell due in this slice aren't scheduled events
+    SPU.FinishSlice(timestamp);
+
+    // the DSi's DSP thread may follow the ARM9 up to here
+    if (ConsoleType == 1)
+        static_cast<melonDS::DSi&>(*this).DSP.SetThreadLimit(ARM9Timestamp);
+
     u32 mask = SchedListMask;
     for (int i = 0; i < Event_MAX; i++)
     {
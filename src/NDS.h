@@ -386,6 +386,16 @@ public: // TODO: Encapsulate the rest of these members
             GPU.SetRenderer(std::move(renderer));
     }
 
+    /// Only renders one frame out of every (frames+1).
+    /// Skipped frames are still fully emulated, only the drawing is left out,
+    /// unless the frame uses display capture.
+    void SetFrameSkip(u32 frames) noexcept { GPU.SetFrameSkip(frames); }
+    [[nodiscard]] u32 GetFrameSkip() const noexcept { return GPU.GetFrameSkip(); }
+
+    /// Whether the last frame run was skipped, in which case
+    /// the framebuffers still hold the last rendered frame.
+    [[nodiscard]] bool IsFrameSkipped() const noexcept { return GPU.IsFrameSkipped(); }
+
     virtual bool NeedsDirectBoot() const;
     void SetupDirectBoot(const std::string& romname);
     virtual void SetupDirectBoot();
@@ -296,6 +296,8 @@ void WriteDateTime(int year, int month, int day, int hour, int minute, int secon
 
 // local multiplayer comm interface
 // packet type: DS-style TX header (12 bytes) + original 802.11 frame
+// for the receive functions, timestamp holds the current wifi timestamp on entry,
+// and the received packet's timestamp on return
 void MP_Begin(void* userdata);
 void MP_End(void* userdata);
 int MP_SendPacket(u8* data, int len, u64 timestamp, void* userdata);
@@ -305,6 +307,8 @@ int MP_SendReply(u8* data, int len, u64 timestamp, u16 aid, void* userdata);
 int MP_SendAck(u8* data, int len, u64 timestamp, void* userdata);
 int MP_RecvHostPacket(u8* data, u64* timestamp, void* userdata);
 u16 MP_RecvReplies(u8* data, u64 timestamp, u16 aidmask, void* userdata);
+// called on every wifi timer tick while wifi is on, with the current wifi timestamp
+void MP_SetTime(u64 timestamp, void* userdata);
 
 
 // network comm interface
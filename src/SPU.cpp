@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <cmath>
 #include "Platform.h"
 #include "NDS.h"
@@ -28,6 +29,10 @@
 
 #include "blip-buf/blip_buf.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define INTERNAL_SAMPLE_RATE 16756991.f
 
 namespace melonDS
@@ -205,10 +210,8 @@ SPU::SPU(melonDS::NDS& nds, AudioBitDepth bitdepth, AudioInterpolation interpola
         SPUCaptureUnit(0, nds),
         SPUCaptureUnit(1, nds),
     },
-    AudioLock(Platform::Mutex_Create()),
     Degrade10Bit(bitdepth == AudioBitDepth::_10Bit || (nds.ConsoleType == 1 && bitdepth == AudioBitDepth::Auto)),
-    OutputSampleRate(outputSampleRate),
-    OutputBuffer(nullptr)
+    OutputSampleRate(outputSampleRate)
 {
     NDS.RegisterEventFuncs(Event_SPU, this, {MakeEventThunk(SPU, Mix)});
 
@@ -218,22 +221,11 @@ SPU::SPU(melonDS::NDS& nds, AudioBitDepth bitdepth, AudioInterpolation interpola
     BlipLeft = blip_new(512);
     BlipRight = blip_new(512);
 
-    OutputBufferReadPos = 0;
-    OutputBufferWritePos = 0;
-
     SetSampleRate(AudioSampleRate::_32KHz);
 }
 
 SPU::~SPU()
 {
-    if (OutputBuffer != nullptr)
-    {
-        free(OutputBuffer);
-        OutputBuffer = nullptr;
-    }
-
-    Platform::Mutex_Free(AudioLock);
-    AudioLock = nullptr;
     blip_delete(BlipLeft);
     blip_delete(BlipRight);
 
@@ -256,26 +248,28 @@ void SPU::Reset()
     Capture[1].Reset();
 
     NDS.ScheduleEvent(Event_SPU, false, 1024, 0, 0);
+    MixTimestamp = NDS.SchedList[Event_SPU].Timestamp;
 }
 
 void SPU::Stop()
 {
-    Platform::Mutex_Lock(AudioLock);
-    memset(OutputBuffer, 0, 2*OutputBufferSize*2);
-
     blip_clear(BlipLeft);
     blip_clear(BlipRight);
     BlipTimer = 0;
 
-    OutputBufferReadPos = 0;
-    OutputBufferWritePos = 0;
-    Platform::Mutex_Unlock(AudioLock);
+    DrainOutput();
 }
 
 void SPU::DoSavestate(Savestate* file)
 {
     file->Section("SPU.");
 
+    // savestates always hold one sample per event, as with regular mixing
+    if (file->Saving)
+        FlushMix();
+    else
+        MixTimestamp = NDS.SchedList[Event_SPU].Timestamp;
+
     file->Var16(&Cnt);
     file->Var8(&MasterVolume);
     file->Var16(&Bias);
@@ -410,6 +404,172 @@ void SPUChannel::DoSavestate(Savestate* file)
     file->VarArray(FIFO, sizeof(FIFO));
 }
 
+// block mixing kernels
+// these work on groups of 4 samples, callers pad their buffers accordingly
+// the SSE2 versions give the exact same results as the plain ones
+
+// interpolation taps are stored as 4 samples (oldest first) with their 4 weights
+
+#if defined(__SSE2__)
+
+static inline __m128i MulLo32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+// sums of the two 32-bit halves of each sample's taps, for samples 0-1 in a and 2-3 in b
+static inline __m128i SumPairs(__m128i a, __m128i b)
+{
+    __m128 fa = _mm_castsi128_ps(a);
+    __m128 fb = _mm_castsi128_ps(b);
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2,0,2,0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3,1,3,1)));
+    return _mm_add_epi32(even, odd);
+}
+
+static void InterpolateBlock(const s16* taps, const s16* weights, s32* out, u32 count, int shift)
+{
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128i t0 = _mm_load_si128((const __m128i*)&taps[i*4]);
+        __m128i t1 = _mm_load_si128((const __m128i*)&taps[i*4 + 8]);
+        __m128i w0 = _mm_load_si128((const __m128i*)&weights[i*4]);
+        __m128i w1 = _mm_load_si128((const __m128i*)&weights[i*4 + 8]);
+
+        __m128i sum = SumPairs(_mm_madd_epi16(t0, w0), _mm_madd_epi16(t1, w1));
+        _mm_store_si128((__m128i*)&out[i], _mm_sra_epi32(sum, vshift));
+    }
+}
+
+// products of two samples' taps with their weights, as 32-bit values
+static inline void GaussProducts(__m128i taps, __m128i weights, __m128i& lo, __m128i& hi)
+{
+    // avoid clipping (from fullsnes)
+    taps = _mm_srai_epi16(taps, 1);
+    taps = _mm_max_epi16(taps, _mm_set1_epi16(-0x3FFA));
+    taps = _mm_min_epi16(taps, _mm_set1_epi16(0x3FF8));
+
+    __m128i plo = _mm_mullo_epi16(taps, weights);
+    __m128i phi = _mm_mulhi_epi16(taps, weights);
+    lo = _mm_srai_epi32(_mm_unpacklo_epi16(plo, phi), 10);
+    hi = _mm_srai_epi32(_mm_unpackhi_epi16(plo, phi), 10);
+}
+
+static void InterpolateBlockGauss(const s16* taps, const s16* weights, s32* out, u32 count)
+{
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128i p0, p1, p2, p3;
+        GaussProducts(_mm_load_si128((const __m128i*)&taps[i*4]),
+                      _mm_load_si128((const __m128i*)&weights[i*4]), p0, p1);
+        GaussProducts(_mm_load_si128((const __m128i*)&taps[i*4 + 8]),
+                      _mm_load_si128((const __m128i*)&weights[i*4 + 8]), p2, p3);
+
+        __m128i sum = SumPairs(SumPairs(p0, p1), SumPairs(p2, p3));
+
+        // clamp to 16-bit and sign-extend back
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_srai_epi32(_mm_unpacklo_epi16(sum, sum), 16);
+        _mm_store_si128((__m128i*)&out[i], sum);
+    }
+}
+
+static void VolumeBlock(s32* data, u32 count, int shift, s32 volume)
+{
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+    __m128i vvol = _mm_set1_epi32(volume);
+
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128i val = _mm_load_si128((const __m128i*)&data[i]);
+        val = MulLo32(_mm_sll_epi32(val, vshift), vvol);
+        _mm_store_si128((__m128i*)&data[i], val);
+    }
+}
+
+// (in * pan) >> 10, done as ((in >> 10) * pan) + (((in & 0x3FF) * pan) >> 10)
+// which is exact, and doesn't need 64-bit intermediates since pan is at most 128
+static inline __m128i PanMul(__m128i hi, __m128i lo, __m128i pan)
+{
+    return _mm_add_epi32(MulLo32(hi, pan), _mm_srli_epi32(_mm_madd_epi16(lo, pan), 10));
+}
+
+static void PanBlock(const s32* in, s32* left, s32* right, u32 count, s32 pan)
+{
+    __m128i vpanl = _mm_set1_epi32(128 - pan);
+    __m128i vpanr = _mm_set1_epi32(pan);
+    __m128i mask = _mm_set1_epi32(0x3FF);
+
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128i val = _mm_load_si128((const __m128i*)&in[i]);
+        __m128i hi = _mm_srai_epi32(val, 10);
+        __m128i lo = _mm_and_si128(val, mask);
+
+        __m128i l = _mm_load_si128((const __m128i*)&left[i]);
+        __m128i r = _mm_load_si128((const __m128i*)&right[i]);
+        _mm_store_si128((__m128i*)&left[i], _mm_add_epi32(l, PanMul(hi, lo, vpanl)));
+        _mm_store_si128((__m128i*)&right[i], _mm_add_epi32(r, PanMul(hi, lo, vpanr)));
+    }
+}
+
+#else
+
+static void InterpolateBlock(const s16* taps, const s16* weights, s32* out, u32 count, int shift)
+{
+    for (u32 i = 0; i < count; i++)
+    {
+        const s16* t = &taps[i*4];
+        const s16* w = &weights[i*4];
+        out[i] = ((t[0] * w[0]) + (t[1] * w[1]) + (t[2] * w[2]) + (t[3] * w[3])) >> shift;
+    }
+}
+
+static void InterpolateBlockGauss(const s16* taps, const s16* weights, s32* out, u32 count)
+{
+    for (u32 i = 0; i < count; i++)
+    {
+        const s16* t = &taps[i*4];
+        const s16* w = &weights[i*4];
+
+        // avoid clipping (from fullsnes)
+#define CLAMP(s) (std::clamp((s) >> 1, -0x3FFA, 0x3FF8))
+        s32 val =    ((w[0] * CLAMP(t[0])) >> 10);
+        val = val + ((w[1] * CLAMP(t[1])) >> 10);
+        val = val + ((w[2] * CLAMP(t[2])) >> 10);
+        val = val + ((w[3] * CLAMP(t[3])) >> 10);
+        out[i] = std::clamp(val, -0x8000, 0x7FFF);
+#undef CLAMP
+    }
+}
+
+static void VolumeBlock(s32* data, u32 count, int shift, s32 volume)
+{
+    for (u32 i = 0; i < count; i++)
+    {
+        s32 val = data[i];
+        val <<= shift;
+        val *= volume;
+        data[i] = val;
+    }
+}
+
+static void PanBlock(const s32* in, s32* left, s32* right, u32 count, s32 pan)
+{
+    for (u32 i = 0; i < count; i++)
+    {
+        left[i] += ((s64)in[i] * (128-pan)) >> 10;
+        right[i] += ((s64)in[i] * pan) >> 10;
+    }
+}
+
+#endif
+
 void SPUChannel::FIFO_BufferData()
 {
     u32 totallen = LoopPos + Length;
@@ -726,12 +886,186 @@ s32 SPUChannel::Run(u32 cycles)
     return val;
 }
 
+template<u32 type>
+void SPUChannel::RunBlock(u32 cycles, s32* out, u32 count)
+{
+    // buffers are processed in groups of 4 samples
+    u32 padcount = (count + 3) & ~3;
+
+    if ((!(Cnt & (1<<31))) || ((type < 3) && ((Length+LoopPos) < 16)))
+    {
+        memset(out, 0, padcount * sizeof(s32));
+        return;
+    }
+
+    if (KeyOn)
+    {
+        Start();
+        KeyOn = false;
+    }
+
+    bool interp = (type < 3) && (InterpType != AudioInterpolation::None);
+    alignas(16) s16 taps[MaxBlockSize * 4];
+    alignas(16) s16 weights[MaxBlockSize * 4];
+
+    // generate the samples one by one, this part can't be vectorized
+    // the interpolation is deferred to the block kernels, which are fed the samples and weights
+    u32 i = 0;
+    while (i < count)
+    {
+        Timer += cycles;
+
+        while (Timer >> 16)
+        {
+            Timer = TimerReload + (Timer - 0x10000);
+
+            if (interp)
+            {
+                PrevSample[2] = PrevSample[1];
+                PrevSample[1] = PrevSample[0];
+                PrevSample[0] = CurSample;
+            }
+
+            switch (type)
+            {
+            case 0: NextSample_PCM8(); break;
+            case 1: NextSample_PCM16(); break;
+            case 2: NextSample_ADPCM(); break;
+            case 3: NextSample_PSG(); break;
+            case 4: NextSample_Noise(); break;
+            }
+
+            if (!(Cnt & (1<<31))) break;
+        }
+
+        if (interp)
+        {
+            s32 samplepos = ((Timer - TimerReload) * 0x100) / (0x10000 - TimerReload);
+            if (samplepos > 0xFF) samplepos = 0xFF;
+
+            s16* t = &taps[i*4];
+            s16* w = &weights[i*4];
+            t[0] = PrevSample[2];
+            t[1] = PrevSample[1];
+            t[2] = PrevSample[0];
+            t[3] = CurSample;
+
+            switch (InterpType)
+            {
+            case AudioInterpolation::Linear:
+                w[0] = 0;
+                w[1] = 0;
+                w[2] = 0xFF - samplepos;
+                w[3] = samplepos;
+                break;
+
+            case AudioInterpolation::Cosine:
+                w[0] = 0;
+                w[1] = 0;
+                w[2] = InterpCos[0xFF - samplepos];
+                w[3] = InterpCos[samplepos];
+                break;
+
+            case AudioInterpolation::Cubic:
+                w[0] = InterpCubic[samplepos][0];
+                w[1] = InterpCubic[samplepos][1];
+                w[2] = InterpCubic[samplepos][2];
+                w[3] = InterpCubic[samplepos][3];
+                break;
+
+            case AudioInterpolation::SNESGaussian:
+                w[0] = InterpSNESGauss[0x0FF - samplepos];
+                w[1] = InterpSNESGauss[0x1FF - samplepos];
+                w[2] = InterpSNESGauss[0x100 + samplepos];
+                w[3] = InterpSNESGauss[0x000 + samplepos];
+                break;
+
+            default:
+                break;
+            }
+        }
+        else
+            out[i] = CurSample;
+
+        i++;
+
+        // the channel keeps outputting silence once it has stopped
+        if (!(Cnt & (1<<31))) break;
+    }
+
+    if (interp)
+    {
+        memset(&taps[i*4], 0, (padcount - i) * 4 * sizeof(s16));
+        memset(&weights[i*4], 0, (padcount - i) * 4 * sizeof(s16));
+
+        if (InterpType == AudioInterpolation::SNESGaussian)
+            InterpolateBlockGauss(taps, weights, out, padcount);
+        else
+            InterpolateBlock(taps, weights, out, padcount, (InterpType == AudioInterpolation::Linear) ? 8 : 14);
+    }
+
+    else
+        memset(&out[i], 0, (padcount - i) * sizeof(s32));
+
+    VolumeBlock(out, padcount, VolumeShift, Volume);
+}
+
+template<u32 type>
+void SPUChannel::Skip(u32 cycles, u32 count)
+{
+    if (!(Cnt & (1<<31))) return;
+
+    if ((type < 3) && ((Length+LoopPos) < 16)) return;
+
+    if (KeyOn)
+    {
+        Start();
+        KeyOn = false;
+    }
+
+    // keep the channel state the same as if it was mixed
+    bool interp = (type < 3) && (InterpType != AudioInterpolation::None);
+
+    for (u32 i = 0; i < count; i++)
+    {
+        Timer += cycles;
+
+        while (Timer >> 16)
+        {
+            Timer = TimerReload + (Timer - 0x10000);
+
+            if (interp)
+            {
+                PrevSample[2] = PrevSample[1];
+                PrevSample[1] = PrevSample[0];
+                PrevSample[0] = CurSample;
+            }
+
+            switch (type)
+            {
+            case 0: NextSample_PCM8(); break;
+            case 1: NextSample_PCM16(); break;
+            case 2: NextSample_ADPCM(); break;
+            case 3: NextSample_PSG(); break;
+            case 4: NextSample_Noise(); break;
+            }
+
+            if (!(Cnt & (1<<31))) return;
+        }
+    }
+}
+
 void SPUChannel::PanOutput(s32 in, s32& left, s32& right)
 {
     left += ((s64)in * (128-Pan)) >> 10;
     right += ((s64)in * Pan) >> 10;
 }
 
+void SPUChannel::PanOutputBlock(const s32* in, s32* left, s32* right, u32 count)
+{
+    PanBlock(in, left, right, (count + 3) & ~3, Pan);
+}
+
 
 SPUCaptureUnit::SPUCaptureUnit(u32 num, melonDS::NDS& nds) : NDS(nds), Num(num)
 {
@@ -856,10 +1190,108 @@ void SPUCaptureUnit::Run(u32 cycles, s32 sample)
 }
 
 
+void SPU::SetBatchedMixing(bool enable)
+{
+    if (enable == BatchedMixing) return;
+
+    if (enable)
+        MixTimestamp = NDS.SchedList[Event_SPU].Timestamp;
+    else
+        FlushMix();
+
+    BatchedMixing = enable;
+}
+
+void SPU::SetOutputEnabled(bool enable)
+{
+    OutputEnabled = enable;
+}
+
+bool SPU::CanBatchMix() const
+{
+    // sound capture writes to memory, so it's kept running sample by sample
+    // on the DSi, each sample also clocks the I2S interface, which mixes in DSP audio
+    if ((Capture[0].Cnt & (1<<7)) || (Capture[1].Cnt & (1<<7)))
+        return false;
+
+    return NDS.ConsoleType == 0;
+}
+
+void SPU::CatchUp()
+{
+    if (!BatchedMixing) return;
+
+    MixUntil(NDS.GetSysClockCycles(0));
+}
+
+void SPU::MixUntil(u64 time)
+{
+    // when nothing needs to be run sample by sample, mix whole blocks
+    bool block = CanBatchMix();
+    const SchedEvent& evt = NDS.SchedList[Event_SPU];
+
+    while (MixTimestamp <= time)
+    {
+        u32 count = 1;
+        if (MixTimestamp == evt.Timestamp)
+        {
+            // the sample the SPU event was scheduled for uses the event's cycle count
+            // (the first sample after a reset is different)
+            MixSample(evt.Param);
+        }
+        else if (block && (time - MixTimestamp) >= MixInterval)
+        {
+            count = (u32)((time - MixTimestamp) / MixInterval) + 1;
+            if (count > SPUChannel::MaxBlockSize) count = SPUChannel::MaxBlockSize;
+
+            MixBlock(MixInterval >> 1, count);
+        }
+        else
+            MixSample(MixInterval >> 1);
+
+        MixTimestamp += count * MixInterval;
+    }
+}
+
+void SPU::FlushMix()
+{
+    if (!BatchedMixing) return;
+
+    // mix everything that is due, then bring the event back to the next sample
+    CatchUp();
+
+    NDS.CancelEvent(Event_SPU);
+    NDS.ScheduleEvent(Event_SPU, false, (s32)(MixTimestamp - NDS.GetSysClockCycles(0)), 0, MixInterval >> 1);
+}
+
 void SPU::Mix(u32 spucycles)
 {
+    if (!BatchedMixing)
+    {
+        MixSample(spucycles);
+        NDS.ScheduleEvent(Event_SPU, true, MixInterval, 0, MixInterval >> 1);
+        return;
+    }
+
+    u64 evttime = NDS.SchedList[Event_SPU].Timestamp;
+    MixUntil(evttime);
+
+    u64 target = MixTimestamp;
+    if (CanBatchMix())
+        target += (MixBatchSize - 1) * MixInterval;
+
+    NDS.ScheduleEvent(Event_SPU, true, (s32)(target - evttime), 0, MixInterval >> 1);
+}
+
+void SPU::MixSample(u32 spucycles)
+{
+    if (!OutputEnabled && !((Capture[0].Cnt | Capture[1].Cnt) & (1<<7)))
+    {
+        SkipSamples(spucycles, 1);
+        return;
+    }
+
     s32 left = 0, right = 0;
-    s32 leftoutput = 0, rightoutput = 0;
 
     if (Cnt & (1<<15))
     {
@@ -908,8 +1340,79 @@ void SPU::Mix(u32 spucycles)
             Capture[1].Run(spucycles, val);
         }
 
-        // final output
+        OutputSample(left, right, ch1, ch3, spucycles);
+    }
+    else
+        OutputSample(0, 0, 0, 0, spucycles);
+}
+
+void SPU::MixBlock(u32 spucycles, u32 count)
+{
+    if (!OutputEnabled)
+    {
+        SkipSamples(spucycles, count);
+        return;
+    }
+
+    if (!(Cnt & (1<<15)))
+    {
+        for (u32 i = 0; i < count; i++)
+            OutputSample(0, 0, 0, 0, spucycles);
+
+        return;
+    }
+
+    alignas(16) s32 left[SPUChannel::MaxBlockSize] {};
+    alignas(16) s32 right[SPUChannel::MaxBlockSize] {};
+    alignas(16) s32 ch1[SPUChannel::MaxBlockSize];
+    alignas(16) s32 ch3[SPUChannel::MaxBlockSize];
+    alignas(16) s32 chan[SPUChannel::MaxBlockSize];
+
+    // channels don't affect each other, so they can be run one after another
+    for (int i = 0; i < 16; i++)
+    {
+        s32* out = chan;
+        if (i == 1) out = ch1;
+        else if (i == 3) out = ch3;
+
+        Channels[i].DoRunBlock(spucycles, out, count);
+
+        if ((i == 1) && (Cnt & (1<<12))) continue;
+        if ((i == 3) && (Cnt & (1<<13))) continue;
+        Channels[i].PanOutputBlock(out, left, right, count);
+    }
+
+    for (u32 i = 0; i < count; i++)
+        OutputSample(left[i], right[i], ch1[i], ch3[i], spucycles);
+}
+
+void SPU::SkipSamples(u32 spucycles, u32 count)
+{
+    if (Cnt & (1<<15))
+    {
+        for (SPUChannel& channel : Channels)
+            channel.DoSkip(spucycles, count);
+    }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        NDS.Mic.Advance(spucycles << 1);
+
+        if (NDS.ConsoleType == 1)
+        {
+            // the DSP and the mic input are still clocked through I2S
+            s16 output[2] = {0, 0};
+            ((DSi&)NDS).I2S.SampleClock(output);
+        }
+    }
+}
+
+void SPU::OutputSample(s32 left, s32 right, s32 ch1, s32 ch3, u32 spucycles)
+{
+    s32 leftoutput = 0, rightoutput = 0;
 
+    if (Cnt & (1<<15))
+    {
         switch (Cnt & 0x0300)
         {
         case 0x0000: // left mixer
@@ -1018,8 +1521,6 @@ void SPU::Mix(u32 spucycles)
 
     if (BlipTimer >= 512 * 128)
         BufferAudio();
-
-    NDS.ScheduleEvent(Event_SPU, true, MixInterval, 0, MixInterval >> 1);
 }
 
 void SPU::BufferAudio()
@@ -1033,159 +1534,196 @@ void SPU::BufferAudio()
     blip_read_samples(BlipLeft, temp, avail, true);
     blip_read_samples(BlipRight, temp + 1, avail, true);
 
-    Platform::Mutex_Lock(AudioLock);
-    for (int i = 0; i < avail * 2; i += 2)
-    {
-        OutputBuffer[OutputBufferWritePos++] = temp[i];
-        OutputBuffer[OutputBufferWritePos++] = temp[i+1];
+    // a sample rate change resizes the buffer, so it's applied here rather than by the caller
+    if (OutputSampleRate.load(std::memory_order_relaxed) != AppliedSampleRate)
+        InitOutput();
 
-        OutputBufferWritePos &= ((2*OutputBufferSize)-1);
+    // make room for the new samples by dropping the oldest ones
+    // if there are more new samples than fit, the oldest of those go too
+    u32 limit = OutputBufferSize.load(std::memory_order_relaxed) - 1;
+    int skip = std::max(avail - (int)limit, 0);
+    DiscardOutput(limit - (avail - skip));
 
-        if (OutputBufferWritePos == OutputBufferReadPos)
-        {
-            // advance the read position too, to avoid losing the entire FIFO
-            OutputBufferReadPos += 2;
-            OutputBufferReadPos &= ((2*OutputBufferSize)-1);
-        }
+    u32 writepos = OutputBufferWritePos.load(std::memory_order_relaxed);
+    for (int i = skip * 2; i < avail * 2; i += 2)
+    {
+        u32 pos = (writepos & (OutputBufferStorage-1)) << 1;
+        OutputBuffer[pos] = temp[i];
+        OutputBuffer[pos+1] = temp[i+1];
+        writepos++;
     }
-    Platform::Mutex_Unlock(AudioLock);
+
+    OutputBufferWritePos.store(writepos, std::memory_order_release);
+
+    if (RateSettingsChanged.exchange(false, std::memory_order_acquire))
+        ApplyRateControlSettings();
+    if (RateControl)
+        UpdateRateControl();
+    ApplyOutputRate();
 }
 
-void SPU::TrimOutput()
+void SPU::UpdateRateControl()
+{
+    // smooth out the fill level, it jumps around as the reader consumes whole blocks
+    RateFillAverage += (GetOutputSize() - RateFillAverage) * 0.05;
+
+    double error = (RateFillAverage - RateTarget) / RateTarget;
+    error = std::clamp(error, -1.0, 1.0);
+
+    // a fuller buffer means generating fewer samples per emulated clock, and vice versa
+    OutputRatio = 1.0 + (RateMaxDelta * error);
+}
+
+void SPU::ApplyRateControlSettings()
+{
+    // the target is limited by the buffer size, so this is redone whenever the buffer is resized
+    u32 target = RateTargetRequest.load(std::memory_order_relaxed);
+    RateControl = (target > 0);
+    RateTarget = std::min(target, OutputBufferSize.load(std::memory_order_relaxed) - 1);
+    RateMaxDelta = RateMaxDeltaRequest.load(std::memory_order_relaxed);
+    RateFillAverage = RateTarget;
+
+    if (!RateControl)
+        OutputRatio = 1.0;
+}
+
+void SPU::ApplyOutputRate()
+{
+    double rate = INTERNAL_SAMPLE_RATE * OutputSkew.load(std::memory_order_relaxed) * OutputRatio;
+    if (rate == OutputClockRate)
+        return;
+
+    blip_set_rates(BlipLeft, rate, AppliedSampleRate);
+    blip_set_rates(BlipRight, rate, AppliedSampleRate);
+    OutputClockRate = rate;
+}
+
+void SPU::DiscardOutput(u32 keep)
 {
-    Platform::Mutex_Lock(AudioLock);
-    const int halflimit = (OutputBufferSize / 2);
+    // only the writer calls this (see SPU.h), so the write position can't change meanwhile
+    // the reader may be moving the read position forward at the same time
+    u32 writepos = OutputBufferWritePos.load(std::memory_order_relaxed);
+    u32 readpos = OutputBufferReadPos.load(std::memory_order_acquire);
 
-    int readpos = OutputBufferWritePos - (halflimit*2);
-    if (readpos < 0) readpos += (OutputBufferSize*2);
+    while ((writepos - readpos) > keep)
+    {
+        if (OutputBufferReadPos.compare_exchange_weak(readpos, writepos - keep, std::memory_order_acq_rel))
+            break;
+    }
+}
 
-    OutputBufferReadPos = readpos;
-    Platform::Mutex_Unlock(AudioLock);
+void SPU::TrimOutput()
+{
+    DiscardOutput(OutputBufferSize.load(std::memory_order_relaxed) / 2);
 }
 
 void SPU::DrainOutput()
 {
-    Platform::Mutex_Lock(AudioLock);
-    OutputBufferReadPos = 0;
-    OutputBufferWritePos = 0;
-    Platform::Mutex_Unlock(AudioLock);
+    DiscardOutput(0);
 }
 
 void SPU::InitOutput()
 {
-    Platform::Mutex_Lock(AudioLock);
+    AppliedSampleRate = OutputSampleRate.load(std::memory_order_relaxed);
 
-    blip_set_rates(BlipLeft, INTERNAL_SAMPLE_RATE * OutputSkew, OutputSampleRate);
-    blip_set_rates(BlipRight, INTERNAL_SAMPLE_RATE * OutputSkew, OutputSampleRate);
-
-    u32 needSamples = (u32) ceil(INTERNAL_SAMPLE_RATE / 60 / INTERNAL_SAMPLE_RATE * OutputSampleRate);
+    u32 needSamples = (u32) ceil(INTERNAL_SAMPLE_RATE / 60 / INTERNAL_SAMPLE_RATE * AppliedSampleRate);
     u32 newBufferSize = 512;
     while (newBufferSize < needSamples)
         newBufferSize <<= 1;
     newBufferSize <<= 1;
 
-    if (newBufferSize != OutputBufferSize)
-    {
-        if (OutputBuffer != nullptr)
-            free(OutputBuffer);
-        OutputBuffer = (s16*) malloc(2 * newBufferSize * 2);
-        OutputBufferSize = newBufferSize;
-    }
+    OutputBufferSize.store(std::min(newBufferSize, OutputBufferMaxSize), std::memory_order_relaxed);
+
+    ApplyRateControlSettings();
+    OutputClockRate = 0;
+    ApplyOutputRate();
 
-    memset(OutputBuffer, 0, 2*OutputBufferSize*2);
-    OutputBufferReadPos = 0;
-    OutputBufferWritePos = 0;
-    Platform::Mutex_Unlock(AudioLock);
+    DrainOutput();
 }
 
 int SPU::GetOutputSize() const
 {
-    Platform::Mutex_Lock(AudioLock);
+    // load the read position first, so the difference can't be negative
+    u32 readpos = OutputBufferReadPos.load(std::memory_order_acquire);
+    u32 writepos = OutputBufferWritePos.load(std::memory_order_acquire);
 
-    int ret;
-    if (OutputBufferWritePos >= OutputBufferReadPos)
-        ret = OutputBufferWritePos - OutputBufferReadPos;
-    else
-        ret = (OutputBufferSize*2) - OutputBufferReadPos + OutputBufferWritePos;
-
-    ret >>= 1;
+    return (int)(writepos - readpos);
+}
 
-    Platform::Mutex_Unlock(AudioLock);
-    return ret;
+int SPU::GetOutputCapacity() const
+{
+    return OutputBufferSize.load(std::memory_order_relaxed);
 }
 
 void SPU::Sync(bool wait)
 {
-    // this function is currently not used anywhere
-    // depending on the usage context the thread safety measures could be made
-    // a lot faster
-
     // sync to audio output in case the core is running too fast
     // * wait=true: wait until enough audio data has been played
     // * wait=false: merely skip some audio data to avoid a FIFO overflow
 
-    const int halflimit = (OutputBufferSize / 2);
+    const int halflimit = (OutputBufferSize.load(std::memory_order_relaxed) / 2);
 
     if (wait)
     {
-        // TODO: less CPU-intensive wait?
-        while (GetOutputSize() > halflimit);
-    }
-    else if (GetOutputSize() > halflimit)
-    {
-        Platform::Mutex_Lock(AudioLock);
-
-        int readpos = OutputBufferWritePos - (halflimit*2);
-        if (readpos < 0) readpos += (OutputBufferSize*2);
-
-        OutputBufferReadPos = readpos;
-
-        Platform::Mutex_Unlock(AudioLock);
+        while (GetOutputSize() > halflimit)
+            Platform::Sleep(500);
     }
+    else
+        DiscardOutput(halflimit);
 }
 
 int SPU::ReadOutput(s16* data, int samples)
 {
-    Platform::Mutex_Lock(AudioLock);
-    if (OutputBufferReadPos == OutputBufferWritePos)
+    for (;;)
     {
-        Platform::Mutex_Unlock(AudioLock);
-        return 0;
-    }
+        u32 readpos = OutputBufferReadPos.load(std::memory_order_acquire);
+        u32 writepos = OutputBufferWritePos.load(std::memory_order_acquire);
 
-    for (int i = 0; i < samples; i++)
-    {
-        *data++ = OutputBuffer[OutputBufferReadPos++];
-        *data++ = OutputBuffer[OutputBufferReadPos++];
-        OutputBufferReadPos &= ((2*OutputBufferSize)-1);
+        u32 avail = writepos - readpos;
+        if (avail == 0)
+            return 0;
+        if (avail > OutputBufferStorage)
+            continue; // the writer dropped samples in between the two loads
 
-        if (OutputBufferWritePos == OutputBufferReadPos)
+        u32 count = std::min((u32)samples, avail);
+        for (u32 i = 0; i < count; i++)
         {
-            Platform::Mutex_Unlock(AudioLock);
-            return i+1;
+            u32 pos = ((readpos + i) & (OutputBufferStorage-1)) << 1;
+            data[i*2] = OutputBuffer[pos];
+            data[i*2 + 1] = OutputBuffer[pos+1];
         }
-    }
 
-    Platform::Mutex_Unlock(AudioLock);
-    return samples;
+        // if the writer dropped samples meanwhile, what we just read is stale
+        if (OutputBufferReadPos.compare_exchange_strong(readpos, readpos + count, std::memory_order_acq_rel))
+            return count;
+    }
 }
 
 void SPU::SetOutputSampleRate(double rate)
 {
-    OutputSampleRate = rate;
-    InitOutput();
+    // the emulation thread picks the new rate up on the next BufferAudio()
+    OutputSampleRate.store(rate, std::memory_order_relaxed);
 }
 
 void SPU::SetOutputSkew(double skew)
 {
-    blip_set_rates(BlipLeft, INTERNAL_SAMPLE_RATE * skew, OutputSampleRate);
-    blip_set_rates(BlipRight, INTERNAL_SAMPLE_RATE * skew, OutputSampleRate);
-    OutputSkew = skew;
+    // the new rate is applied by the emulation thread on the next BufferAudio()
+    OutputSkew.store(skew, std::memory_order_relaxed);
+}
+
+void SPU::SetDynamicRateControl(bool enable, u32 target, double maxdelta)
+{
+    // the emulation thread picks the new settings up on the next BufferAudio()
+    RateTargetRequest.store(enable ? target : 0, std::memory_order_relaxed);
+    RateMaxDeltaRequest.store(maxdelta, std::memory_order_relaxed);
+    RateSettingsChanged.store(true, std::memory_order_release);
 }
 
 
 u8 SPU::Read8(u32 addr)
 {
+    CatchUp();
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1216,6 +1754,8 @@ u8 SPU::Read8(u32 addr)
 
 u16 SPU::Read16(u32 addr)
 {
+    CatchUp();
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1243,6 +1783,8 @@ u16 SPU::Read16(u32 addr)
 
 u32 SPU::Read32(u32 addr)
 {
+    CatchUp();
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1272,6 +1814,8 @@ u32 SPU::Read32(u32 addr)
 
 void SPU::Write8(u32 addr, u8 val)
 {
+    CatchUp();
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1300,10 +1844,12 @@ void SPU::Write8(u32 addr, u8 val)
         case 0x04000508:
             Capture[0].SetCnt(val);
             if (val & 0x03) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %02X\n", val);
+            if (!CanBatchMix()) FlushMix();
             return;
         case 0x04000509:
             Capture[1].SetCnt(val);
             if (val & 0x03) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %02X\n", val);
+            if (!CanBatchMix()) FlushMix();
             return;
         }
     }
@@ -1313,6 +1859,8 @@ void SPU::Write8(u32 addr, u8 val)
 
 void SPU::Write16(u32 addr, u16 val)
 {
+    CatchUp();
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1350,6 +1898,7 @@ void SPU::Write16(u32 addr, u16 val)
             Capture[0].SetCnt(val & 0xFF);
             Capture[1].SetCnt(val >> 8);
             if (val & 0x0303) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %04X\n", val);
+            if (!CanBatchMix()) FlushMix();
             return;
 
         case 0x04000514: Capture[0].SetLength(val); return;
@@ -1362,6 +1911,8 @@ void SPU::Write16(u32 addr, u16 val)
 
 void SPU::Write32(u32 addr, u32 val)
 {
+    CatchUp();
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1398,6 +1949,7 @@ void SPU::Write32(u32 addr, u32 val)
             Capture[0].SetCnt(val & 0xFF);
             Capture[1].SetCnt(val >> 8);
             if (val & 0x0303) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %04X\n", val);
+            if (!CanBatchMix()) FlushMix();
             return;
 
         case 0x04000510: Capture[0].SetDstAddr(val); return;
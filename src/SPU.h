@@ -19,6 +19,9 @@
 #ifndef SPU_H
 #define SPU_H
 
+#include <atomic>
+#include <string.h>
+
 #include "Savestate.h"
 #include "Platform.h"
 
@@ -160,7 +163,57 @@ public:
         }
     }
 
+    // block mixing: runs the channel for several consecutive output samples at once
+    static constexpr u32 MaxBlockSize = 32;
+
+    template<u32 type> void RunBlock(u32 cycles, s32* out, u32 count);
+
+    void DoRunBlock(u32 cycles, s32* out, u32 count)
+    {
+        switch ((Cnt >> 29) & 0x3)
+        {
+        case 0: RunBlock<0>(cycles, out, count); return;
+        case 1: RunBlock<1>(cycles, out, count); return;
+        case 2: RunBlock<2>(cycles, out, count); return;
+        case 3:
+            if (Num >= 14)
+            {
+                RunBlock<4>(cycles, out, count);
+                return;
+            }
+            else if (Num >= 8)
+            {
+                RunBlock<3>(cycles, out, count);
+                return;
+            }
+            [[fallthrough]];
+        default:
+            memset(out, 0, MaxBlockSize * sizeof(s32));
+            return;
+        }
+    }
+
+    // advances the channel without producing any output, for when audio output is disabled
+    template<u32 type> void Skip(u32 cycles, u32 count);
+
+    void DoSkip(u32 cycles, u32 count)
+    {
+        switch ((Cnt >> 29) & 0x3)
+        {
+        case 0: Skip<0>(cycles, count); return;
+        case 1: Skip<1>(cycles, count); return;
+        case 2: Skip<2>(cycles, count); return;
+        case 3:
+            if (Num >= 14)
+                Skip<4>(cycles, count);
+            else if (Num >= 8)
+                Skip<3>(cycles, count);
+            return;
+        }
+    }
+
     void PanOutput(s32 in, s32& left, s32& right);
+    void PanOutputBlock(const s32* in, s32* left, s32* right, u32 count);
 
 private:
     melonDS::NDS& NDS;
@@ -244,18 +297,46 @@ public:
     void SetDegrade10Bit(AudioBitDepth depth);
     void SetApplyBias(bool enable);
 
+    // batched mixing: mix several samples per scheduler event instead of one
+    // samples are mixed at the end of the scheduler slice they fall due in, and SPU register
+    // accesses catch up on them first. this is faster, but the CPUs run on to the end of that
+    // slice before the sound data is fetched, so a sample can pick up guest writes to sound
+    // memory made up to one slice (kMaxIterationCycles plus margin) after it was due
+    void SetBatchedMixing(bool enable);
+
+    // when audio output is disabled, channels are still run, but nothing is mixed or buffered
+    // mixing resumes by itself while sound capture is active, since it writes the mix to memory
+    void SetOutputEnabled(bool enable);
+    bool IsOutputEnabled() const { return OutputEnabled; }
+
     void Mix(u32 spucycles);
     void BufferAudio();
 
+    // called at the end of each scheduler slice, once both CPUs have run up to timestamp
+    void FinishSlice(u64 timestamp) { if (BatchedMixing && MixTimestamp <= timestamp) MixUntil(timestamp); }
+
+    // the output buffer is a lock-free ring with one writer (the emulation thread)
+    // and one reader (ReadOutput, usually called from the audio thread)
+    // TrimOutput, DrainOutput, InitOutput and Sync are on the writer side: they're only to be
+    // called from the emulation thread, or while it isn't running
+    // SetOutputSampleRate, SetOutputSkew and SetDynamicRateControl can be called from any
+    // thread, the new values are applied by the writer on its next BufferAudio()
+    // the fill level and capacity queries can be used from any thread
     void TrimOutput();
     void DrainOutput();
     void InitOutput();
     int GetOutputSize() const;
+    int GetOutputCapacity() const;
     void Sync(bool wait);
     int ReadOutput(s16* data, int samples);
     void SetOutputSampleRate(double rate);
     void SetOutputSkew(double skew);
 
+    // dynamic rate control: nudges the resampling ratio by up to maxdelta either way,
+    // so the output buffer fill level settles around the given target (in output samples)
+    // instead of drifting until samples have to be dropped or repeated
+    void SetDynamicRateControl(bool enable, u32 target, double maxdelta = 0.005);
+
     u8 Read8(u32 addr);
     u16 Read16(u32 addr);
     u32 Read32(u32 addr);
@@ -264,23 +345,58 @@ public:
     void Write32(u32 addr, u32 val);
 
 private:
-    u32 OutputBufferSize = 0;
-    double OutputSampleRate;
-    double OutputSkew = 1.0;
+    std::atomic<u32> OutputBufferSize = 0; // only changed by the writer
+    std::atomic<double> OutputSampleRate;
+    double AppliedSampleRate = 0; // the rate the buffer was last set up for
+    std::atomic<double> OutputSkew = 1.0; // may be set from the audio thread
     melonDS::NDS& NDS;
 
+    bool RateControl = false;
+    u32 RateTarget = 0;
+    double RateMaxDelta = 0;
+    double RateFillAverage = 0;
+    double OutputRatio = 1.0;
+    double OutputClockRate = 0; // clock rate last given to blip_buf
+
+    // rate control settings as last requested, applied by the writer
+    std::atomic<u32> RateTargetRequest = 0; // 0 = disabled
+    std::atomic<double> RateMaxDeltaRequest = 0;
+    std::atomic<bool> RateSettingsChanged = false;
+
+    void UpdateRateControl();
+    void ApplyRateControlSettings();
+    void ApplyOutputRate();
+
     blip_t* BlipLeft;
     blip_t* BlipRight;
     int BlipTimer = 0;
 
-    s16* OutputBuffer;
-    u32 OutputBufferWritePos = 0;
-    u32 OutputBufferReadPos = 0;
+    // positions are free-running counts of stereo samples
+    // OutputBufferSize is the fill limit, the storage is twice the largest limit,
+    // so the writer never touches samples the reader might still be copying
+    static constexpr u32 OutputBufferMaxSize = 8192;
+    static constexpr u32 OutputBufferStorage = OutputBufferMaxSize * 2;
+    s16 OutputBuffer[OutputBufferStorage * 2];
+    std::atomic<u32> OutputBufferWritePos = 0;
+    std::atomic<u32> OutputBufferReadPos = 0;
     s16 OutputLastSamples[2];
 
+    void DiscardOutput(u32 keep);
+
     u32 MixInterval;
 
-    Platform::Mutex* AudioLock;
+    static constexpr u32 MixBatchSize = 32;
+    bool BatchedMixing = false;
+    u64 MixTimestamp = 0; // when the next sample is due, for batched mixing
+
+    void MixSample(u32 spucycles);
+    void MixBlock(u32 spucycles, u32 count);
+    void SkipSamples(u32 spucycles, u32 count);
+    void MixUntil(u64 time);
+    void OutputSample(s32 left, s32 right, s32 ch1, s32 ch3, u32 spucycles);
+    bool CanBatchMix() const;
+    void CatchUp();
+    void FlushMix();
 
     u16 Cnt = 0;
     u8 MasterVolume = 0;
@@ -288,6 +404,7 @@ private:
     bool ApplyBias = true;
     bool Degrade10Bit = false;
     bool Mute;
+    bool OutputEnabled = true;
 
     std::array<SPUChannel, 16> Channels;
     std::array<SPUCaptureUnit, 2> Capture;
@@ -206,6 +206,9 @@ void Wifi::Reset()
 
     USTimestamp = 0;
 
+    BatchTicks = 1;
+    BatchDone = 0;
+
     USCounter = 0;
     USCompare = 0;
     BlockBeaconIRQ14 = false;
@@ -258,6 +261,12 @@ void Wifi::DoSavestate(Savestate* file)
     file->Var16(&Random);
 
     file->Var32((u32*)&TimerError);
+    if (!file->Saving)
+    {
+        // savestates are always made with the timer event on the next tick
+        BatchTicks = 1;
+        BatchDone = 0;
+    }
 
     file->VarArray(BBRegs, 0x100);
     file->VarArray(BBRegsRO, 0x100);
@@ -316,16 +325,140 @@ void Wifi::DoSavestate(Savestate* file)
 }
 
 
+s32 Wifi::GetTimerDelay(u32 ticks, s32 error)
+{
+    s64 cycles = (s64)33513982 * kTimerInterval * ticks;
+    cycles -= error;
+    s32 delay = (s32)((cycles + 999999) / 1000000);
+    TimerError = (s32)((delay * (s64)1000000) - cycles);
+    return delay;
+}
+
 void Wifi::ScheduleTimer(bool first)
 {
     if (first) TimerError = 0;
 
-    s32 cycles = 33513982 * kTimerInterval;
-    cycles -= TimerError;
-    s32 delay = (cycles + 999999) / 1000000;
-    TimerError = (delay * 1000000) - cycles;
+    u32 ticks = first ? 1 : GetIdleTicks();
+
+    BatchTimerError = TimerError;
+    s32 delay = GetTimerDelay(ticks, TimerError);
 
     NDS.ScheduleEvent(Event_Wifi, !first, delay, 0, 0);
+
+    BatchStart = NDS.SchedList[Event_Wifi].Timestamp - delay;
+    BatchTicks = ticks;
+    BatchDone = 0;
+}
+
+u32 Wifi::GetIdleTicks()
+{
+    // number of ticks until the next one where anything other than counting up can happen
+    // (the ticks before it are skipped over and caught up on later)
+    if (USUntilPowerOn < 0)
+        return 1;
+    if (ComStatus || IOPORT(W_TXBusy))
+        return 1;
+
+    u32 ticks = 1024 / kTimerInterval;
+
+    // WifiAP::MSTimer()
+    ticks = std::min(ticks, (u32)((0x400 - (USTimestamp & 0x3FF & kTimeCheckMask)) / kTimerInterval));
+
+    if (IOPORT(W_USCountCnt))
+    {
+        u32 uspart = USCounter & 0x3FF & kTimeCheckMask;
+
+        // MSTimer()
+        ticks = std::min(ticks, (0x400 - uspart) / kTimerInterval);
+
+        // pre-beacon IRQ, BeaconCount1 doesn't change before MSTimer()
+        if (IOPORT(W_USCompareCnt) && (IOPORT(W_BeaconCount1) == (IOPORT(W_PreBeacon) >> 10)))
+        {
+            u32 target = 0x3FF & kTimeCheckMask & ~IOPORT(W_PreBeacon);
+            u32 t = ((target - uspart) & 0x3FF) / kTimerInterval;
+            if (t) ticks = std::min(ticks, t);
+        }
+    }
+
+    if (IsMPClient)
+    {
+        // sync point, then frame reception
+        if (USTimestamp + kTimerInterval >= NextSync)
+            return 1;
+        ticks = std::min<u64>(ticks, (NextSync - USTimestamp + kTimerInterval - 1) / kTimerInterval);
+
+        if (RXTimestamp)
+        {
+            if (USTimestamp + kTimerInterval >= RXTimestamp)
+                return 1;
+            ticks = std::min<u64>(ticks, (RXTimestamp - USTimestamp + kTimerInterval - 1) / kTimerInterval);
+        }
+    }
+    else
+    {
+        // polling for received frames
+        u32 rxpart = RXCounter & 0x1FF & kTimeCheckMask;
+        ticks = std::min(ticks, ((0x200 - rxpart) & 0x1FF) / kTimerInterval + 1);
+    }
+
+    return ticks;
+}
+
+void Wifi::AdvanceIdleTicks(u32 ticks)
+{
+    if (!ticks) return;
+
+    // what USTimer() does on a tick where nothing else happens
+    u32 us = ticks * kTimerInterval;
+
+    USTimestamp += us;
+
+    if (IOPORT(W_USCountCnt))
+        USCounter += us;
+
+    if (IOPORT(W_CmdCountCnt) & 0x0001)
+        CmdCounter = (CmdCounter > us) ? (CmdCounter - us) : 0;
+
+    if (IOPORT(W_ContentFree) > us)
+        IOPORT(W_ContentFree) -= us;
+    else
+        IOPORT(W_ContentFree) = 0;
+
+    RXCounter += us;
+}
+
+void Wifi::CatchUpTimer()
+{
+    if (BatchTicks <= 1) return;
+
+    u64 now = NDS.GetSysClockCycles(0);
+    if (now <= BatchStart) return;
+
+    // tick n of the batch comes ceil((n*cycles - error) / 1000000) cycles after its start
+    u64 ticks = (((now - BatchStart) * 1000000) + BatchTimerError) / ((u64)33513982 * kTimerInterval);
+    if (ticks > (BatchTicks - 1)) ticks = BatchTicks - 1;
+
+    if (ticks > BatchDone)
+    {
+        AdvanceIdleTicks(ticks - BatchDone);
+        BatchDone = ticks;
+    }
+}
+
+void Wifi::FlushTimer()
+{
+    if (BatchTicks <= 1) return;
+
+    CatchUpTimer();
+
+    u32 next = BatchDone + 1;
+    if (next >= BatchTicks) return;
+
+    s32 delay = GetTimerDelay(next, BatchTimerError);
+    BatchTicks = next;
+
+    NDS.CancelEvent(Event_Wifi);
+    NDS.ScheduleEvent(Event_Wifi, false, (s32)(BatchStart + delay - NDS.GetSysClockCycles(0)), 0, 0);
 }
 
 void Wifi::UpdatePowerOn()
@@ -360,7 +493,9 @@ void Wifi::UpdatePowerOn()
     {
         Log(LogLevel::Debug, "WIFI: OFF\n");
 
+        CatchUpTimer();
         NDS.CancelEvent(Event_Wifi);
+        BatchTicks = 1;
 
         Platform::MP_End(NDS.UserData);
     }
@@ -1580,13 +1715,17 @@ bool Wifi::CheckRX(int type) // 0=regular 1=MP replies 2=MP host frames
 
     for (;;)
     {
-        timestamp = 0;
+        // the MP interface is given the current time, some use it to keep instances in sync
+        timestamp = USTimestamp;
 
         if (type == 0)
         {
             rxlen = Platform::MP_RecvPacket(RXBuffer, &timestamp, NDS.UserData);
             if ((rxlen <= 0) && (!IsMP))
+            {
+                timestamp = 0;
                 rxlen = WifiAP->RecvPacket(RXBuffer);
+            }
         }
         else
         {
@@ -1758,8 +1897,13 @@ void Wifi::MSTimer()
 
 void Wifi::USTimer(u32 param)
 {
+    AdvanceIdleTicks(BatchTicks - 1 - BatchDone);
+
     USTimestamp += kTimerInterval;
 
+    // the MP interface gets the time whether or not anything is received
+    Platform::MP_SetTime(USTimestamp, NDS.UserData);
+
     if (IsMPClient && (!ComStatus))
     {
         if (RXTimestamp && (USTimestamp >= RXTimestamp))
@@ -2019,6 +2163,8 @@ u16 Wifi::Read(u32 addr)
 
     bool activeread = (addr < 0x1000);
 
+    CatchUpTimer();
+
     switch (addr)
     {
     case W_Random: // random generator. not accurate
@@ -2121,6 +2267,9 @@ void Wifi::Write(u32 addr, u16 val)
     if (addr >= 0x2000 && addr < 0x4000)
         return;
 
+    // the write may end the idle period
+    FlushTimer();
+
     switch (addr)
     {
     case W_ModeReset:
@@ -163,6 +163,9 @@ public:
     void Reset();
     void DoSavestate(Savestate* file);
 
+    // brings the timer event back to the next tick, if the idle fast path had it further away
+    void FlushTimer();
+
     void SetPowerCnt(u32 val);
 
     void USTimer(u32 param);
@@ -190,6 +193,13 @@ private:
 
     s32 TimerError;
 
+    // idle fast path: when nothing can happen for a while, one timer event covers several ticks,
+    // and the counters are brought up to date for the ticks in between
+    u32 BatchTicks;         // ticks up to the pending timer event, 1 when not idle
+    u32 BatchDone;          // ticks of the batch already caught up on
+    u64 BatchStart;         // time of the tick the batch started from
+    s32 BatchTimerError;
+
     u16 Random;
 
     // general, always-on microsecond counter
@@ -251,7 +261,11 @@ private:
 
     class WifiAP* WifiAP;
 
+    s32 GetTimerDelay(u32 ticks, s32 error);
     void ScheduleTimer(bool first);
+    u32 GetIdleTicks();
+    void AdvanceIdleTicks(u32 ticks);
+    void CatchUpTimer();
     void UpdatePowerOn();
 
     void CheckIRQ(u16 oldflags);
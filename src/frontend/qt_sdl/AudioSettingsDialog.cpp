@@ -45,6 +45,7 @@ AudioSettingsDialog::AudioSettingsDialog(QWidget* parent) : QDialog(parent), ui(
 
     oldInterp = cfg.GetInt("Audio.Interpolation");
     oldBitDepth = cfg.GetInt("Audio.BitDepth");
+    oldBatchedMixing = cfg.GetBool("Audio.BatchedMixing");
     oldVolume = instcfg.GetInt("Audio.Volume");
     oldDSiSync = instcfg.GetBool("Audio.DSiVolumeSync");
 
@@ -63,6 +64,8 @@ AudioSettingsDialog::AudioSettingsDialog(QWidget* parent) : QDialog(parent), ui(
     ui->cbBitDepth->addItem("16-bit");
     ui->cbBitDepth->setCurrentIndex(oldBitDepth);
 
+    ui->chkBatchedMixing->setChecked(oldBatchedMixing);
+
     bool state = ui->slVolume->blockSignals(true);
     ui->slVolume->setValue(oldVolume);
     ui->slVolume->blockSignals(state);
@@ -122,6 +125,7 @@ AudioSettingsDialog::AudioSettingsDialog(QWidget* parent) : QDialog(parent), ui(
         ui->lblInstanceNum->setText(QString("Configuring settings for instance %1").arg(inst+1));
         ui->cbInterpolation->setEnabled(false);
         ui->cbBitDepth->setEnabled(false);
+        ui->chkBatchedMixing->setEnabled(false);
         for (QAbstractButton* btn : grpMicMode->buttons())
             btn->setEnabled(false);
         ui->txtMicWavPath->setEnabled(false);
@@ -180,6 +184,7 @@ void AudioSettingsDialog::on_AudioSettingsDialog_rejected()
     auto& instcfg = emuInstance->getLocalConfig();
     cfg.SetInt("Audio.Interpolation", oldInterp);
     cfg.SetInt("Audio.BitDepth", oldBitDepth);
+    cfg.SetBool("Audio.BatchedMixing", oldBatchedMixing);
     instcfg.SetInt("Audio.Volume", oldVolume);
     instcfg.SetBool("Audio.DSiVolumeSync", oldDSiSync);
 
@@ -211,6 +216,14 @@ void AudioSettingsDialog::on_cbInterpolation_currentIndexChanged(int idx)
     emit updateAudioSettings();
 }
 
+void AudioSettingsDialog::on_chkBatchedMixing_clicked(bool checked)
+{
+    auto& cfg = emuInstance->getGlobalConfig();
+    cfg.SetBool("Audio.BatchedMixing", checked);
+
+    emit updateAudioSettings();
+}
+
 void AudioSettingsDialog::on_slVolume_valueChanged(int val)
 {
     auto& cfg = emuInstance->getLocalConfig();
@@ -68,6 +68,7 @@ private slots:
     void on_cbBitDepth_currentIndexChanged(int idx);
     void on_slVolume_valueChanged(int val);
     void on_chkSyncDSiVolume_clicked(bool checked);
+    void on_chkBatchedMixing_clicked(bool checked);
     void onChangeMicMode(int mode);
     void on_btnMicWavBrowse_clicked();
 
@@ -78,6 +79,7 @@ private:
 
     int oldInterp;
     int oldBitDepth;
+    bool oldBatchedMixing;
     int oldVolume;
     bool oldDSiSync;
     QButtonGroup* grpMicMode;
@@ -141,7 +141,7 @@ EmuInstance::EmuInstance(int inst) : deleting(false),
     if (inst == 0) topWindow = nullptr;
     createWindow();
 
-    emuThread->start();
+    emuThread->launch();
 
     // if any extra windows were saved as enabled, open them
     for (int i = 1; i < kMaxWindows; i++)
@@ -159,7 +159,7 @@ EmuInstance::~EmuInstance()
     deleteAllWindows();
 
     emuThread->emuExit();
-    emuThread->wait();
+    emuThread->join();
     delete emuThread;
     emuThread = nullptr;
 
@@ -1328,7 +1328,8 @@ bool EmuInstance::updateConsole() noexcept
                 std::move(arm7ibios),
                 std::move(nand),
                 std::move(sdcard),
-                globalCfg.GetBool("DSi.DSP.HLE")
+                globalCfg.GetBool("DSi.DSP.HLE"),
+                globalCfg.GetBool("DSi.DSP.Threaded")
         };
 
         dsiargs = std::move(_dsiargs);
@@ -1369,6 +1370,7 @@ bool EmuInstance::updateConsole() noexcept
             DSiArgs& _dsiargs = *dsiargs;
 
             dsi->SetDSPHLE(_dsiargs.DSPHLE);
+            dsi->SetDSPThreaded(_dsiargs.DSPThreaded);
             dsi->ARM7iBIOS = *_dsiargs.ARM7iBIOS;
             dsi->ARM9iBIOS = *_dsiargs.ARM9iBIOS;
             dsi->SetNAND(std::move(_dsiargs.NANDImage));
@@ -1387,6 +1389,8 @@ bool EmuInstance::updateConsole() noexcept
 
     renderLock.unlock();
 
+    nds->SPU.SetBatchedMixing(globalCfg.GetBool("Audio.BatchedMixing"));
+    audioUpdateRateControl();
     loadCheats();
 
     return true;
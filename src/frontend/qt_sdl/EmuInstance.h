@@ -228,7 +228,9 @@ private:
     void toggleAudioMute();
     void updateFastForwardMute(bool fastForward);
     void audioSync();
+    double audioSyncWait();
     void audioUpdateSettings();
+    void audioUpdateRateControl();
 
     void micOpen();
     void micClose();
@@ -316,12 +318,12 @@ private:
     SDL_AudioDeviceID audioDevice;
     int audioFreq;
     int audioBufSize;
+    int audioSyncThreshold;
     float audioSampleFrac;
     bool audioMutedToggle;
     bool audioMutedByFastForward;
     bool audioMutedByWindowFocus;
-    SDL_cond* audioSyncCond;
-    SDL_mutex* audioSyncLock;
+    SDL_sem* audioSyncSem;
 
     int mpAudioMode;
 
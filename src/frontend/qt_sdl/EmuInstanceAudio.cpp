@@ -39,8 +39,7 @@ void EmuInstance::audioInit()
     audioMutedToggle = false;
     audioMutedByFastForward = false;
     audioMutedByWindowFocus = false;
-    audioSyncCond = SDL_CreateCond();
-    audioSyncLock = SDL_CreateMutex();
+    audioSyncSem = SDL_CreateSemaphore(0);
 
     audioFreq = 48000; // TODO: make both of these configurable?
     audioBufSize = 512;
@@ -68,6 +67,7 @@ void EmuInstance::audioInit()
     }
 
     audioSampleFrac = 0;
+    audioSyncThreshold = audioBufSize;
 
     micStarted = false;
     micDevice = 0;
@@ -86,11 +86,8 @@ void EmuInstance::audioDeInit()
     micClose();
     micStarted = false;
 
-    if (audioSyncCond) SDL_DestroyCond(audioSyncCond);
-    audioSyncCond = nullptr;
-
-    if (audioSyncLock) SDL_DestroyMutex(audioSyncLock);
-    audioSyncLock = nullptr;
+    if (audioSyncSem) SDL_DestroySemaphore(audioSyncSem);
+    audioSyncSem = nullptr;
 
     if (micWavBuffer) delete[] micWavBuffer;
     micWavBuffer = nullptr;
@@ -139,16 +136,29 @@ void EmuInstance::audioSync()
 {
     if (audioDevice)
     {
-        SDL_LockMutex(audioSyncLock);
-        while (nds->SPU.GetOutputSize() >= audioBufSize)
+        // the output buffer fill level can be checked without locking
+        // the audio callback posts the semaphore whenever it has consumed samples
+        while (nds->SPU.GetOutputSize() >= audioSyncThreshold)
         {
-            int ret = SDL_CondWaitTimeout(audioSyncCond, audioSyncLock, 500);
+            int ret = SDL_SemWaitTimeout(audioSyncSem, 500);
             if (ret == SDL_MUTEX_TIMEDOUT) break;
         }
-        SDL_UnlockMutex(audioSyncLock);
     }
 }
 
+// how long audioSync() would wait, in seconds, for when the emu thread can't block
+double EmuInstance::audioSyncWait()
+{
+    if (!audioDevice)
+        return 0;
+
+    int excess = nds->SPU.GetOutputSize() - audioSyncThreshold;
+    if (excess < 0)
+        return 0;
+
+    return (excess + 1) / (double)audioFreq;
+}
+
 int EmuInstance::audioGetNumSamplesOut(int outlen)
 {
     float f_len_in = outlen * (curFPS/targetFPS);
@@ -170,10 +180,9 @@ void EmuInstance::audioCallback(void* data, Uint8* stream, int len)
     int len_in = inst->audioGetNumSamplesOut(len);
     if (len_in > inst->audioBufSize) len_in = inst->audioBufSize;
 
-    SDL_LockMutex(inst->audioSyncLock);
     int num_in = inst->nds->SPU.ReadOutput((s16*) stream, len_in);
-    SDL_CondSignal(inst->audioSyncCond);
-    SDL_UnlockMutex(inst->audioSyncLock);
+    if (SDL_SemValue(inst->audioSyncSem) == 0)
+        SDL_SemPost(inst->audioSyncSem);
 
     if ((num_in < 1) || inst->audioMutedByWindowFocus || inst->audioMutedToggle || inst->audioMutedByFastForward)
     {
@@ -504,10 +513,35 @@ void EmuInstance::audioUpdateSettings()
         nds->SPU.SetInterpolation(static_cast<AudioInterpolation>(audiointerp));
     }
 
+    audioUpdateRateControl();
+
     setupMicInputData();
     if (micStarted) micOpen();
 }
 
+void EmuInstance::audioUpdateRateControl()
+{
+    audioSyncThreshold = audioBufSize;
+    if (!nds) return;
+
+    if (!audioDevice || !globalCfg.GetBool("Audio.DynamicRate"))
+    {
+        nds->SPU.SetDynamicRateControl(false, 0);
+        return;
+    }
+
+    // keep the target above one device buffer, otherwise the callback would keep running dry
+    int target = (globalCfg.GetInt("Audio.TargetLatency") * audioFreq) / 1000;
+    target = std::max(target, audioBufSize);
+    target = std::min(target, nds->SPU.GetOutputCapacity() - audioBufSize);
+
+    nds->SPU.SetDynamicRateControl(true, target);
+
+    // let the buffer fill up to the target before throttling the emulation,
+    // the rate control then keeps it there
+    audioSyncThreshold = target + audioBufSize;
+}
+
 void EmuInstance::audioEnable()
 {
     if (audioDevice) SDL_PauseAudioDevice(audioDevice, 0);
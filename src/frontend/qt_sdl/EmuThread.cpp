@@ -44,6 +44,7 @@
 #include "Wifi.h"
 #include "Platform.h"
 #include "LocalMP.h"
+#include "Netplay.h"
 #include "Config.h"
 #include "RTC.h"
 #include "DSi.h"
@@ -54,6 +55,7 @@
 #include "Savestate.h"
 
 #include "EmuInstance.h"
+#include "EmuWorkerPool.h"
 
 using namespace melonDS;
 
@@ -103,10 +105,59 @@ void EmuThread::detachWindow(MainWindow* window)
     }
 }
 
+void EmuThread::launch()
+{
+    // lockstep MP has the instances wait on each other, so they all need to be running at once
+    if (!emuInstance->getGlobalConfig().GetBool("MP.Lockstep"))
+        workerPool = getEmuWorkerPool();
+
+    finished = false;
+    if (workerPool)
+    {
+        onPool = true;
+        workerPool->addTask(this);
+    }
+    else
+        start();
+}
+
+void EmuThread::join()
+{
+    // the instance may move between the pool and its own thread until it's done,
+    // but it's always on at least one of them while moving
+    do
+    {
+        if (workerPool)
+            workerPool->waitTask(this);
+        wait();
+    }
+    while (!finished);
+}
+
 void EmuThread::run()
+{
+    for (;;)
+    {
+        double delay = runSlice();
+        if (delay < 0)
+        {
+            if (onPool)
+            {
+                // going back to the pool, once it's done with our previous stay there
+                workerPool->waitTask(this);
+                workerPool->addTask(this);
+            }
+            break;
+        }
+
+        if (round(delay * 1000.0) > 0.0)
+            SDL_Delay(round(delay * 1000.0));
+    }
+}
+
+void EmuThread::initRun()
 {
     Config::Table& globalCfg = emuInstance->getGlobalConfig();
-    u32 mainScreenPos[3];
 
     //emuInstance->updateConsole();
     // No carts are inserted when melonDS first boots
@@ -134,316 +185,396 @@ void EmuThread::run()
     //updateRenderer();
     videoSettingsDirty = true;
 
-    u32 nframes = 0;
-    double perfCountsSec = 1.0 / SDL_GetPerformanceFrequency();
-    double lastTime = SDL_GetPerformanceCounter() * perfCountsSec;
-    double frameLimitError = 0.0;
-    double lastMeasureTime = lastTime;
-
-    u32 winUpdateCount = 0, winUpdateFreq = 1;
-    u8 dsiVolumeLevel = 0x1F;
+    nframes = 0;
+    netplayStatsCount = 0;
+    perfCountsSec = 1.0 / SDL_GetPerformanceFrequency();
+    lastTime = SDL_GetPerformanceCounter() * perfCountsSec;
+    frameLimitError = 0.0;
+    lastMeasureTime = lastTime;
 
-    char melontitle[100];
+    winUpdateCount = 0;
+    winUpdateFreq = 1;
+    dsiVolumeLevel = 0x1F;
 
-    bool fastforward = false;
-    bool slowmo = false;
+    fastforward = false;
+    slowmo = false;
     emuInstance->fastForwardToggled = false;
     emuInstance->slowmoToggled = false;
 
-    while (emuStatus != emuStatus_Exit)
+    runStarted = true;
+}
+
+double EmuThread::runSlice()
+{
+    if (!runStarted)
+        initRun();
+
+    handleMessages();
+    if (emuStatus == emuStatus_Exit)
     {
-        if (emuInstance->instanceID == 0)
-            MPInterface::Get().Process();
+        onPool = false;
+        finished = true;
+        return -1;
+    }
+
+    // on the worker pool, the GL context being borrowed doesn't hold up the worker
+    if (glBorrowed)
+        return 0.001;
 
-        emuInstance->inputProcess();
+    char melontitle[100];
+    double delay = 0;
 
-        if (emuInstance->hotkeyPressed(HK_FrameLimitToggle)) emit windowLimitFPSChange();
+    if (emuInstance->instanceID == 0)
+        MPInterface::Get().Process();
 
-        if (emuInstance->hotkeyPressed(HK_Pause)) emuTogglePause();
-        if (emuInstance->hotkeyPressed(HK_Reset)) emuReset();
-        if (emuInstance->hotkeyPressed(HK_FrameStep)) emuFrameStep();
+    emuInstance->inputProcess();
 
-        if (emuInstance->hotkeyPressed(HK_FullscreenToggle)) emit windowFullscreenToggle();
+    if (emuInstance->hotkeyPressed(HK_FrameLimitToggle)) emit windowLimitFPSChange();
 
-        if (emuInstance->hotkeyPressed(HK_SwapScreens)) emit swapScreensToggle();
-        if (emuInstance->hotkeyPressed(HK_SwapScreenEmphasis)) emit screenEmphasisToggle();
+    if (emuInstance->hotkeyPressed(HK_Pause)) emuTogglePause();
+    if (emuInstance->hotkeyPressed(HK_Reset)) emuReset();
+    if (emuInstance->hotkeyPressed(HK_FrameStep)) emuFrameStep();
 
-        if (emuStatus == emuStatus_Running || emuStatus == emuStatus_FrameStep)
-        {
-            if (emuStatus == emuStatus_FrameStep) emuStatus = emuStatus_Paused;
+    if (emuInstance->hotkeyPressed(HK_FullscreenToggle)) emit windowFullscreenToggle();
+
+    if (emuInstance->hotkeyPressed(HK_SwapScreens)) emit swapScreensToggle();
+    if (emuInstance->hotkeyPressed(HK_SwapScreenEmphasis)) emit screenEmphasisToggle();
 
-            if (emuInstance->hotkeyPressed(HK_SolarSensorDecrease))
+    if (emuStatus == emuStatus_Running || emuStatus == emuStatus_FrameStep)
+    {
+        if (emuStatus == emuStatus_FrameStep) emuStatus = emuStatus_Paused;
+
+        if (emuInstance->hotkeyPressed(HK_SolarSensorDecrease))
+        {
+            int level = emuInstance->nds->GBACartSlot.SetInput(GBACart::Input_SolarSensorDown, true);
+            if (level != -1)
             {
-                int level = emuInstance->nds->GBACartSlot.SetInput(GBACart::Input_SolarSensorDown, true);
-                if (level != -1)
-                {
-                    emuInstance->osdAddMessage(0, "Solar sensor level: %d", level);
-                }
+                emuInstance->osdAddMessage(0, "Solar sensor level: %d", level);
             }
-            if (emuInstance->hotkeyPressed(HK_SolarSensorIncrease))
+        }
+        if (emuInstance->hotkeyPressed(HK_SolarSensorIncrease))
+        {
+            int level = emuInstance->nds->GBACartSlot.SetInput(GBACart::Input_SolarSensorUp, true);
+            if (level != -1)
             {
-                int level = emuInstance->nds->GBACartSlot.SetInput(GBACart::Input_SolarSensorUp, true);
-                if (level != -1)
-                {
-                    emuInstance->osdAddMessage(0, "Solar sensor level: %d", level);
-                }
+                emuInstance->osdAddMessage(0, "Solar sensor level: %d", level);
             }
+        }
 
-            if (emuInstance->nds->ConsoleType == 1)
+        if (emuInstance->nds->ConsoleType == 1)
+        {
+            DSi* dsi = static_cast<DSi*>(emuInstance->nds);
+            double currentTime = SDL_GetPerformanceCounter() * perfCountsSec;
+
+            // Handle power button
+            if (emuInstance->hotkeyDown(HK_PowerButton))
+            {
+                dsi->I2C.GetBPTWL()->SetPowerButtonHeld(currentTime);
+            }
+            else if (emuInstance->hotkeyReleased(HK_PowerButton))
             {
-                DSi* dsi = static_cast<DSi*>(emuInstance->nds);
-                double currentTime = SDL_GetPerformanceCounter() * perfCountsSec;
+                dsi->I2C.GetBPTWL()->SetPowerButtonReleased(currentTime);
+            }
 
-                // Handle power button
-                if (emuInstance->hotkeyDown(HK_PowerButton))
-                {
-                    dsi->I2C.GetBPTWL()->SetPowerButtonHeld(currentTime);
-                }
-                else if (emuInstance->hotkeyReleased(HK_PowerButton))
-                {
-                    dsi->I2C.GetBPTWL()->SetPowerButtonReleased(currentTime);
-                }
+            // Handle volume buttons
+            if (emuInstance->hotkeyDown(HK_VolumeUp))
+            {
+                dsi->I2C.GetBPTWL()->SetVolumeSwitchHeld(DSi_BPTWL::volumeKey_Up);
+            }
+            else if (emuInstance->hotkeyReleased(HK_VolumeUp))
+            {
+                dsi->I2C.GetBPTWL()->SetVolumeSwitchReleased(DSi_BPTWL::volumeKey_Up);
+            }
 
-                // Handle volume buttons
-                if (emuInstance->hotkeyDown(HK_VolumeUp))
-                {
-                    dsi->I2C.GetBPTWL()->SetVolumeSwitchHeld(DSi_BPTWL::volumeKey_Up);
-                }
-                else if (emuInstance->hotkeyReleased(HK_VolumeUp))
-                {
-                    dsi->I2C.GetBPTWL()->SetVolumeSwitchReleased(DSi_BPTWL::volumeKey_Up);
-                }
+            if (emuInstance->hotkeyDown(HK_VolumeDown))
+            {
+                dsi->I2C.GetBPTWL()->SetVolumeSwitchHeld(DSi_BPTWL::volumeKey_Down);
+            }
+            else if (emuInstance->hotkeyReleased(HK_VolumeDown))
+            {
+                dsi->I2C.GetBPTWL()->SetVolumeSwitchReleased(DSi_BPTWL::volumeKey_Down);
+            }
 
-                if (emuInstance->hotkeyDown(HK_VolumeDown))
-                {
-                    dsi->I2C.GetBPTWL()->SetVolumeSwitchHeld(DSi_BPTWL::volumeKey_Down);
-                }
-                else if (emuInstance->hotkeyReleased(HK_VolumeDown))
-                {
-                    dsi->I2C.GetBPTWL()->SetVolumeSwitchReleased(DSi_BPTWL::volumeKey_Down);
-                }
+            dsi->I2C.GetBPTWL()->ProcessVolumeSwitchInput(currentTime);
+        }
 
-                dsi->I2C.GetBPTWL()->ProcessVolumeSwitchInput(currentTime);
-            }
+        if (useOpenGL)
+            emuInstance->makeCurrentGL();
 
+        // update render settings if needed
+        if (videoSettingsDirty)
+        {
+            emuInstance->renderLock.lock();
             if (useOpenGL)
-                emuInstance->makeCurrentGL();
-
-            // update render settings if needed
-            if (videoSettingsDirty)
             {
-                emuInstance->renderLock.lock();
-                if (useOpenGL)
-                {
-                    emuInstance->setVSyncGL(true);
-                    videoRenderer = globalCfg.GetInt("3D.Renderer");
-                }
+                emuInstance->setVSyncGL(true);
+                videoRenderer = emuInstance->getGlobalConfig().GetInt("3D.Renderer");
+            }
 #ifdef OGLRENDERER_ENABLED
-                else
+            else
 #endif
-                {
-                    videoRenderer = 0;
-                }
+            {
+                videoRenderer = 0;
+            }
 
-                updateRenderer();
+            updateRenderer();
 
-                videoSettingsDirty = false;
-                emuInstance->renderLock.unlock();
-            }
+            videoSettingsDirty = false;
+            emuInstance->renderLock.unlock();
+        }
 
-            // process input and hotkeys
-            emuInstance->nds->SetKeyMask(emuInstance->inputMask);
+        // process input and hotkeys
+        emuInstance->nds->SetKeyMask(emuInstance->inputMask);
 
-            if (emuInstance->isTouching)
-                emuInstance->nds->TouchScreen(emuInstance->touchX, emuInstance->touchY);
-            else
-                emuInstance->nds->ReleaseScreen();
+        if (emuInstance->isTouching)
+            emuInstance->nds->TouchScreen(emuInstance->touchX, emuInstance->touchY);
+        else
+            emuInstance->nds->ReleaseScreen();
+
+        if (emuInstance->hotkeyPressed(HK_Lid))
+        {
+            bool lid = !emuInstance->nds->IsLidClosed();
+            emuInstance->nds->SetLidClosed(lid);
+            emuInstance->osdAddMessage(0, lid ? "Lid closed" : "Lid opened");
+        }
+
+        // auto screen layout
+        {
+            mainScreenPos[2] = mainScreenPos[1];
+            mainScreenPos[1] = mainScreenPos[0];
+            mainScreenPos[0] = emuInstance->nds->PowerControl9 >> 15;
 
-            if (emuInstance->hotkeyPressed(HK_Lid))
+            int guess;
+            if (mainScreenPos[0] == mainScreenPos[2] &&
+                mainScreenPos[0] != mainScreenPos[1])
             {
-                bool lid = !emuInstance->nds->IsLidClosed();
-                emuInstance->nds->SetLidClosed(lid);
-                emuInstance->osdAddMessage(0, lid ? "Lid closed" : "Lid opened");
+                // constant flickering, likely displaying 3D on both screens
+                // TODO: when both screens are used for 2D only...???
+                guess = screenSizing_Even;
             }
-
-            // auto screen layout
+            else
             {
-                mainScreenPos[2] = mainScreenPos[1];
-                mainScreenPos[1] = mainScreenPos[0];
-                mainScreenPos[0] = emuInstance->nds->PowerControl9 >> 15;
-
-                int guess;
-                if (mainScreenPos[0] == mainScreenPos[2] &&
-                    mainScreenPos[0] != mainScreenPos[1])
-                {
-                    // constant flickering, likely displaying 3D on both screens
-                    // TODO: when both screens are used for 2D only...???
-                    guess = screenSizing_Even;
-                }
+                if (mainScreenPos[0] == 1)
+                    guess = screenSizing_EmphTop;
                 else
-                {
-                    if (mainScreenPos[0] == 1)
-                        guess = screenSizing_EmphTop;
-                    else
-                        guess = screenSizing_EmphBot;
-                }
+                    guess = screenSizing_EmphBot;
+            }
 
-                if (guess != autoScreenSizing)
-                {
-                    autoScreenSizing = guess;
-                    emit autoScreenSizingChange(autoScreenSizing);
-                }
+            if (guess != autoScreenSizing)
+            {
+                autoScreenSizing = guess;
+                emit autoScreenSizingChange(autoScreenSizing);
             }
+        }
 
-            // RTC sync
-            emuInstance->syncRTC();
+        // RTC sync
+        emuInstance->syncRTC();
 
 
-            // emulate
-            u32 nlines;
-            if (emuInstance->nds->GPU.GetRenderer().NeedsShaderCompile())
-            {
-                compileShaders();
-                nlines = 1;
-            }
-            else
-            {
-                nlines = emuInstance->nds->RunFrame();
-            }
+        // emulate
+        u32 nlines;
+        if (emuInstance->nds->GPU.GetRenderer().NeedsShaderCompile())
+        {
+            compileShaders();
+            nlines = 1;
+        }
+        else
+        {
+            nlines = emuInstance->nds->RunFrame();
+        }
 
-            if (emuInstance->ndsSave)
-                emuInstance->ndsSave->CheckFlush();
+        if (emuInstance->ndsSave)
+            emuInstance->ndsSave->CheckFlush();
 
-            if (emuInstance->gbaSave)
-                emuInstance->gbaSave->CheckFlush();
+        if (emuInstance->gbaSave)
+            emuInstance->gbaSave->CheckFlush();
 
-            if (emuInstance->firmwareSave)
-                emuInstance->firmwareSave->CheckFlush();
+        if (emuInstance->firmwareSave)
+            emuInstance->firmwareSave->CheckFlush();
 
-            emuInstance->drawScreen();
+        emuInstance->drawScreen();
 
 #ifdef MELONCAP
-            MelonCap::Update();
+        MelonCap::Update();
 #endif // MELONCAP
 
-            winUpdateCount++;
-            if (winUpdateCount >= winUpdateFreq && !useOpenGL)
-            {
-                emit windowUpdate();
-                winUpdateCount = 0;
-            }
-            
-            if (emuInstance->hotkeyPressed(HK_FastForwardToggle)) emuInstance->fastForwardToggled = !emuInstance->fastForwardToggled;
-            if (emuInstance->hotkeyPressed(HK_SlowMoToggle)) emuInstance->slowmoToggled = !emuInstance->slowmoToggled;
+        winUpdateCount++;
+        if (winUpdateCount >= winUpdateFreq && !useOpenGL)
+        {
+            emit windowUpdate();
+            winUpdateCount = 0;
+        }
+        
+        if (emuInstance->hotkeyPressed(HK_FastForwardToggle)) emuInstance->fastForwardToggled = !emuInstance->fastForwardToggled;
+        if (emuInstance->hotkeyPressed(HK_SlowMoToggle)) emuInstance->slowmoToggled = !emuInstance->slowmoToggled;
 
-            if (emuInstance->hotkeyPressed(HK_AudioMuteToggle)) emuInstance->toggleAudioMute();
+        if (emuInstance->hotkeyPressed(HK_AudioMuteToggle)) emuInstance->toggleAudioMute();
 
-            bool enablefastforward = emuInstance->hotkeyDown(HK_FastForward) | emuInstance->fastForwardToggled;
-            bool enableslowmo = emuInstance->hotkeyDown(HK_SlowMo) | emuInstance->slowmoToggled;
+        bool enablefastforward = emuInstance->hotkeyDown(HK_FastForward) | emuInstance->fastForwardToggled;
+        bool enableslowmo = emuInstance->hotkeyDown(HK_SlowMo) | emuInstance->slowmoToggled;
 
-            if (useOpenGL)
+        if (useOpenGL)
+        {
+            // when using OpenGL: when toggling fast-forward or slowmo, change the vsync interval
+            if ((enablefastforward || enableslowmo) && !(fastforward || slowmo))
             {
-                // when using OpenGL: when toggling fast-forward or slowmo, change the vsync interval
-                if ((enablefastforward || enableslowmo) && !(fastforward || slowmo))
-                {
-                    emuInstance->setVSyncGL(false);
-                }
-                else if (!(enablefastforward || enableslowmo) && (fastforward || slowmo))
-                {
-                    emuInstance->setVSyncGL(true);
-                }
+                emuInstance->setVSyncGL(false);
             }
+            else if (!(enablefastforward || enableslowmo) && (fastforward || slowmo))
+            {
+                emuInstance->setVSyncGL(true);
+            }
+        }
 
-            fastforward = enablefastforward;
-            slowmo = enableslowmo;
-            emuInstance->updateFastForwardMute(fastforward);
+        fastforward = enablefastforward;
+        slowmo = enableslowmo;
+        emuInstance->updateFastForwardMute(fastforward);
 
-            if (slowmo) emuInstance->curFPS = emuInstance->slowmoFPS;
-            else if (fastforward) emuInstance->curFPS = emuInstance->fastForwardFPS;
-            else if (!emuInstance->doLimitFPS && !emuInstance->doAudioSync) emuInstance->curFPS = 1000.0;
-            else emuInstance->curFPS = emuInstance->targetFPS;
+        if (slowmo) emuInstance->curFPS = emuInstance->slowmoFPS;
+        else if (fastforward) emuInstance->curFPS = emuInstance->fastForwardFPS;
+        else if (!emuInstance->doLimitFPS && !emuInstance->doAudioSync) emuInstance->curFPS = 1000.0;
+        else emuInstance->curFPS = emuInstance->targetFPS;
 
-            if (emuInstance->audioDSiVolumeSync && emuInstance->nds->ConsoleType == 1)
+        if (emuInstance->audioDSiVolumeSync && emuInstance->nds->ConsoleType == 1)
+        {
+            DSi* dsi = static_cast<DSi*>(emuInstance->nds);
+            u8 volumeLevel = dsi->I2C.GetBPTWL()->GetVolumeLevel();
+            if (volumeLevel != dsiVolumeLevel)
             {
-                DSi* dsi = static_cast<DSi*>(emuInstance->nds);
-                u8 volumeLevel = dsi->I2C.GetBPTWL()->GetVolumeLevel();
-                if (volumeLevel != dsiVolumeLevel)
-                {
-                    dsiVolumeLevel = volumeLevel;
-                    emit syncVolumeLevel();
-                }
-
-                emuInstance->audioVolume = volumeLevel * (256.0 / 31.0);
+                dsiVolumeLevel = volumeLevel;
+                emit syncVolumeLevel();
             }
 
-            if (emuInstance->doAudioSync && !(fastforward || slowmo))
+            emuInstance->audioVolume = volumeLevel * (256.0 / 31.0);
+        }
+
+        double audiowait = 0;
+        if (emuInstance->doAudioSync && !(fastforward || slowmo))
+        {
+            // on the worker pool, the wait is added to the delay before the next frame instead
+            if (onPool)
+                audiowait = emuInstance->audioSyncWait();
+            else
                 emuInstance->audioSync();
+        }
 
-            double frametimeStep = nlines / (emuInstance->curFPS * 263.0);
+        double frametimeStep = nlines / (emuInstance->curFPS * 263.0);
 
-            if (frametimeStep < 0.001) frametimeStep = 0.001;
+        if (frametimeStep < 0.001) frametimeStep = 0.001;
 
-            if (emuInstance->doLimitFPS)
+        if (emuInstance->doLimitFPS)
+        {
+            // counted as if the audio wait was already over, like audioSync() does
+            double curtime = SDL_GetPerformanceCounter() * perfCountsSec + audiowait;
+
+            frameLimitError += frametimeStep - (curtime - lastTime);
+            if (frameLimitError < -frametimeStep)
+                frameLimitError = -frametimeStep;
+            if (frameLimitError > frametimeStep)
+                frameLimitError = frametimeStep;
+
+            // the wait before the next frame is counted right away
+            // if it ends up longer than that, it shows up in the next frame's time
+            if (round(frameLimitError * 1000.0) > 0.0)
             {
-                double curtime = SDL_GetPerformanceCounter() * perfCountsSec;
+                delay = round(frameLimitError * 1000.0) / 1000.0;
+                frameLimitError -= delay;
+                curtime += delay;
+            }
 
-                frameLimitError += frametimeStep - (curtime - lastTime);
-                if (frameLimitError < -frametimeStep)
-                    frameLimitError = -frametimeStep;
-                if (frameLimitError > frametimeStep)
-                    frameLimitError = frametimeStep;
+            lastTime = curtime;
+        }
 
-                if (round(frameLimitError * 1000.0) > 0.0)
-                {
-                    SDL_Delay(round(frameLimitError * 1000.0));
-                    double timeBeforeSleep = curtime;
-                    curtime = SDL_GetPerformanceCounter() * perfCountsSec;
-                    frameLimitError -= curtime - timeBeforeSleep;
-                }
+        delay += audiowait;
 
-                lastTime = curtime;
-            }
+        nframes++;
+        if (nframes >= 30)
+        {
+            double time = SDL_GetPerformanceCounter() * perfCountsSec;
+            double dt = time - lastMeasureTime;
+            lastMeasureTime = time;
+
+            u32 fps = round(nframes / dt);
+            nframes = 0;
 
-            nframes++;
-            if (nframes >= 30)
+            float fpstarget = 1.0/frametimeStep;
+
+            winUpdateFreq = fps / (u32)round(fpstarget);
+            if (winUpdateFreq < 1)
+                winUpdateFreq = 1;
+                
+            double actualfps = (59.8261 * 263.0) / nlines;
+            snprintf(melontitle, sizeof(melontitle), "[%d/%.0f] melonDS " MELONDS_VERSION, fps, actualfps);
+            changeWindowTitle(melontitle);
+        }
+
+        // one stats message at a time: they stay on screen for about as long as this
+        if (Netplay::Active)
+        {
+            netplayStatsCount++;
+            if (netplayStatsCount >= 150)
             {
-                double time = SDL_GetPerformanceCounter() * perfCountsSec;
-                double dt = time - lastMeasureTime;
-                lastMeasureTime = time;
-
-                u32 fps = round(nframes / dt);
-                nframes = 0;
-
-                float fpstarget = 1.0/frametimeStep;
-
-                winUpdateFreq = fps / (u32)round(fpstarget);
-                if (winUpdateFreq < 1)
-                    winUpdateFreq = 1;
-                    
-                double actualfps = (59.8261 * 263.0) / nlines;
-                snprintf(melontitle, sizeof(melontitle), "[%d/%.0f] melonDS " MELONDS_VERSION, fps, actualfps);
-                changeWindowTitle(melontitle);
+                netplayStatsCount = 0;
+
+                if (emuInstance->getGlobalConfig().GetBool("Netplay.ShowStats"))
+                {
+                    Netplay::Stats stats;
+                    Netplay::GetStats(stats);
+                    emuInstance->osdAddMessage(0, "RTT %u ms, jitter %u, delay %u, waits %u (last %.1f ms), rollbacks %u/%u, %u B/frame",
+                                               stats.RTT, stats.Jitter, stats.InputDelay,
+                                               stats.WaitFrames, stats.LastWaitTime / 1000.0,
+                                               stats.Rollbacks, stats.ResimulatedFrames, stats.LastFrameBytesSent);
+                }
             }
         }
-        else
-        {
-            // paused
-            nframes = 0;
-            lastTime = SDL_GetPerformanceCounter() * perfCountsSec;
-            lastMeasureTime = lastTime;
+    }
+    else
+    {
+        // paused
+        nframes = 0;
+        lastTime = SDL_GetPerformanceCounter() * perfCountsSec;
+        lastMeasureTime = lastTime;
 
-            emit windowUpdate();
+        emit windowUpdate();
 
-            snprintf(melontitle, sizeof(melontitle), "melonDS " MELONDS_VERSION);
-            changeWindowTitle(melontitle);
+        snprintf(melontitle, sizeof(melontitle), "melonDS " MELONDS_VERSION);
+        changeWindowTitle(melontitle);
+
+        emuInstance->drawScreen();
 
-            SDL_Delay(75);
+        delay = 0.075;
+    }
+
+    // on the worker pool, the next slice may run on another thread
+    if (onPool && useOpenGL)
+        emuInstance->releaseGL();
 
-            emuInstance->drawScreen();
+    // an instance that does MP with other instances in this process may have to wait on them,
+    // which would hold up the pool (the one being waited on may be queued behind it)
+    // so it goes on on its own thread for as long as that lasts
+    if (workerPool)
+    {
+        bool ownthread = MPInterface::Get().WaitsOnLocalInstances(emuInstance->instanceID);
+        if (onPool && ownthread)
+        {
+            // the pool is done with us once we return
+            // the thread may still be on its way out from going back to the pool
+            onPool = false;
+            wait();
+            start();
+            return -1;
         }
+        else if (!onPool && !ownthread)
+        {
+            if (useOpenGL)
+                emuInstance->releaseGL();
 
-        handleMessages();
+            onPool = true;
+            return -1;
+        }
     }
+
+    return delay;
 }
 
 void EmuThread::sendMessage(Message msg)
@@ -453,15 +584,22 @@ void EmuThread::sendMessage(Message msg)
     msgMutex.unlock();
 }
 
+bool EmuThread::onEmuThread()
+{
+    // emu threads don't wait on each other: on the worker pool,
+    // the one being waited on may be queued behind the one waiting
+    return (QThread::currentThread() == this) || EmuWorkerPool::isWorkerThread();
+}
+
 void EmuThread::waitMessage(int num)
 {
-    if (QThread::currentThread() == this) return;
+    if (onEmuThread()) return;
     msgSemaphore.acquire(num);
 }
 
 void EmuThread::waitAllMessages()
 {
-    if (QThread::currentThread() == this) return;
+    if (onEmuThread()) return;
     while (!msgQueue.empty())
         msgSemaphore.acquire();
 }
@@ -563,7 +701,10 @@ void EmuThread::handleMessages()
 
         case msg_BorrowGL:
             emuInstance->releaseGL();
-            glborrow = true;
+            if (onPool)
+                glBorrowed = true;
+            else
+                glborrow = true;
             break;
 
         case msg_BootROM:
@@ -652,6 +793,12 @@ void EmuThread::handleMessages()
         case msg_EnableCheats:
             emuInstance->enableCheats(msg.param.value<bool>());
             break;
+
+        case msg_SetBatchedMixing:
+            // this reschedules the SPU, so it can't be done from the UI thread
+            if (emuInstance->nds)
+                emuInstance->nds->SPU.SetBatchedMixing(msg.param.value<bool>());
+            break;
         }
 
         msgSemaphore.release();
@@ -691,6 +838,8 @@ void EmuThread::borrowGL()
 
 void EmuThread::returnGL()
 {
+    glBorrowed = false;
+
     glBorrowMutex.lock();
     glBorrowCond.wakeAll();
     glBorrowMutex.unlock();
@@ -855,6 +1004,12 @@ void EmuThread::enableCheats(bool enable)
     waitMessage();
 }
 
+void EmuThread::setBatchedMixing(bool enable)
+{
+    sendMessage({.type = msg_SetBatchedMixing, .param = enable});
+    waitMessage();
+}
+
 void EmuThread::updateRenderer()
 {
     auto nds = emuInstance->nds;
@@ -33,6 +33,7 @@
 
 #include "NDSCart.h"
 #include "GBACart.h"
+#include "EmuWorkerPool.h"
 
 namespace melonDS
 {
@@ -43,7 +44,7 @@ class EmuInstance;
 class MainWindow;
 class ScreenPanelGL;
 
-class EmuThread : public QThread
+class EmuThread : public QThread, public EmuWorkerPool::Task
 {
     Q_OBJECT
     void run() override;
@@ -51,6 +52,12 @@ class EmuThread : public QThread
 public:
     explicit EmuThread(EmuInstance* inst, QObject* parent = nullptr);
 
+    // starts the emu thread, either as its own thread or on the worker pool
+    void launch();
+    void join();
+
+    double runSlice() override;
+
     void attachWindow(MainWindow* window);
     void detachWindow(MainWindow* window);
 
@@ -84,6 +91,7 @@ public:
         msg_ImportSavefile,
 
         msg_EnableCheats,
+        msg_SetBatchedMixing,
     };
 
     struct Message
@@ -126,6 +134,7 @@ public:
     int importSavefile(const QString& filename);
 
     void enableCheats(bool enable);
+    void setBatchedMixing(bool enable);
 
     bool emuIsRunning();
     bool emuIsActive();
@@ -161,6 +170,8 @@ signals:
     void syncVolumeLevel();
 
 private:
+    void initRun();
+    bool onEmuThread();
     void handleMessages();
 
     void updateRenderer();
@@ -191,11 +202,27 @@ private:
 
     EmuInstance* emuInstance;
 
+    EmuWorkerPool* workerPool = nullptr; // the pool the instance was started on, if any
+    bool onPool = false;
+    std::atomic<bool> finished = false;
+    std::atomic<bool> glBorrowed = false;
+    bool runStarted = false;
+
+    melonDS::u32 mainScreenPos[3];
     int autoScreenSizing;
 
     int lastVideoRenderer = -1;
 
     double perfCountsSec;
+    double lastTime;
+    double lastMeasureTime;
+    double frameLimitError;
+    melonDS::u32 nframes;
+    melonDS::u32 netplayStatsCount;
+    melonDS::u32 winUpdateCount, winUpdateFreq;
+    melonDS::u8 dsiVolumeLevel;
+    bool fastforward;
+    bool slowmo;
 
     bool useOpenGL;
     int videoRenderer;
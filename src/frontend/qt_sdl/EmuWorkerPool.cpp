@@ -0,0 +1,179 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <algorithm>
+
+#include "EmuWorkerPool.h"
+
+// how often an idle worker checks whether there is anything to steal
+const auto kStealInterval = std::chrono::milliseconds(1);
+
+static thread_local bool onWorkerThread = false;
+
+
+EmuWorkerPool::EmuWorkerPool(int numworkers)
+{
+    numworkers = std::max(numworkers, 1);
+
+    for (int i = 0; i < numworkers; i++)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (int i = 0; i < numworkers; i++)
+        workers[i]->thread = std::thread(&EmuWorkerPool::workerLoop, this, i);
+}
+
+EmuWorkerPool::~EmuWorkerPool()
+{
+    exiting = true;
+    idleCond.notify_all();
+
+    for (auto& worker : workers)
+        worker->thread.join();
+}
+
+bool EmuWorkerPool::isWorkerThread()
+{
+    return onWorkerThread;
+}
+
+void EmuWorkerPool::addTask(Task* task)
+{
+    int id;
+    {
+        std::lock_guard lock(tasksLock);
+        tasks.push_back(task);
+
+        id = nextWorker;
+        nextWorker = (nextWorker + 1) % workers.size();
+    }
+
+    {
+        Worker& worker = *workers[id];
+        std::lock_guard lock(worker.queueLock);
+        worker.queue.push_back({task, Clock::now()});
+    }
+
+    idleCond.notify_all();
+}
+
+void EmuWorkerPool::waitTask(Task* task)
+{
+    std::unique_lock lock(tasksLock);
+    tasksCond.wait(lock, [&]
+    {
+        return std::find(tasks.begin(), tasks.end(), task) == tasks.end();
+    });
+}
+
+void EmuWorkerPool::finishTask(Task* task)
+{
+    {
+        std::lock_guard lock(tasksLock);
+        tasks.erase(std::find(tasks.begin(), tasks.end(), task));
+    }
+
+    tasksCond.notify_all();
+}
+
+bool EmuWorkerPool::takeTask(int id, Entry& entry, Clock::time_point& nextdue)
+{
+    Worker& self = *workers[id];
+    std::lock_guard lock(self.queueLock);
+
+    nextdue = Clock::time_point::max();
+    if (self.queue.empty())
+        return false;
+
+    auto first = std::min_element(self.queue.begin(), self.queue.end(),
+                                  [](const Entry& a, const Entry& b) { return a.due < b.due; });
+
+    if (first->due > Clock::now())
+    {
+        nextdue = first->due;
+        return false;
+    }
+
+    entry = *first;
+    self.queue.erase(first);
+    return true;
+}
+
+bool EmuWorkerPool::stealTask(int id, Entry& entry)
+{
+    int numworkers = workers.size();
+    Clock::time_point now = Clock::now();
+
+    for (int i = 1; i < numworkers; i++)
+    {
+        Worker& victim = *workers[(id + i) % numworkers];
+
+        // a worker that is busy with its queue will be done with it soon enough
+        std::unique_lock lock(victim.queueLock, std::try_to_lock);
+        if (!lock.owns_lock())
+            continue;
+
+        // anything that is due but still queued is waiting on a busy worker
+        auto first = std::min_element(victim.queue.begin(), victim.queue.end(),
+                                      [](const Entry& a, const Entry& b) { return a.due < b.due; });
+
+        if (first == victim.queue.end() || first->due > now)
+            continue;
+
+        entry = *first;
+        victim.queue.erase(first);
+        return true;
+    }
+
+    return false;
+}
+
+void EmuWorkerPool::workerLoop(int id)
+{
+    Worker& self = *workers[id];
+    onWorkerThread = true;
+
+    while (!exiting)
+    {
+        Entry entry;
+        Clock::time_point nextdue;
+
+        if (takeTask(id, entry, nextdue) || stealTask(id, entry))
+        {
+            double delay = entry.task->runSlice();
+            if (delay < 0)
+            {
+                finishTask(entry.task);
+                continue;
+            }
+
+            // a stolen task stays with the worker that stole it
+            entry.due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delay));
+
+            std::lock_guard lock(self.queueLock);
+            self.queue.push_back(entry);
+            continue;
+        }
+
+        // nothing to do: sleep until our next task is due, checking on the others meanwhile
+        Clock::time_point wakeup = std::min(nextdue, Clock::now() + kStealInterval);
+
+        std::unique_lock lock(idleLock);
+        if (!exiting)
+            idleCond.wait_until(lock, wakeup);
+    }
+}
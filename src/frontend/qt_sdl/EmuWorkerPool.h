@@ -0,0 +1,101 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef EMUWORKERPOOL_H
+#define EMUWORKERPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed-size pool of threads that emu instances can run on, instead of each having its own
+//
+// instances are run one slice (one frame) at a time. after each slice, an instance says
+// how long it wants to wait before the next one, which is how frame pacing is done.
+// every worker has its own queue of instances; a worker that has nothing due steals
+// the instances that are overdue on other workers, which moves them over for good,
+// so instances end up spread over the workers according to how much time they take.
+//
+// slices are expected to be short: an instance that blocks for a long time (waiting
+// on another instance, for example) holds up whatever else is queued on its worker.
+// instances that need to do that leave the pool and go on on their own thread,
+// and come back once they don't anymore.
+class EmuWorkerPool
+{
+public:
+    class Task
+    {
+    public:
+        virtual ~Task() = default;
+
+        // returns how long to wait before the next slice (in seconds),
+        // or a negative value when the task is done
+        virtual double runSlice() = 0;
+    };
+
+    explicit EmuWorkerPool(int numworkers);
+    EmuWorkerPool(const EmuWorkerPool&) = delete;
+    EmuWorkerPool& operator=(const EmuWorkerPool&) = delete;
+    ~EmuWorkerPool();
+
+    int getNumWorkers() const { return (int)workers.size(); }
+
+    // the task must stay alive until waitTask() has returned for it
+    void addTask(Task* task);
+    void waitTask(Task* task);
+
+    static bool isWorkerThread();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Task* task;
+        Clock::time_point due;
+    };
+
+    struct Worker
+    {
+        std::mutex queueLock;
+        std::vector<Entry> queue;
+        std::thread thread;
+    };
+
+    void workerLoop(int id);
+    bool takeTask(int id, Entry& entry, Clock::time_point& nextdue);
+    bool stealTask(int id, Entry& entry);
+    void finishTask(Task* task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> exiting = false;
+
+    std::mutex idleLock;
+    std::condition_variable idleCond;
+
+    std::mutex tasksLock;
+    std::condition_variable tasksCond;
+    std::vector<Task*> tasks;
+    int nextWorker = 0;
+};
+
+#endif // EMUWORKERPOOL_H
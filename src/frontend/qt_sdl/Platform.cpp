@@ -511,6 +511,12 @@ u16 MP_RecvReplies(u8* data, u64 timestamp, u16 aidmask, void* userdata)
     return MPInterface::Get().RecvReplies(inst, data, timestamp, aidmask);
 }
 
+void MP_SetTime(u64 timestamp, void* userdata)
+{
+    int inst = ((EmuInstance*)userdata)->getInstanceID();
+    MPInterface::Get().SetTime(inst, timestamp);
+}
+
 
 int Net_SendPacket(u8* data, int len, void* userdata)
 {
@@ -1777,7 +1777,7 @@ void MainWindow::updateMPInterface(MPInterfaceType type)
 
     // MP interface was changed, reflect it in the UI
 
-    bool enable = (type == MPInterface_Local);
+    bool enable = (type == MPInterface_Local) || (type == MPInterface_Lockstep) || (type == MPInterface_SharedMem);
     actMPNewInstance->setEnabled(enable);
     actLANStartHost->setEnabled(enable);
     actLANStartClient->setEnabled(enable);
@@ -1941,6 +1941,8 @@ void MainWindow::onUpdateAudioSettings()
         emuInstance->nds->SPU.SetDegrade10Bit(emuInstance->nds->ConsoleType == 0);
     else
         emuInstance->nds->SPU.SetDegrade10Bit(bitdepth == 1);
+
+    emuThread->setBatchedMixing(globalCfg.GetBool("Audio.BatchedMixing"));
 }
 
 void MainWindow::onAudioSettingsFinished(int res)
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -55,6 +56,7 @@
 #include "Config.h"
 
 #include "EmuInstance.h"
+#include "EmuWorkerPool.h"
 #include "ArchiveUtil.h"
 #include "CameraManager.h"
 #include "MPInterface.h"
@@ -81,6 +83,8 @@ bool camStarted[2];
 std::optional<LibPCap> pcap;
 Net net;
 
+std::unique_ptr<EmuWorkerPool> emuWorkerPool;
+
 
 QElapsedTimer sysTimer;
 
@@ -136,6 +140,22 @@ bool createEmuInstance()
     return true;
 }
 
+EmuWorkerPool* getEmuWorkerPool()
+{
+    // with Emu.WorkerThreads set, instances run on a shared pool of that many threads
+    // the pool is only created once: changing its size takes effect after a restart
+    if (!emuWorkerPool)
+    {
+        int numthreads = Config::GetGlobalTable().GetInt("Emu.WorkerThreads");
+        if (numthreads <= 0)
+            return nullptr;
+
+        emuWorkerPool = std::make_unique<EmuWorkerPool>(numthreads);
+    }
+
+    return emuWorkerPool.get();
+}
+
 void deleteEmuInstance(int id)
 {
     auto inst = emuInstances[id];
@@ -216,8 +236,34 @@ void pathInit()
 
 void setMPInterface(MPInterfaceType type)
 {
-    // switch to the requested MP interface
-    MPInterface::Set(type);
+    // local MP can run in lockstep, for reproducible results
+    // or go through shared memory, to reach instances running in other processes
+    if (type == MPInterface_Local && Config::GetGlobalTable().GetBool("MP.Lockstep"))
+        type = MPInterface_Lockstep;
+    else if (type == MPInterface_Local && Config::GetGlobalTable().GetBool("MP.SharedMemory"))
+        type = MPInterface_SharedMem;
+
+    // instead of other instances, a MP capture can be played back to a single one
+    std::string replay = Config::GetGlobalTable().GetString("MP.ReplayFile");
+    if (type == MPInterface_Local && !replay.empty() &&
+        MPInterface::SetReplay(replay, Config::GetGlobalTable().GetInt("MP.ReplayInstance")))
+    {
+        type = MPInterface_Replay;
+    }
+    else
+    {
+        // switch to the requested MP interface
+        MPInterface::Set(type);
+        if (type == MPInterface_SharedMem && MPInterface::GetType() != type)
+        {
+            type = MPInterface_Local;
+            MPInterface::Set(type);
+        }
+
+        std::string capture = Config::GetGlobalTable().GetString("MP.CaptureFile");
+        if (!capture.empty())
+            MPInterface::StartCapture(capture);
+    }
 
     // set receive timeout
     // TODO: different settings per interface?
@@ -431,6 +477,7 @@ int main(int argc, char** argv)
     // if we get here, all the existing emu instances should have been deleted already
     // but with this we make extra sure they are all deleted
     deleteAllEmuInstances();
+    emuWorkerPool = nullptr;
 
     delete camManager[0];
     delete camManager[1];
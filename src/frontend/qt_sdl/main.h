@@ -63,4 +63,6 @@ void broadcastInstanceCommand(int cmd, QVariant& param, int sourceinst);
 
 void setMPInterface(melonDS::MPInterfaceType type);
 
+EmuWorkerPool* getEmuWorkerPool();
+
 #endif // MAIN_H
@@ -0,0 +1,229 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef BROADCASTRING_H
+#define BROADCASTRING_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "types.h"
+
+namespace melonDS
+{
+
+// ring of fixed-size frame slots shared by up to 16 readers, without a lock
+//
+// a frame is written once, straight into its slot, along with the mask of readers it is for.
+// every reader has its own cursor and reads frames in place, skipping those not meant for it.
+// writers never wait for readers: a slot is reused as soon as the ring comes around to it,
+// whether or not everyone has read it, so a reader that falls a whole ring behind loses what
+// it hadn't read yet. readers check that their slot wasn't overwritten while they were reading.
+// so the ring holds NumSlots frames at most, whatever their size.
+//
+// slot sequence numbers: 2*pos+1 while the frame at ring position pos is being written,
+// 2*pos+2 once it is published
+//
+// when the ring is shared between processes (CrossProcess), a writer can die halfway through
+// a frame, which would otherwise leave its slot blocked for good. so a frame that has been
+// claimed but not published for kStuckTimeout is given up on: readers skip it, and the next
+// writer for that slot takes it over. BeginWrite() then returns nullptr to a writer whose frame
+// was given up on, and EndWrite() false. a writer that is merely stalled for that long may have
+// its frame mixed up with the one that took its slot over.
+template <typename HeaderT, u32 DataSize, u32 NumSlots, bool CrossProcess = false>
+class BroadcastRing
+{
+public:
+    static constexpr int kMaxReaders = 16;
+    static constexpr std::chrono::milliseconds kStuckTimeout {1000};
+
+    struct Slot
+    {
+        std::atomic<u64> Seq = 0;
+        std::atomic<u16> Readers = 0; // readers this frame is for
+        u64 Pos;
+        HeaderT Header;
+        u8 Data[DataSize];
+    };
+
+    BroadcastRing() noexcept = default;
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+    // claims the next slot, to be filled in and then passed to EndWrite()
+    Slot* BeginWrite() noexcept
+    {
+        u64 pos = WritePos.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = Slots[pos % NumSlots];
+
+        // the previous frame in this slot may still be being written, if there are a lot of writers
+        u64 prev = (pos < NumSlots) ? 0 : (2 * (pos - NumSlots) + 2);
+        Clock::time_point waitstart {};
+        for (;;)
+        {
+            u64 expected = prev;
+            if (slot.Seq.compare_exchange_weak(expected, 2 * pos + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+
+            if constexpr (CrossProcess)
+            {
+                // a later writer took the slot over, we waited too long
+                if (expected > prev)
+                    return nullptr;
+
+                // the frame before is stuck, its writer is most likely gone
+                Clock::time_point now = Clock::now();
+                if (waitstart == Clock::time_point())
+                    waitstart = now;
+                else if ((now - waitstart) >= kStuckTimeout &&
+                         slot.Seq.compare_exchange_strong(expected, 2 * pos + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    break;
+            }
+
+            std::this_thread::yield();
+        }
+
+        slot.Pos = pos;
+        return &slot;
+    }
+
+    bool EndWrite(Slot* slot, u16 readers) noexcept
+    {
+        slot->Readers.store(readers, std::memory_order_relaxed);
+
+        if constexpr (CrossProcess)
+        {
+            u64 expected = 2 * slot->Pos + 1;
+            return slot->Seq.compare_exchange_strong(expected, 2 * slot->Pos + 2, std::memory_order_release, std::memory_order_relaxed);
+        }
+
+        slot->Seq.store(2 * slot->Pos + 2, std::memory_order_release);
+        return true;
+    }
+
+    // returns the next frame for the given reader, or nullptr if there is none yet
+    // the frame stays in place until Pop() is called
+    const Slot* Peek(int reader, bool* overrun = nullptr) noexcept
+    {
+        if (overrun) *overrun = false;
+
+        for (;;)
+        {
+            u64 pos = Cursors[reader].load(std::memory_order_relaxed);
+            Slot& slot = Slots[pos % NumSlots];
+
+            u64 seq = slot.Seq.load(std::memory_order_acquire);
+            if (seq == (2 * pos + 2))
+            {
+                u16 readers = slot.Readers.load(std::memory_order_relaxed);
+                if (slot.Seq.load(std::memory_order_acquire) != seq)
+                    continue; // overwritten meanwhile, will show up as overrun below
+
+                if (readers & (1 << reader))
+                    return &slot;
+
+                // not for us
+                Cursors[reader].store(pos + 1, std::memory_order_relaxed);
+                continue;
+            }
+
+            if (seq <= (2 * pos + 1))
+            {
+                // not written yet, or still being written
+                if constexpr (CrossProcess)
+                {
+                    if (SkipStuck(reader, pos))
+                        continue;
+                }
+                return nullptr;
+            }
+
+            // the writers went all the way around: everything pending for us is gone
+            if (overrun) *overrun = true;
+            Reset(reader);
+            return nullptr;
+        }
+    }
+
+    // done reading the frame returned by Peek()
+    // returns false if the frame was overwritten while it was being read
+    bool Pop(int reader, const Slot* slot) noexcept
+    {
+        u64 pos = Cursors[reader].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->Seq.load(std::memory_order_relaxed) != (2 * pos + 2))
+        {
+            Reset(reader);
+            return false;
+        }
+
+        Cursors[reader].store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // drops everything pending for the given reader
+    void Reset(int reader) noexcept
+    {
+        Cursors[reader].store(WritePos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        StuckSince[reader] = 0;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // moves the reader past the frame at pos if it has been claimed, but left unpublished
+    // for too long
+    bool SkipStuck(int reader, u64 pos) noexcept
+    {
+        if (WritePos.load(std::memory_order_relaxed) <= pos)
+        {
+            // nobody is writing it yet
+            StuckSince[reader] = 0;
+            return false;
+        }
+
+        s64 now = Clock::now().time_since_epoch().count();
+        if (!StuckSince[reader] || StuckPos[reader] != pos)
+        {
+            StuckPos[reader] = pos;
+            StuckSince[reader] = now;
+            return false;
+        }
+
+        if (Clock::duration(now - StuckSince[reader]) < kStuckTimeout)
+            return false;
+
+        StuckSince[reader] = 0;
+        Cursors[reader].store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::atomic<u64> WritePos = 0;
+    std::atomic<u64> Cursors[kMaxReaders] {};
+
+    // only used by each reader itself
+    u64 StuckPos[kMaxReaders] {};
+    s64 StuckSince[kMaxReaders] {};
+    Slot Slots[NumSlots];
+};
+
+}
+
+#endif // BROADCASTRING_H
@@ -0,0 +1,114 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <atomic>
+
+#include "types.h"
+
+namespace melonDS
+{
+
+// bounded queue of fixed-size frame slots, with any number of writers and a single reader,
+// without a lock
+//
+// unlike BroadcastRing, nothing that was queued is ever lost: when the queue is full,
+// BeginWrite() returns nullptr and the writer gets to decide what to do with its frame.
+// a frame is written straight into its slot, and read in place.
+//
+// slot sequence numbers: pos when the slot is free for the frame at queue position pos,
+// pos+1 once that frame is published
+template <typename HeaderT, u32 DataSize, u32 NumSlots>
+class FrameQueue
+{
+public:
+    struct Slot
+    {
+        std::atomic<u64> Seq;
+        u64 Pos;
+        HeaderT Header;
+        u8 Data[DataSize];
+    };
+
+    FrameQueue() noexcept
+    {
+        for (u32 i = 0; i < NumSlots; i++)
+            Slots[i].Seq.store(i, std::memory_order_relaxed);
+    }
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    // claims the next slot, to be filled in and then passed to EndWrite()
+    // returns nullptr if the queue is full
+    Slot* BeginWrite() noexcept
+    {
+        u64 pos = WritePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = Slots[pos % NumSlots];
+            s64 diff = (s64)(slot.Seq.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0)
+            {
+                if (WritePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.Pos = pos;
+                    return &slot;
+                }
+            }
+            else if (diff < 0)
+                return nullptr; // the reader hasn't freed this slot yet
+            else
+                pos = WritePos.load(std::memory_order_relaxed); // another writer got there first
+        }
+    }
+
+    void EndWrite(Slot* slot) noexcept
+    {
+        slot->Seq.store(slot->Pos + 1, std::memory_order_release);
+    }
+
+    // returns the next frame, or nullptr if there is none yet
+    // the frame stays in place until Pop() is called
+    const Slot* Peek() const noexcept
+    {
+        const Slot& slot = Slots[ReadPos % NumSlots];
+        if (slot.Seq.load(std::memory_order_acquire) != (ReadPos + 1))
+            return nullptr;
+
+        return &slot;
+    }
+
+    // done reading the frame returned by Peek()
+    void Pop() noexcept
+    {
+        Slots[ReadPos % NumSlots].Seq.store(ReadPos + NumSlots, std::memory_order_release);
+        ReadPos++;
+    }
+
+private:
+    std::atomic<u64> WritePos = 0;
+    u64 ReadPos = 0; // only used by the reader
+    Slot Slots[NumSlots];
+};
+
+}
+
+#endif // FRAMEQUEUE_H
@@ -0,0 +1,71 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <algorithm>
+#include <math.h>
+
+#include "InputDelay.h"
+#include "Platform.h"
+
+using namespace melonDS;
+using Platform::Log;
+using Platform::LogLevel;
+
+namespace Netplay
+{
+
+InputDelayController::InputDelayController(u32 delay) noexcept
+{
+    SetDelay(delay);
+}
+
+void InputDelayController::SetDelay(u32 delay) noexcept
+{
+    Delay = std::clamp(delay, kMinDelay, kMaxDelay);
+    BetterFrames = 0;
+}
+
+u32 InputDelayController::Update(u32 rtt, u32 jitter, double frametime) noexcept
+{
+    double time = (rtt * 0.5) + (jitter * kJitterMargin) + kExtraTime;
+    u32 needed = (u32)ceil(time / frametime);
+    needed = std::clamp(needed, kMinDelay, kMaxDelay);
+
+    if (needed > Delay)
+    {
+        Log(LogLevel::Debug, "Netplay: input delay %u -> %u (RTT=%u jitter=%u)\n", Delay, needed, rtt, jitter);
+        Delay = needed;
+        BetterFrames = 0;
+    }
+    else if (needed < Delay)
+    {
+        BetterFrames++;
+        if (BetterFrames >= kDecreaseFrames)
+        {
+            Log(LogLevel::Debug, "Netplay: input delay %u -> %u (RTT=%u jitter=%u)\n", Delay, Delay-1, rtt, jitter);
+            Delay--;
+            BetterFrames = 0;
+        }
+    }
+    else
+        BetterFrames = 0;
+
+    return Delay;
+}
+
+}
@@ -0,0 +1,60 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef INPUTDELAY_H
+#define INPUTDELAY_H
+
+#include "types.h"
+
+namespace Netplay
+{
+
+// picks the input delay from the measured round-trip time and jitter
+//
+// input for a frame has to reach the other side before it runs that frame, so the delay
+// has to cover the one-way trip, plus some margin for jitter. the delay goes up as soon
+// as the connection gets worse, as every frame short means a stall; it only comes down
+// once the connection has been better for a while, one frame at a time.
+class InputDelayController
+{
+public:
+    static constexpr melonDS::u32 kMinDelay = 1;
+    static constexpr melonDS::u32 kMaxDelay = 15;
+
+    InputDelayController(melonDS::u32 delay) noexcept;
+
+    // feeds the connection stats for one frame, returns the input delay to use
+    // rtt and jitter are in milliseconds, frametime is the length of a frame in milliseconds
+    melonDS::u32 Update(melonDS::u32 rtt, melonDS::u32 jitter, double frametime) noexcept;
+
+    melonDS::u32 GetDelay() const noexcept { return Delay; }
+    void SetDelay(melonDS::u32 delay) noexcept;
+
+private:
+    // frames the connection needs to be better for before the delay is lowered
+    static constexpr melonDS::u32 kDecreaseFrames = 180;
+    static constexpr double kJitterMargin = 2.0;
+    static constexpr double kExtraTime = 4.0; // ms, for the time it takes to process input
+
+    melonDS::u32 Delay;
+    melonDS::u32 BetterFrames = 0;
+};
+
+}
+
+#endif // INPUTDELAY_H
@@ -30,14 +30,9 @@ namespace melonDS
 {
 
 LocalMP::LocalMP() noexcept :
-    MPQueueLock(Mutex_Create())
+    Packets(std::make_unique<PacketRing>()),
+    Replies(std::make_unique<ReplyRing>())
 {
-    memset(MPPacketQueue, 0, kPacketQueueSize);
-    memset(MPReplyQueue, 0, kReplyQueueSize);
-    memset(&MPStatus, 0, sizeof(MPStatus));
-    memset(PacketReadOffset, 0, sizeof(PacketReadOffset));
-    memset(ReplyReadOffset, 0, sizeof(ReplyReadOffset));
-
     // prepare semaphores
     // semaphores 0-15: regular frames; semaphore I is posted when instance I needs to process a new frame
     // semaphores 16-31: MP replies; semaphore I is posted when instance I needs to process a new MP reply
@@ -57,96 +52,26 @@ LocalMP::~LocalMP() noexcept
         Semaphore_Free(SemPool[i]);
         SemPool[i] = nullptr;
     }
-
-    Mutex_Free(MPQueueLock);
 }
 
 void LocalMP::Begin(int inst)
 {
-    Mutex_Lock(MPQueueLock);
-    PacketReadOffset[inst] = MPStatus.PacketWriteOffset;
-    ReplyReadOffset[inst] = MPStatus.ReplyWriteOffset;
+    Packets->Reset(inst);
+    Replies->Reset(inst);
     Semaphore_Reset(SemPool[inst]);
     Semaphore_Reset(SemPool[16 + inst]);
-    MPStatus.ConnectedBitmask |= (1 << inst);
-    Mutex_Unlock(MPQueueLock);
+    ConnectedBitmask.fetch_or(1 << inst, std::memory_order_acq_rel);
 }
 
 void LocalMP::End(int inst)
 {
-    Mutex_Lock(MPQueueLock);
-    MPStatus.ConnectedBitmask &= ~(1 << inst);
-    Mutex_Unlock(MPQueueLock);
+    ConnectedBitmask.fetch_and(~(1 << inst), std::memory_order_acq_rel);
 }
 
-void LocalMP::FIFORead(int inst, int fifo, void* buf, int len) noexcept
+bool LocalMP::WaitsOnLocalInstances(int inst)
 {
-    u8* data;
-
-    u32 offset, datalen;
-    if (fifo == 0)
-    {
-        offset = PacketReadOffset[inst];
-        data = MPPacketQueue;
-        datalen = kPacketQueueSize;
-    }
-    else
-    {
-        offset = ReplyReadOffset[inst];
-        data = MPReplyQueue;
-        datalen = kReplyQueueSize;
-    }
-
-    if ((offset + len) >= datalen)
-    {
-        u32 part1 = datalen - offset;
-        memcpy(buf, &data[offset], part1);
-        memcpy(&((u8*)buf)[part1], data, len - part1);
-        offset = len - part1;
-    }
-    else
-    {
-        memcpy(buf, &data[offset], len);
-        offset += len;
-    }
-
-    if (fifo == 0) PacketReadOffset[inst] = offset;
-    else           ReplyReadOffset[inst] = offset;
-}
-
-void LocalMP::FIFOWrite(int inst, int fifo, void* buf, int len) noexcept
-{
-    u8* data;
-
-    u32 offset, datalen;
-    if (fifo == 0)
-    {
-        offset = MPStatus.PacketWriteOffset;
-        data = MPPacketQueue;
-        datalen = kPacketQueueSize;
-    }
-    else
-    {
-        offset = MPStatus.ReplyWriteOffset;
-        data = MPReplyQueue;
-        datalen = kReplyQueueSize;
-    }
-
-    if ((offset + len) >= datalen)
-    {
-        u32 part1 = datalen - offset;
-        memcpy(&data[offset], buf, part1);
-        memcpy(data, &((u8*)buf)[part1], len - part1);
-        offset = len - part1;
-    }
-    else
-    {
-        memcpy(&data[offset], buf, len);
-        offset += len;
-    }
-
-    if (fifo == 0) MPStatus.PacketWriteOffset = offset;
-    else           MPStatus.ReplyWriteOffset = offset;
+    u16 mask = ConnectedBitmask.load(std::memory_order_acquire);
+    return (mask & (1 << inst)) && (mask & ~(1 << inst));
 }
 
 int LocalMP::SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 timestamp) noexcept
@@ -157,11 +82,7 @@ int LocalMP::SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 time
         return 0;
     }
 
-    Mutex_Lock(MPQueueLock);
-
-    u16 mask = MPStatus.ConnectedBitmask;
-
-    // TODO: check if the FIFO is full!
+    u16 mask = ConnectedBitmask.load(std::memory_order_acquire);
 
     MPPacketHeader pktheader;
     pktheader.Magic = 0x4946494E;
@@ -171,38 +92,44 @@ int LocalMP::SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 time
     pktheader.Timestamp = timestamp;
 
     type &= 0xFFFF;
-    int nfifo = (type == 2) ? 1 : 0;
-    FIFOWrite(inst, nfifo, &pktheader, sizeof(pktheader));
-    if (len)
-        FIFOWrite(inst, nfifo, packet, len);
+
+    if (type == 2)
+    {
+        // replies only go to the host
+        u16 host = MPHostInst.load(std::memory_order_acquire);
+        MPReplyBitmask.fetch_or(1 << inst, std::memory_order_relaxed);
+
+        ReplyRing::Slot* slot = Replies->BeginWrite();
+        slot->Header = pktheader;
+        if (len) memcpy(slot->Data, packet, len);
+        Replies->EndWrite(slot, 1 << host);
+
+        Semaphore_Post(SemPool[16 + host]);
+        return len;
+    }
 
     if (type == 1)
     {
         // NOTE: this is not guarded against, say, multiple multiplay games happening on the same machine
         // we would need to pass the packet's SenderID through the wifi module for that
-        MPStatus.MPHostinst = inst;
-        MPStatus.MPReplyBitmask = 0;
-        ReplyReadOffset[inst] = MPStatus.ReplyWriteOffset;
+        // leftover replies are dropped before the CMD goes out, so none of the new ones are
+        MPHostInst.store(inst, std::memory_order_release);
+        MPReplyBitmask.store(0, std::memory_order_relaxed);
+        Replies->Reset(inst);
         Semaphore_Reset(SemPool[16 + inst]);
     }
-    else if (type == 2)
-    {
-        MPStatus.MPReplyBitmask |= (1 << inst);
-    }
 
-    Mutex_Unlock(MPQueueLock);
+    mask &= ~(1 << inst);
 
-    if (type == 2)
-    {
-        Semaphore_Post(SemPool[16 +  MPStatus.MPHostinst]);
-    }
-    else
+    PacketRing::Slot* slot = Packets->BeginWrite();
+    slot->Header = pktheader;
+    if (len) memcpy(slot->Data, packet, len);
+    Packets->EndWrite(slot, mask);
+
+    for (int i = 0; i < 16; i++)
     {
-        for (int i = 0; i < 16; i++)
-        {
-            if (mask & (1<<i))
-                Semaphore_Post(SemPool[i]);
-        }
+        if (mask & (1<<i))
+            Semaphore_Post(SemPool[i]);
     }
 
     return len;
@@ -212,47 +139,40 @@ int LocalMP::RecvPacketGeneric(int inst, u8* packet, bool block, u64* timestamp)
 {
     for (;;)
     {
-        if (!Semaphore_TryWait(SemPool[inst], block ? RecvTimeout : 0))
+        // the semaphore is only for waiting: a frame is taken as soon as it is in
+        bool overrun;
+        const PacketRing::Slot* slot = Packets->Peek(inst, &overrun);
+        if (slot)
         {
-            return 0;
+            MPPacketHeader pktheader = slot->Header;
+            if (pktheader.Length)
+                memcpy(packet, slot->Data, pktheader.Length);
+
+            if (!Packets->Pop(inst, slot))
+                overrun = true;
+            else
+            {
+                Semaphore_TryWait(SemPool[inst], 0);
+
+                if (pktheader.Length && pktheader.Type == 1)
+                    LastHostID = pktheader.SenderID;
+
+                if (timestamp) *timestamp = pktheader.Timestamp;
+                return pktheader.Length;
+            }
         }
 
-        Mutex_Lock(MPQueueLock);
-
-        MPPacketHeader pktheader = {};
-        FIFORead(inst, 0, &pktheader, sizeof(pktheader));
-
-        if (pktheader.Magic != 0x4946494E)
+        if (overrun)
         {
             Log(LogLevel::Warn, "PACKET FIFO OVERFLOW\n");
-            PacketReadOffset[inst] = MPStatus.PacketWriteOffset;
             Semaphore_Reset(SemPool[inst]);
-            Mutex_Unlock(MPQueueLock);
             return 0;
         }
 
-        if (pktheader.SenderID == inst)
-        {
-            // skip this packet
-            PacketReadOffset[inst] += pktheader.Length;
-            if (PacketReadOffset[inst] >= kPacketQueueSize)
-                PacketReadOffset[inst] -= kPacketQueueSize;
-
-            Mutex_Unlock(MPQueueLock);
-            continue;
-        }
-
-        if (pktheader.Length)
+        if (!Semaphore_TryWait(SemPool[inst], block ? RecvTimeout : 0))
         {
-            FIFORead(inst, 0, packet, pktheader.Length);
-
-            if (pktheader.Type == 1)
-                LastHostID = pktheader.SenderID;
+            return 0;
         }
-
-        if (timestamp) *timestamp = pktheader.Timestamp;
-        Mutex_Unlock(MPQueueLock);
-        return pktheader.Length;
     }
 }
 
@@ -287,7 +207,7 @@ int LocalMP::RecvHostPacket(int inst, u8* packet, u64* timestamp)
     {
         // check if the host is still connected
 
-        u16 curinstmask = MPStatus.ConnectedBitmask;
+        u16 curinstmask = ConnectedBitmask.load(std::memory_order_acquire);
 
         if (!(curinstmask & (1 << LastHostID)))
             return -1;
@@ -302,7 +222,7 @@ u16 LocalMP::RecvReplies(int inst, u8* packets, u64 timestamp, u16 aidmask)
     u16 myinstmask = (1 << inst);
     u16 curinstmask;
 
-    curinstmask = MPStatus.ConnectedBitmask;
+    curinstmask = ConnectedBitmask.load(std::memory_order_acquire);
 
     // if all clients have left: return early
     if ((myinstmask & curinstmask) == curinstmask)
@@ -310,58 +230,60 @@ u16 LocalMP::RecvReplies(int inst, u8* packets, u64 timestamp, u16 aidmask)
 
     for (;;)
     {
-        if (!Semaphore_TryWait(SemPool[16+inst], RecvTimeout))
+        bool overrun;
+        const ReplyRing::Slot* slot = Replies->Peek(inst, &overrun);
+        if (!slot)
         {
-            // no more replies available
-            return ret;
-        }
-
-        Mutex_Lock(MPQueueLock);
-
-        MPPacketHeader pktheader = {};
-        FIFORead(inst, 1, &pktheader, sizeof(pktheader));
+            if (overrun)
+            {
+                Log(LogLevel::Warn, "REPLY FIFO OVERFLOW\n");
+                Semaphore_Reset(SemPool[16 + inst]);
+                return 0;
+            }
+
+            if (!Semaphore_TryWait(SemPool[16+inst], RecvTimeout))
+            {
+                // no more replies available
+                return ret;
+            }
 
-        if (pktheader.Magic != 0x4946494E)
-        {
-            Log(LogLevel::Warn, "REPLY FIFO OVERFLOW\n");
-            ReplyReadOffset[inst] = MPStatus.ReplyWriteOffset;
-            Semaphore_Reset(SemPool[16 + inst]);
-            Mutex_Unlock(MPQueueLock);
-            return 0;
+            continue;
         }
 
+        MPPacketHeader pktheader = slot->Header;
+
         if ((pktheader.SenderID == inst) || // packet we sent out (shouldn't happen, but hey)
             (pktheader.Timestamp < (timestamp - 32))) // stale packet
         {
             // skip this packet
-            ReplyReadOffset[inst] += pktheader.Length;
-            if (ReplyReadOffset[inst] >= kReplyQueueSize)
-                ReplyReadOffset[inst] -= kReplyQueueSize;
-
-            Mutex_Unlock(MPQueueLock);
+            Replies->Pop(inst, slot);
+            Semaphore_TryWait(SemPool[16+inst], 0);
             continue;
         }
 
         if (pktheader.Length)
         {
             u32 aid = (pktheader.Type >> 16);
-            FIFORead(inst, 1, &packets[(aid-1)*1024], pktheader.Length);
+            memcpy(&packets[(aid-1)*1024], slot->Data, pktheader.Length);
             ret |= (1 << aid);
         }
 
+        if (!Replies->Pop(inst, slot))
+        {
+            Log(LogLevel::Warn, "REPLY FIFO OVERFLOW\n");
+            Semaphore_Reset(SemPool[16 + inst]);
+            return 0;
+        }
+        Semaphore_TryWait(SemPool[16+inst], 0);
+
         myinstmask |= (1 << pktheader.SenderID);
         if (((myinstmask & curinstmask) == curinstmask) ||
             ((ret & aidmask) == aidmask))
         {
             // all the clients have sent their reply
-
-            Mutex_Unlock(MPQueueLock);
             return ret;
         }
-
-        Mutex_Unlock(MPQueueLock);
     }
 }
 
 }
-
@@ -19,23 +19,16 @@
 #ifndef LOCALMP_H
 #define LOCALMP_H
 
+#include <atomic>
+#include <memory>
+
 #include "types.h"
 #include "Platform.h"
 #include "MPInterface.h"
+#include "BroadcastRing.h"
 
 namespace melonDS
 {
-struct MPStatusData
-{
-    u16 ConnectedBitmask; // bitmask of which instances are ready to send/receive packets
-    u32 PacketWriteOffset;
-    u32 ReplyWriteOffset;
-    u16 MPHostinst; // instance ID from which the last CMD frame was sent
-    u16 MPReplyBitmask;   // bitmask of which clients replied in time
-};
-
-constexpr u32 kPacketQueueSize = 0x10000;
-constexpr u32 kReplyQueueSize = 0x10000;
 constexpr u32 kMaxFrameSize = 0x948;
 
 class LocalMP : public MPInterface
@@ -61,18 +54,28 @@ public:
     int RecvHostPacket(int inst, u8* data, u64* timestamp);
     u16 RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask);
 
+    bool WaitsOnLocalInstances(int inst);
+
 private:
-    void FIFORead(int inst, int fifo, void* buf, int len) noexcept;
-    void FIFOWrite(int inst, int fifo, void* buf, int len) noexcept;
+    // the rings hold this many frames, however small they are; this used to be 64K of FIFO
+    // space, which was good for a few hundred small frames. an instance that falls further
+    // behind than that loses the frames it missed
+    static constexpr u32 kPacketSlots = 64;
+    static constexpr u32 kReplySlots = 32;
+
+    // frames are written once for all the instances they're for, and read from there
+    using PacketRing = BroadcastRing<MPPacketHeader, kMaxFrameSize, kPacketSlots>;
+    using ReplyRing = BroadcastRing<MPPacketHeader, kMaxFrameSize, kReplySlots>;
+
     int SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 timestamp) noexcept;
     int RecvPacketGeneric(int inst, u8* packet, bool block, u64* timestamp) noexcept;
 
-    Platform::Mutex* MPQueueLock;
-    MPStatusData MPStatus {};
-    u8 MPPacketQueue[kPacketQueueSize] {};
-    u8 MPReplyQueue[kReplyQueueSize] {};
-    u32 PacketReadOffset[16] {};
-    u32 ReplyReadOffset[16] {};
+    std::atomic<u16> ConnectedBitmask = 0; // bitmask of which instances are ready to send/receive packets
+    std::atomic<u16> MPHostInst = 0; // instance ID from which the last CMD frame was sent
+    std::atomic<u16> MPReplyBitmask = 0; // bitmask of which clients replied in time
+
+    std::unique_ptr<PacketRing> Packets;
+    std::unique_ptr<ReplyRing> Replies;
 
     int LastHostID = -1;
     Platform::Semaphore* SemPool[32] {};
@@ -0,0 +1,442 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <cstring>
+#include <thread>
+
+#include "LockstepMP.h"
+#include "Platform.h"
+
+using namespace melonDS;
+using namespace melonDS::Platform;
+
+using Platform::Log;
+using Platform::LogLevel;
+
+namespace melonDS
+{
+
+// an instance joining more than this far behind the others (in microseconds) has its
+// timestamps moved forward, instead of making everyone wait for it to catch up
+const u64 kJoinSlack = 1000000;
+
+// after handing out a MP CMD, the host doesn't transmit anything during the reply window
+// (the shortest one is 112us), so it can let the others run that far ahead while waiting.
+// replies timestamped up to kReplyWindow after the CMD ends count as having been received
+const u64 kReplyPromise = 112;
+const u64 kReplyWindow = 64;
+
+// packets still not received after this long (in microseconds) are dropped
+const u64 kMaxPacketAge = 1000000;
+
+const u64 kDisconnected = UINT64_MAX;
+
+
+LockstepMP::LockstepMP() noexcept :
+    Instances(std::make_unique<Instance[]>(kMaxInstances))
+{
+    Log(LogLevel::Info, "MP comm init OK (lockstep)\n");
+}
+
+LockstepMP::~LockstepMP() noexcept
+{
+}
+
+void LockstepMP::Begin(int inst)
+{
+    Instance& self = Instances[inst];
+
+    // drop whatever was left over from a previous session
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        self.Packets[i].ReadPos.store(self.Packets[i].WritePos.load(std::memory_order_acquire), std::memory_order_release);
+        self.Replies[i].ReadPos.store(self.Replies[i].WritePos.load(std::memory_order_acquire), std::memory_order_release);
+        self.PendingPackets[i].clear();
+        self.PendingReplies[i].clear();
+    }
+
+    // the clock starts at zero until the first timestamp comes in,
+    // so nobody gets ahead of this instance meanwhile
+    self.Now = 0;
+    self.Offset = 0;
+    self.OffsetPending = true;
+    self.LastHostID = -1;
+    self.Clock.store(0, std::memory_order_release);
+
+    ConnectedBitmask.fetch_or(1 << inst, std::memory_order_acq_rel);
+}
+
+void LockstepMP::End(int inst)
+{
+    ConnectedBitmask.fetch_and(~(1 << inst), std::memory_order_acq_rel);
+    Instances[inst].Clock.store(kDisconnected, std::memory_order_release);
+}
+
+bool LockstepMP::WaitsOnLocalInstances(int inst)
+{
+    u16 mask = ConnectedBitmask.load(std::memory_order_acquire);
+    return (mask & (1 << inst)) && (mask & ~(1 << inst));
+}
+
+u64 LockstepMP::ToGlobalTime(int inst, u64 timestamp) noexcept
+{
+    Instance& self = Instances[inst];
+
+    if (self.OffsetPending)
+    {
+        self.OffsetPending = false;
+
+        u16 mask = ConnectedBitmask.load(std::memory_order_acquire) & ~(1 << inst);
+        u64 latest = 0;
+        for (int i = 0; i < kMaxInstances; i++)
+        {
+            if (!(mask & (1 << i))) continue;
+
+            u64 clock = Instances[i].Clock.load(std::memory_order_acquire);
+            if (clock != kDisconnected && clock > latest)
+                latest = clock;
+        }
+
+        if (latest > (timestamp + kJoinSlack))
+            self.Offset = latest - timestamp;
+    }
+
+    return timestamp + self.Offset;
+}
+
+void LockstepMP::SetClock(int inst, u64 now, u64 clock) noexcept
+{
+    Instance& self = Instances[inst];
+
+    if (now > self.Now)
+        self.Now = now;
+
+    // the clock is a promise not to send anything before it, so it can't go back
+    if (clock > self.Clock.load(std::memory_order_relaxed))
+        self.Clock.store(clock, std::memory_order_release);
+}
+
+bool LockstepMP::IsPast(int inst, u64 time, int other) const noexcept
+{
+    // ties are broken by instance ID, so two instances at the same time can't wait on each other
+    u64 clock = Instances[other].Clock.load(std::memory_order_acquire);
+    return (clock > time) || (clock == time && other > inst);
+}
+
+void LockstepMP::WaitForOthers(int inst, u64 time) noexcept
+{
+    for (int tries = 0;; tries++)
+    {
+        u16 mask = ConnectedBitmask.load(std::memory_order_acquire) & ~(1 << inst);
+
+        bool ready = true;
+        for (int i = 0; i < kMaxInstances; i++)
+        {
+            if (!(mask & (1 << i))) continue;
+            if (!IsPast(inst, time, i))
+            {
+                ready = false;
+                break;
+            }
+        }
+
+        if (ready) return;
+
+        // someone we wait for may in turn be waiting for room in our mailboxes
+        DrainMailboxes(inst);
+
+        // the others are usually only a few microseconds of emulation away
+        if (tries < 64)
+            std::this_thread::yield();
+        else
+            Platform::Sleep(20);
+    }
+}
+
+template <u32 Slots>
+void LockstepMP::MailboxPush(int inst, int receiver, Mailbox<Slots>& mailbox, const MPPacketHeader& header, const u8* data) noexcept
+{
+    u32 writepos = mailbox.WritePos.load(std::memory_order_relaxed);
+    for (int tries = 0;; tries++)
+    {
+        u32 readpos = mailbox.ReadPos.load(std::memory_order_acquire);
+        if ((writepos - readpos) < Slots)
+            break;
+
+        // the receiver makes room on its next wifi tick, unless it's gone
+        if (!(ConnectedBitmask.load(std::memory_order_acquire) & (1 << receiver)))
+            return;
+
+        // the receiver may be waiting for room in our mailboxes too
+        DrainMailboxes(inst);
+
+        if (tries < 64)
+            std::this_thread::yield();
+        else
+            Platform::Sleep(20);
+    }
+
+    Message& msg = mailbox.Messages[writepos % Slots];
+    msg.Header = header;
+    if (header.Length)
+        memcpy(msg.Data, data, header.Length);
+
+    mailbox.WritePos.store(writepos + 1, std::memory_order_release);
+}
+
+template <u32 Slots>
+void LockstepMP::MailboxDrain(Mailbox<Slots>& mailbox, std::deque<Message>& pending, u64 now) noexcept
+{
+    u32 readpos = mailbox.ReadPos.load(std::memory_order_relaxed);
+    u32 writepos = mailbox.WritePos.load(std::memory_order_acquire);
+    for (; readpos != writepos; readpos++)
+    {
+        const Message& src = mailbox.Messages[readpos % Slots];
+        Message& msg = pending.emplace_back();
+        msg.Header = src.Header;
+        if (src.Header.Length)
+            memcpy(msg.Data, src.Data, src.Header.Length);
+    }
+    mailbox.ReadPos.store(readpos, std::memory_order_release);
+
+    // a sender's packets are in time order, so the oldest ones are at the front
+    while (!pending.empty() && (pending.front().Header.Timestamp + kMaxPacketAge) < now)
+        pending.pop_front();
+}
+
+void LockstepMP::DrainMailboxes(int inst) noexcept
+{
+    Instance& self = Instances[inst];
+
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        if (i == inst) continue;
+
+        MailboxDrain(self.Packets[i], self.PendingPackets[i], self.Now);
+        MailboxDrain(self.Replies[i], self.PendingReplies[i], self.Now);
+    }
+}
+
+int LockstepMP::SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 timestamp) noexcept
+{
+    if (len > kMaxFrameSize)
+    {
+        Log(LogLevel::Warn, "wifi: attempting to send frame too big (len=%d max=%d)\n", len, kMaxFrameSize);
+        return 0;
+    }
+
+    u64 time = ToGlobalTime(inst, timestamp);
+
+    MPPacketHeader pktheader;
+    pktheader.Magic = 0x4946494E;
+    pktheader.SenderID = inst;
+    pktheader.Type = type;
+    pktheader.Length = len;
+    pktheader.Timestamp = time;
+
+    u16 mask = ConnectedBitmask.load(std::memory_order_acquire) & ~(1 << inst);
+
+    if ((type & 0xFFFF) == 2)
+    {
+        int host = MPHostInst.load(std::memory_order_acquire);
+        if (host >= 0 && (mask & (1 << host)))
+            MailboxPush(inst, host, Instances[host].Replies[inst], pktheader, packet);
+    }
+    else
+    {
+        if ((type & 0xFFFF) == 1)
+            MPHostInst.store(inst, std::memory_order_release);
+
+        for (int i = 0; i < kMaxInstances; i++)
+        {
+            if (!(mask & (1 << i))) continue;
+
+            MailboxPush(inst, i, Instances[i].Packets[inst], pktheader, packet);
+        }
+    }
+
+    // only move the clock once the packet is in, so it's there for anyone who sees the new clock
+    SetClock(inst, time, time);
+    return len;
+}
+
+int LockstepMP::RecvPacketGeneric(int inst, u8* packet, u64* timestamp) noexcept
+{
+    Instance& self = Instances[inst];
+
+    // the timestamp passed in is the receiver's current time
+    u64 now = ToGlobalTime(inst, *timestamp);
+    SetClock(inst, now, now);
+    WaitForOthers(inst, now);
+
+    // everything up to now is in, now that the others are past it
+    DrainMailboxes(inst);
+
+    // take the oldest packet that is in the past for us
+    // senders are visited in order, so equal timestamps always come out the same way
+    int sender = -1;
+    u64 sendertime = 0;
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        if (i == inst) continue;
+
+        auto& pending = self.PendingPackets[i];
+        if (pending.empty())
+            continue;
+
+        u64 time = pending.front().Header.Timestamp;
+        if (time > now || (time == now && i > inst))
+            continue;
+
+        if (sender == -1 || time < sendertime)
+        {
+            sender = i;
+            sendertime = time;
+        }
+    }
+
+    if (sender == -1)
+        return 0;
+
+    auto& pending = self.PendingPackets[sender];
+    const Message& msg = pending.front();
+
+    int len = msg.Header.Length;
+    if (len)
+    {
+        memcpy(packet, msg.Data, len);
+
+        if ((msg.Header.Type & 0xFFFF) == 1)
+            self.LastHostID = sender;
+    }
+
+    *timestamp = msg.Header.Timestamp - self.Offset;
+    pending.pop_front();
+    return len;
+}
+
+int LockstepMP::SendPacket(int inst, u8* packet, int len, u64 timestamp)
+{
+    return SendPacketGeneric(inst, 0, packet, len, timestamp);
+}
+
+int LockstepMP::RecvPacket(int inst, u8* packet, u64* timestamp)
+{
+    return RecvPacketGeneric(inst, packet, timestamp);
+}
+
+int LockstepMP::SendCmd(int inst, u8* packet, int len, u64 timestamp)
+{
+    return SendPacketGeneric(inst, 1, packet, len, timestamp);
+}
+
+int LockstepMP::SendReply(int inst, u8* packet, int len, u64 timestamp, u16 aid)
+{
+    return SendPacketGeneric(inst, 2 | (aid<<16), packet, len, timestamp);
+}
+
+int LockstepMP::SendAck(int inst, u8* packet, int len, u64 timestamp)
+{
+    return SendPacketGeneric(inst, 3, packet, len, timestamp);
+}
+
+int LockstepMP::RecvHostPacket(int inst, u8* packet, u64* timestamp)
+{
+    int host = Instances[inst].LastHostID;
+    if (host != -1)
+    {
+        // check if the host is still connected
+        if (!(ConnectedBitmask.load(std::memory_order_acquire) & (1 << host)))
+            return -1;
+    }
+
+    // no need to block here: if the host packet isn't in yet, it isn't due yet,
+    // and the wifi module keeps asking as its time moves on
+    return RecvPacketGeneric(inst, packet, timestamp);
+}
+
+u16 LockstepMP::RecvReplies(int inst, u8* packets, u64 timestamp, u16 aidmask)
+{
+    Instance& self = Instances[inst];
+
+    u16 others = ConnectedBitmask.load(std::memory_order_acquire) & ~(1 << inst);
+    if (!others)
+        return 0;
+
+    u64 now = ToGlobalTime(inst, timestamp);
+    u64 deadline = now + kReplyWindow;
+    SetClock(inst, now, now + kReplyPromise);
+
+    u16 ret = 0;
+    u16 replied = 0;
+    for (int tries = 0;; tries++)
+    {
+        others = ConnectedBitmask.load(std::memory_order_acquire) & ~(1 << inst);
+        DrainMailboxes(inst);
+
+        bool done = true;
+        for (int i = 0; i < kMaxInstances; i++)
+        {
+            if (!(others & (1 << i))) continue;
+
+            auto& pending = self.PendingReplies[i];
+            while (!pending.empty())
+            {
+                const Message& msg = pending.front();
+                if (msg.Header.Timestamp > deadline)
+                    break; // belongs to a later exchange
+
+                if (now < 32 || msg.Header.Timestamp >= (now - 32))
+                {
+                    if (msg.Header.Length)
+                    {
+                        u32 aid = (msg.Header.Type >> 16);
+                        memcpy(&packets[(aid-1)*1024], msg.Data, msg.Header.Length);
+                        ret |= (1 << aid);
+                    }
+                    replied |= (1 << i);
+                }
+
+                pending.pop_front();
+            }
+
+            // an instance that is past the reply window without replying isn't going to
+            if (!(replied & (1 << i)) && !IsPast(inst, deadline, i))
+                done = false;
+        }
+
+        if (done || ((ret & aidmask) == aidmask))
+            return ret;
+
+        if (tries < 64)
+            std::this_thread::yield();
+        else
+            Platform::Sleep(20);
+    }
+}
+
+void LockstepMP::SetTime(int inst, u64 timestamp)
+{
+    u64 now = ToGlobalTime(inst, timestamp);
+    SetClock(inst, now, now);
+
+    // keep the mailboxes empty, so senders don't have to wait for a receive to get room
+    DrainMailboxes(inst);
+}
+
+}
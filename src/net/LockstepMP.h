@@ -0,0 +1,137 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef LOCKSTEPMP_H
+#define LOCKSTEPMP_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#include "types.h"
+#include "MPInterface.h"
+#include "LocalMP.h"
+
+namespace melonDS
+{
+
+// local MP where instances are kept in sync on emulated time instead of wall-clock time
+//
+// every instance publishes a clock: the wifi timestamp before which it won't send anything.
+// a packet is only received once the receiver's timestamp has gone past it, and a receiver
+// waits until every other instance has gone past its own timestamp, so no packet can still
+// show up in the past. what gets received where is then down to emulated time only, which
+// makes runs reproducible and means a slow instance holds the others back instead of
+// making them time out.
+//
+// packets go through lock-free single-producer mailboxes, one per sender per receiver.
+// receivers empty their mailboxes into their own queues on every wifi tick, and senders
+// wait for room instead of dropping anything. packets that sit unreceived for more than
+// kMaxPacketAge of emulated time (RX off, for instance) are dropped, based on emulated
+// time only so it's the same on every run.
+//
+// the clock moves on every wifi tick, whether or not the instance is receiving.
+// an instance only counts once it has turned wifi on, so for fully reproducible runs
+// all instances should be running before any of them gets far into wifi comm.
+// pausing one instance pauses the others as soon as they need to receive something.
+class LockstepMP : public MPInterface
+{
+public:
+    LockstepMP() noexcept;
+    LockstepMP(const LockstepMP&) = delete;
+    LockstepMP& operator=(const LockstepMP&) = delete;
+    LockstepMP(LockstepMP&& other) = delete;
+    LockstepMP& operator=(LockstepMP&& other) = delete;
+    ~LockstepMP() noexcept;
+
+    void Process() {}
+
+    void Begin(int inst);
+    void End(int inst);
+
+    int SendPacket(int inst, u8* data, int len, u64 timestamp);
+    int RecvPacket(int inst, u8* data, u64* timestamp);
+    int SendCmd(int inst, u8* data, int len, u64 timestamp);
+    int SendReply(int inst, u8* data, int len, u64 timestamp, u16 aid);
+    int SendAck(int inst, u8* data, int len, u64 timestamp);
+    int RecvHostPacket(int inst, u8* data, u64* timestamp);
+    u16 RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask);
+
+    void SetTime(int inst, u64 timestamp);
+
+    bool WaitsOnLocalInstances(int inst);
+
+private:
+    static constexpr int kMaxInstances = 16;
+    static constexpr u32 kPacketSlots = 8;
+    static constexpr u32 kReplySlots = 4;
+
+    struct Message
+    {
+        MPPacketHeader Header;
+        u8 Data[kMaxFrameSize];
+    };
+
+    template <u32 Slots>
+    struct Mailbox
+    {
+        std::atomic<u32> WritePos = 0;
+        std::atomic<u32> ReadPos = 0;
+        Message Messages[Slots];
+    };
+
+    struct Instance
+    {
+        // timestamps are kept in a common time base: local timestamp + Offset
+        // Clock is what the others see, Now is the actual current time (Clock can be ahead of it)
+        std::atomic<u64> Clock = 0;
+        u64 Now = 0;
+        s64 Offset = 0;
+        bool OffsetPending = true;
+        int LastHostID = -1;
+
+        Mailbox<kPacketSlots> Packets[kMaxInstances]; // one per sender
+        Mailbox<kReplySlots> Replies[kMaxInstances];
+
+        // what was taken out of the mailboxes and not received yet, only touched by the instance itself
+        std::deque<Message> PendingPackets[kMaxInstances];
+        std::deque<Message> PendingReplies[kMaxInstances];
+    };
+
+    u64 ToGlobalTime(int inst, u64 timestamp) noexcept;
+    void SetClock(int inst, u64 now, u64 clock) noexcept;
+    void WaitForOthers(int inst, u64 time) noexcept;
+    bool IsPast(int inst, u64 time, int other) const noexcept;
+
+    template <u32 Slots>
+    void MailboxPush(int inst, int receiver, Mailbox<Slots>& mailbox, const MPPacketHeader& header, const u8* data) noexcept;
+    template <u32 Slots>
+    void MailboxDrain(Mailbox<Slots>& mailbox, std::deque<Message>& pending, u64 now) noexcept;
+    void DrainMailboxes(int inst) noexcept;
+
+    int SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 timestamp) noexcept;
+    int RecvPacketGeneric(int inst, u8* packet, u64* timestamp) noexcept;
+
+    std::unique_ptr<Instance[]> Instances;
+    std::atomic<u16> ConnectedBitmask = 0;
+    std::atomic<int> MPHostInst = -1;
+};
+
+}
+
+#endif // LOCKSTEPMP_H
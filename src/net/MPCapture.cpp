@@ -0,0 +1,378 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <cstring>
+#include <pcap/pcap.h>
+
+#include "MPCapture.h"
+#include "Platform.h"
+
+using namespace melonDS;
+using namespace melonDS::Platform;
+
+using Platform::Log;
+using Platform::LogLevel;
+
+namespace melonDS
+{
+
+const u32 kPCapMagic = 0xA1B2C3D4; // microsecond timestamps
+const u32 kReplySize = 1024;
+const u32 kMaxRecordData = 15 * kReplySize;
+
+// pcap record header, with the timestamp as two 32-bit fields on all platforms
+struct PCapRecordHeader
+{
+    u32 Sec;
+    u32 USec;
+    u32 CapLen;
+    u32 Len;
+};
+
+
+MPCapture::MPCapture(const std::string& path) noexcept
+{
+    File = OpenFile(path, FileMode::Write);
+    if (!File)
+    {
+        Log(LogLevel::Error, "MP capture: couldn't create %s\n", path.c_str());
+        return;
+    }
+
+    pcap_file_header header = {};
+    header.magic = kPCapMagic;
+    header.version_major = PCAP_VERSION_MAJOR;
+    header.version_minor = PCAP_VERSION_MINOR;
+    header.snaplen = sizeof(MPCaptureRecord) + kMaxRecordData;
+    header.linktype = DLT_USER0;
+    FileWrite(&header, sizeof(header), 1, File);
+
+    Log(LogLevel::Info, "MP capture: recording to %s\n", path.c_str());
+}
+
+MPCapture::~MPCapture() noexcept
+{
+    if (File)
+        CloseFile(File);
+}
+
+void MPCapture::Write(const MPCaptureRecord& rec, const u8* data, u32 len) noexcept
+{
+    PCapRecordHeader pcaphdr;
+    pcaphdr.Sec = (u32)(rec.Timestamp / 1000000);
+    pcaphdr.USec = (u32)(rec.Timestamp % 1000000);
+    pcaphdr.CapLen = sizeof(MPCaptureRecord) + len;
+    pcaphdr.Len = pcaphdr.CapLen;
+
+    std::lock_guard lock(FileLock);
+
+    FileWrite(&pcaphdr, sizeof(pcaphdr), 1, File);
+    FileWrite(&rec, sizeof(rec), 1, File);
+    if (len) FileWrite(data, len, 1, File);
+}
+
+void MPCapture::Process()
+{
+    Interface->Process();
+
+    std::lock_guard lock(FileLock);
+    FileFlush(File);
+}
+
+void MPCapture::Begin(int inst)
+{
+    Interface->Begin(inst);
+}
+
+void MPCapture::End(int inst)
+{
+    Interface->End(inst);
+}
+
+int MPCapture::SendPacket(int inst, u8* data, int len, u64 timestamp)
+{
+    int ret = Interface->SendPacket(inst, data, len, timestamp);
+
+    Write({(u32)inst, MPCapture_SendPacket, 0, ret, timestamp, timestamp}, data, len);
+    return ret;
+}
+
+int MPCapture::RecvPacket(int inst, u8* data, u64* timestamp)
+{
+    u64 calltime = *timestamp;
+
+    Interface->SetRecvTimeout(RecvTimeout);
+    int ret = Interface->RecvPacket(inst, data, timestamp);
+
+    if (ret > 0)
+        Write({(u32)inst, MPCapture_RecvPacket, 0, ret, calltime, *timestamp}, data, ret);
+    return ret;
+}
+
+int MPCapture::SendCmd(int inst, u8* data, int len, u64 timestamp)
+{
+    int ret = Interface->SendCmd(inst, data, len, timestamp);
+
+    Write({(u32)inst, MPCapture_SendCmd, 0, ret, timestamp, timestamp}, data, len);
+    return ret;
+}
+
+int MPCapture::SendReply(int inst, u8* data, int len, u64 timestamp, u16 aid)
+{
+    int ret = Interface->SendReply(inst, data, len, timestamp, aid);
+
+    Write({(u32)inst, MPCapture_SendReply, aid, ret, timestamp, timestamp}, data, len);
+    return ret;
+}
+
+int MPCapture::SendAck(int inst, u8* data, int len, u64 timestamp)
+{
+    int ret = Interface->SendAck(inst, data, len, timestamp);
+
+    Write({(u32)inst, MPCapture_SendAck, 0, ret, timestamp, timestamp}, data, len);
+    return ret;
+}
+
+int MPCapture::RecvHostPacket(int inst, u8* data, u64* timestamp)
+{
+    u64 calltime = *timestamp;
+
+    Interface->SetRecvTimeout(RecvTimeout);
+    int ret = Interface->RecvHostPacket(inst, data, timestamp);
+
+    Write({(u32)inst, MPCapture_RecvHostPacket, 0, ret, calltime, *timestamp}, data, (ret > 0) ? ret : 0);
+    return ret;
+}
+
+u16 MPCapture::RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask)
+{
+    Interface->SetRecvTimeout(RecvTimeout);
+    u16 ret = Interface->RecvReplies(inst, data, timestamp, aidmask);
+
+    // only keep the buffers of the clients that replied
+    u8 replies[kMaxRecordData];
+    u32 len = 0;
+    for (int aid = 1; aid < 16; aid++)
+    {
+        if (!(ret & (1 << aid))) continue;
+
+        memcpy(&replies[len], &data[(aid-1) * kReplySize], kReplySize);
+        len += kReplySize;
+    }
+
+    Write({(u32)inst, MPCapture_RecvReplies, aidmask, ret, timestamp, timestamp}, replies, len);
+    return ret;
+}
+
+void MPCapture::SetTime(int inst, u64 timestamp)
+{
+    Interface->SetTime(inst, timestamp);
+}
+
+bool MPCapture::WaitsOnLocalInstances(int inst)
+{
+    return Interface->WaitsOnLocalInstances(inst);
+}
+
+
+MPReplay::MPReplay(const std::string& path, int inst) noexcept
+{
+    Loaded = Load(path, inst);
+}
+
+MPReplay::~MPReplay() noexcept = default;
+
+bool MPReplay::Load(const std::string& path, int inst) noexcept
+{
+    FileHandle* file = OpenFile(path, FileMode::Read);
+    if (!file)
+    {
+        Log(LogLevel::Error, "MP replay: couldn't open %s\n", path.c_str());
+        return false;
+    }
+
+    pcap_file_header header;
+    if ((FileRead(&header, sizeof(header), 1, file) != 1) ||
+        (header.magic != kPCapMagic) ||
+        (header.linktype != DLT_USER0))
+    {
+        Log(LogLevel::Error, "MP replay: %s isn't a MP capture\n", path.c_str());
+        CloseFile(file);
+        return false;
+    }
+
+    u32 num = 0;
+    for (;;)
+    {
+        PCapRecordHeader pcaphdr;
+        if (FileRead(&pcaphdr, sizeof(pcaphdr), 1, file) != 1)
+            break;
+
+        Record rec;
+        u32 len = pcaphdr.CapLen - sizeof(MPCaptureRecord);
+        if ((pcaphdr.CapLen < sizeof(MPCaptureRecord)) || (len > kMaxRecordData) ||
+            (FileRead(&rec.Header, sizeof(MPCaptureRecord), 1, file) != 1))
+        {
+            Log(LogLevel::Warn, "MP replay: %s is truncated\n", path.c_str());
+            break;
+        }
+
+        rec.Data.resize(len);
+        if (len && (FileRead(rec.Data.data(), len, 1, file) != 1))
+        {
+            Log(LogLevel::Warn, "MP replay: %s is truncated\n", path.c_str());
+            break;
+        }
+
+        if (rec.Header.Inst != (u32)inst)
+            continue;
+
+        switch (rec.Header.Call)
+        {
+        case MPCapture_SendPacket:
+        case MPCapture_SendCmd:
+        case MPCapture_SendReply:
+        case MPCapture_SendAck:
+            Sent.Records.push_back(std::move(rec));
+            break;
+
+        case MPCapture_RecvPacket: Packets.Records.push_back(std::move(rec)); break;
+        case MPCapture_RecvHostPacket: HostPackets.Records.push_back(std::move(rec)); break;
+        case MPCapture_RecvReplies: Replies.Records.push_back(std::move(rec)); break;
+        }
+        num++;
+    }
+
+    CloseFile(file);
+
+    if (!num)
+    {
+        Log(LogLevel::Error, "MP replay: nothing from instance %d in %s\n", inst, path.c_str());
+        return false;
+    }
+
+    Log(LogLevel::Info, "MP replay: %u calls of instance %d loaded from %s\n", num, inst, path.c_str());
+    return true;
+}
+
+int MPReplay::CheckSend(u32 call, u8* data, int len, u64 timestamp, u16 aid) noexcept
+{
+    if (Diverged)
+        return len;
+
+    const char* what = nullptr;
+    if (Sent.Pos >= Sent.Records.size())
+        what = "end of capture";
+    else
+    {
+        const Record& rec = Sent.Records[Sent.Pos];
+        if (rec.Header.Call != call)
+            what = "different call";
+        else if (rec.Header.Timestamp != timestamp)
+            what = "different timestamp";
+        else if ((rec.Data.size() != (u32)len) || memcmp(rec.Data.data(), data, len))
+            what = "different data";
+        else if ((call == MPCapture_SendReply) && (rec.Header.Param != aid))
+            what = "different AID";
+    }
+
+    if (what)
+    {
+        Log(LogLevel::Warn, "MP replay: diverged from the capture at send %u, timestamp %llu (%s)\n",
+            Sent.Pos, (unsigned long long)timestamp, what);
+        Diverged = true;
+        return len;
+    }
+
+    Sent.Pos++;
+    return len;
+}
+
+int MPReplay::SendPacket(int inst, u8* data, int len, u64 timestamp)
+{
+    return CheckSend(MPCapture_SendPacket, data, len, timestamp, 0);
+}
+
+int MPReplay::RecvPacket(int inst, u8* data, u64* timestamp)
+{
+    if (Packets.Pos >= Packets.Records.size())
+        return 0;
+
+    // received packets only show up once the instance gets to where they were received
+    const Record& rec = Packets.Records[Packets.Pos];
+    if (rec.Header.CallTimestamp > *timestamp)
+        return 0;
+
+    memcpy(data, rec.Data.data(), rec.Data.size());
+    *timestamp = rec.Header.Timestamp;
+    Packets.Pos++;
+    return rec.Header.Result;
+}
+
+int MPReplay::SendCmd(int inst, u8* data, int len, u64 timestamp)
+{
+    return CheckSend(MPCapture_SendCmd, data, len, timestamp, 0);
+}
+
+int MPReplay::SendReply(int inst, u8* data, int len, u64 timestamp, u16 aid)
+{
+    return CheckSend(MPCapture_SendReply, data, len, timestamp, aid);
+}
+
+int MPReplay::SendAck(int inst, u8* data, int len, u64 timestamp)
+{
+    return CheckSend(MPCapture_SendAck, data, len, timestamp, 0);
+}
+
+int MPReplay::RecvHostPacket(int inst, u8* data, u64* timestamp)
+{
+    // past the end of the capture, the host is gone
+    if (HostPackets.Pos >= HostPackets.Records.size())
+        return -1;
+
+    const Record& rec = HostPackets.Records[HostPackets.Pos++];
+    if (rec.Header.Result > 0)
+    {
+        memcpy(data, rec.Data.data(), rec.Data.size());
+        *timestamp = rec.Header.Timestamp;
+    }
+    return rec.Header.Result;
+}
+
+u16 MPReplay::RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask)
+{
+    if (Replies.Pos >= Replies.Records.size())
+        return 0;
+
+    const Record& rec = Replies.Records[Replies.Pos++];
+    u16 ret = (u16)rec.Header.Result;
+
+    u32 pos = 0;
+    for (int aid = 1; aid < 16; aid++)
+    {
+        if (!(ret & (1 << aid))) continue;
+        if ((pos + kReplySize) > rec.Data.size()) break;
+
+        memcpy(&data[(aid-1) * kReplySize], &rec.Data[pos], kReplySize);
+        pos += kReplySize;
+    }
+
+    return ret;
+}
+
+}
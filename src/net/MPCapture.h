@@ -0,0 +1,172 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef MPCAPTURE_H
+#define MPCAPTURE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "MPInterface.h"
+
+namespace melonDS
+{
+namespace Platform
+{
+struct FileHandle;
+}
+
+// MP traffic captures
+//
+// captures are pcap files (link type USER0), with one record per MP call: a MPCaptureRecord
+// followed by the packet data. the pcap timestamp is the wifi timestamp of the packet, in
+// microseconds. for RecvReplies(), the data is the 1024-byte reply buffer of every client
+// that replied, in AID order.
+enum MPCaptureCall
+{
+    MPCapture_SendPacket,
+    MPCapture_RecvPacket,
+    MPCapture_SendCmd,
+    MPCapture_SendReply,
+    MPCapture_SendAck,
+    MPCapture_RecvHostPacket,
+    MPCapture_RecvReplies,
+};
+
+struct MPCaptureRecord
+{
+    u32 Inst;
+    u32 Call;
+    u32 Param;          // AID for SendReply(), AID mask for RecvReplies()
+    s32 Result;         // return value of the call
+    u64 CallTimestamp;  // timestamp of the instance when the call was made
+    u64 Timestamp;      // timestamp of the packet
+};
+
+// records the MP traffic of all the local instances, while passing it on to another interface
+//
+// received packets are only recorded when there was one, except for RecvHostPacket() and
+// RecvReplies(), which are recorded every time as they're only called at set points of the
+// MP exchange.
+class MPCapture : public MPInterface
+{
+public:
+    MPCapture(const std::string& path) noexcept;
+    MPCapture(const MPCapture&) = delete;
+    MPCapture& operator=(const MPCapture&) = delete;
+    MPCapture(MPCapture&& other) = delete;
+    MPCapture& operator=(MPCapture&& other) = delete;
+    ~MPCapture() noexcept;
+
+    // false if the capture file couldn't be created
+    bool IsOpen() const noexcept { return File != nullptr; }
+
+    void SetInterface(std::unique_ptr<MPInterface> iface) noexcept { Interface = std::move(iface); }
+    std::unique_ptr<MPInterface> TakeInterface() noexcept { return std::move(Interface); }
+
+    void Process();
+
+    void Begin(int inst);
+    void End(int inst);
+
+    int SendPacket(int inst, u8* data, int len, u64 timestamp);
+    int RecvPacket(int inst, u8* data, u64* timestamp);
+    int SendCmd(int inst, u8* data, int len, u64 timestamp);
+    int SendReply(int inst, u8* data, int len, u64 timestamp, u16 aid);
+    int SendAck(int inst, u8* data, int len, u64 timestamp);
+    int RecvHostPacket(int inst, u8* data, u64* timestamp);
+    u16 RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask);
+
+    void SetTime(int inst, u64 timestamp);
+
+    bool WaitsOnLocalInstances(int inst);
+
+private:
+    void Write(const MPCaptureRecord& rec, const u8* data, u32 len) noexcept;
+
+    std::unique_ptr<MPInterface> Interface;
+
+    std::mutex FileLock;
+    Platform::FileHandle* File = nullptr;
+};
+
+// plays back the traffic one instance saw in a capture, without any other instance
+//
+// whatever the local instance sends is checked against the capture, and the first point
+// where it differs is logged: from there on, the replay isn't meaningful anymore.
+// received packets come back at the same timestamps as in the capture, so a replay
+// is deterministic as long as the instance starts from the same state.
+class MPReplay : public MPInterface
+{
+public:
+    // inst: instance of the capture to play back
+    MPReplay(const std::string& path, int inst) noexcept;
+    MPReplay(const MPReplay&) = delete;
+    MPReplay& operator=(const MPReplay&) = delete;
+    MPReplay(MPReplay&& other) = delete;
+    MPReplay& operator=(MPReplay&& other) = delete;
+    ~MPReplay() noexcept;
+
+    // false if the capture couldn't be loaded
+    bool IsOpen() const noexcept { return Loaded; }
+
+    void Process() {}
+
+    void Begin(int inst) {}
+    void End(int inst) {}
+
+    int SendPacket(int inst, u8* data, int len, u64 timestamp);
+    int RecvPacket(int inst, u8* data, u64* timestamp);
+    int SendCmd(int inst, u8* data, int len, u64 timestamp);
+    int SendReply(int inst, u8* data, int len, u64 timestamp, u16 aid);
+    int SendAck(int inst, u8* data, int len, u64 timestamp);
+    int RecvHostPacket(int inst, u8* data, u64* timestamp);
+    u16 RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask);
+
+private:
+    struct Record
+    {
+        MPCaptureRecord Header;
+        std::vector<u8> Data;
+    };
+
+    // calls of one kind, played back in order
+    struct Track
+    {
+        std::vector<Record> Records;
+        u32 Pos = 0;
+    };
+
+    bool Load(const std::string& path, int inst) noexcept;
+    int CheckSend(u32 call, u8* data, int len, u64 timestamp, u16 aid) noexcept;
+
+    bool Loaded = false;
+    bool Diverged = false;
+
+    Track Sent;
+    Track Packets;
+    Track HostPackets;
+    Track Replies;
+};
+
+}
+
+#endif // MPCAPTURE_H
@@ -19,6 +19,9 @@
 #include "MPInterface.h"
 #include "LocalMP.h"
 #include "LAN.h"
+#include "LockstepMP.h"
+#include "SharedMP.h"
+#include "MPCapture.h"
 
 namespace melonDS
 {
@@ -57,6 +60,24 @@ void MPInterface::Set(MPInterfaceType type)
         Current = std::make_unique<LAN>();
         break;
 
+    case MPInterface_Lockstep:
+        Current = std::make_unique<LockstepMP>();
+        break;
+
+    case MPInterface_SharedMem:
+        {
+            auto shared = std::make_unique<SharedMP>();
+            if (!shared->IsOpen())
+            {
+                Current = std::make_unique<DummyMP>();
+                type = MPInterface_Dummy;
+                break;
+            }
+
+            Current = std::move(shared);
+        }
+        break;
+
     default:
         Current = std::make_unique<DummyMP>();
         break;
@@ -65,4 +86,27 @@ void MPInterface::Set(MPInterfaceType type)
     CurrentType = type;
 }
 
+bool MPInterface::SetReplay(const std::string& path, int inst)
+{
+    auto replay = std::make_unique<MPReplay>(path, inst);
+    if (!replay->IsOpen())
+        return false;
+
+    Current = std::move(replay);
+    CurrentType = MPInterface_Replay;
+    return true;
+}
+
+bool MPInterface::StartCapture(const std::string& path)
+{
+    auto capture = std::make_unique<MPCapture>(path);
+    if (!capture->IsOpen())
+        return false;
+
+    capture->SetRecvTimeout(Current->GetRecvTimeout());
+    capture->SetInterface(std::move(Current));
+    Current = std::move(capture);
+    return true;
+}
+
 }
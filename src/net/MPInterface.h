@@ -20,6 +20,7 @@
 #define MPINTERFACE_H
 
 #include <memory>
+#include <string>
 #include "types.h"
 
 namespace melonDS
@@ -32,6 +33,9 @@ enum MPInterfaceType
     MPInterface_Local,
     MPInterface_LAN,
     MPInterface_Netplay,
+    MPInterface_Lockstep,
+    MPInterface_SharedMem,
+    MPInterface_Replay,
 };
 
 struct MPPacketHeader
@@ -52,6 +56,13 @@ public:
     static MPInterfaceType GetType() { return CurrentType; }
     static void Set(MPInterfaceType type);
 
+    // plays back what the given instance of a MP capture received, to one local instance
+    static bool SetReplay(const std::string& path, int inst);
+
+    // records all the MP traffic going through the current interface to a capture file,
+    // until the interface is changed
+    static bool StartCapture(const std::string& path);
+
     [[nodiscard]] int GetRecvTimeout() const noexcept { return RecvTimeout; }
     void SetRecvTimeout(int timeout) noexcept { RecvTimeout = timeout; }
 
@@ -61,6 +72,8 @@ public:
     virtual void Begin(int inst) = 0;
     virtual void End(int inst) = 0;
 
+    // on entry to the receive functions, *timestamp holds the receiver's current timestamp
+    // on return, it holds the timestamp of the received packet
     virtual int SendPacket(int inst, u8* data, int len, u64 timestamp) = 0;
     virtual int RecvPacket(int inst, u8* data, u64* timestamp) = 0;
     virtual int SendCmd(int inst, u8* data, int len, u64 timestamp) = 0;
@@ -69,6 +82,14 @@ public:
     virtual int RecvHostPacket(int inst, u8* data, u64* timestamp) = 0;
     virtual u16 RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask) = 0;
 
+    // called on every wifi timer tick of the instance, for interfaces that keep
+    // instances in sync on emulated time
+    virtual void SetTime(int inst, u64 timestamp) {}
+
+    // whether the instance is currently doing MP with other instances of this process,
+    // and so may have to wait on them (they then need to be running at the same time)
+    virtual bool WaitsOnLocalInstances(int inst) { return false; }
+
 protected:
     int RecvTimeout = 25;
 
@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "Net.h"
 #include "Net_Slirp.h"
 #include "FIFO.h"
@@ -32,6 +33,8 @@
 	#include <netdb.h>
 	#include <poll.h>
 	#include <time.h>
+	#include <fcntl.h>
+	#include <unistd.h>
 #endif
 
 namespace melonDS
@@ -47,6 +50,13 @@ const u32 kClientIP = kSubnet | 0x10;
 
 const u8 kServerMAC[6] = {0x00, 0xAB, 0x33, 0x28, 0x99, 0x44};
 
+#ifdef __WIN32__
+// there's no pipe to wake up WSAPoll with, so it doesn't wait for long
+const u32 kPollTimeout = 1;
+#else
+const u32 kPollTimeout = 100;
+#endif
+
 #ifdef __WIN32__
 
 #define poll WSAPoll
@@ -158,10 +168,46 @@ Net_Slirp::Net_Slirp(const Platform::SendPacketCallback& callback) noexcept : Ca
     *(u32*)&cfg.vnameserver = htonl(kDNSIP);
 
     Ctx = slirp_new(&cfg, &cb, this);
+    if (!Ctx) return;
+
+#ifndef __WIN32__
+    if (pipe(WakePipe) == 0)
+    {
+        fcntl(WakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(WakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+    else
+    {
+        Log(LogLevel::Error, "slirp: couldn't create the wakeup pipe\n");
+        WakePipe[0] = WakePipe[1] = -1;
+    }
+#endif
+
+    TXQueue = std::make_unique<TXRing>();
+
+    IOThreadRunning = true;
+    IOThread = Platform::Thread_Create([this]() {
+        IOThreadFunc();
+    });
 }
 
 Net_Slirp::~Net_Slirp() noexcept
 {
+    if (IOThread)
+    {
+        IOThreadRunning.store(false, std::memory_order_release);
+        WakeIOThread();
+
+        Platform::Thread_Wait(IOThread);
+        Platform::Thread_Free(IOThread);
+        IOThread = nullptr;
+    }
+
+#ifndef __WIN32__
+    if (WakePipe[0] >= 0) close(WakePipe[0]);
+    if (WakePipe[1] >= 0) close(WakePipe[1]);
+#endif
+
     if (Ctx)
     {
         slirp_cleanup(Ctx);
@@ -369,12 +415,33 @@ int Net_Slirp::SendPacket(u8* data, int len) noexcept
 {
     if (!Ctx) return 0;
 
-    if (len > 2048)
+    if (len > (int)kMaxFrameSize)
     {
         Log(LogLevel::Error, "Net_SendPacket: error: packet too long (%d)\n", len);
         return 0;
     }
 
+    TXRing::Slot* slot = TXQueue->BeginWrite();
+    if (!slot)
+    {
+        // the I/O thread is behind: drop this frame, and keep those already queued
+        if (TXDropped.fetch_add(1, std::memory_order_relaxed) == 0)
+            Log(LogLevel::Warn, "slirp: TX queue full, dropping frames\n");
+
+        WakeIOThread();
+        return 0;
+    }
+
+    slot->Header = len;
+    memcpy(slot->Data, data, len);
+    TXQueue->EndWrite(slot);
+
+    WakeIOThread();
+    return len;
+}
+
+void Net_Slirp::HandleFrame(u8* data, int len) noexcept
+{
     u16 ethertype = ntohs(*(u16*)&data[0xC]);
 
     if (ethertype == 0x800)
@@ -386,13 +453,12 @@ int Net_Slirp::SendPacket(u8* data, int len) noexcept
             if (dstport == 53 && htonl(*(u32*)&data[0x1E]) == kDNSIP) // DNS
             {
                 HandleDNSFrame(data, len);
-                return len;
+                return;
             }
         }
     }
 
     slirp_input(Ctx, data, len);
-    return len;
 }
 
 int Net_Slirp::SlirpCbAddPoll(int fd, int events, void* opaque) noexcept
@@ -444,18 +510,81 @@ int Net_Slirp::SlirpCbGetREvents(int idx, void* opaque) noexcept
     return ret;
 }
 
-void Net_Slirp::RecvCheck() noexcept
+void Net_Slirp::WakeIOThread() noexcept
 {
-    if (!Ctx) return;
+    // only one wakeup needs to be pending at a time
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (WakePending.exchange(true))
+        return;
+
+#ifndef __WIN32__
+    u8 val = 0;
+    if (WakePipe[1] >= 0 && write(WakePipe[1], &val, 1) < 0) {}
+#endif
+}
+
+void Net_Slirp::IOThreadFunc() noexcept
+{
+    u8 frame[kMaxFrameSize];
 
-    //if (PollListSize > 0)
+    while (IOThreadRunning.load(std::memory_order_acquire))
     {
-        u32 timeout = 0;
+        // clear the wakeup before looking at the queue, so a frame queued meanwhile wakes us up again
+        WakePending.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool handled = false;
+        while (const TXRing::Slot* slot = TXQueue->Peek())
+        {
+            u32 len = std::min(slot->Header, kMaxFrameSize);
+            memcpy(frame, slot->Data, len);
+            TXQueue->Pop();
+
+            HandleFrame(frame, len);
+            handled = true;
+        }
+
+        if (u32 dropped = TXDropped.exchange(0, std::memory_order_relaxed))
+            Log(LogLevel::Warn, "slirp: %u frames dropped\n", dropped);
+
+        // slirp only sends out what it queued (for example, while waiting for an ARP reply)
+        // after polling, so don't wait if there was any input
+        u32 timeout = handled ? 0 : kPollTimeout;
         PollListSize = 0;
         slirp_pollfds_fill(Ctx, &timeout, SlirpCbAddPoll, this);
-        int res = poll(PollList, PollListSize, timeout);
+
+        int numfds = PollListSize;
+#ifndef __WIN32__
+        if (WakePipe[0] >= 0)
+        {
+            PollList[numfds].fd = WakePipe[0];
+            PollList[numfds].events = POLLIN;
+            PollList[numfds].revents = 0;
+            numfds++;
+        }
+#endif
+
+        int res = 0;
+        if (numfds > 0)
+            res = poll(PollList, numfds, timeout);
+        else
+            Platform::Sleep(timeout * 1000);
+
+#ifndef __WIN32__
+        if (numfds > PollListSize && (PollList[PollListSize].revents & POLLIN))
+        {
+            u8 buf[64];
+            while (read(WakePipe[0], buf, sizeof(buf)) > 0);
+        }
+#endif
+
         slirp_pollfds_poll(Ctx, res<0, SlirpCbGetREvents, this);
     }
 }
 
+void Net_Slirp::RecvCheck() noexcept
+{
+    // nothing to do here: received frames are queued by the I/O thread as they come
+}
+
 }
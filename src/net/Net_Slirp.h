@@ -19,10 +19,14 @@
 #ifndef NET_SLIRP_H
 #define NET_SLIRP_H
 
+#include <atomic>
+#include <memory>
+
 #include "types.h"
 #include "FIFO.h"
 #include "Platform.h"
 #include "NetDriver.h"
+#include "FrameQueue.h"
 
 #include <libslirp.h>
 
@@ -36,32 +40,52 @@ struct Slirp;
 
 namespace melonDS
 {
+// the slirp instance is run by its own I/O thread, so that DNS lookups and socket calls
+// never hold up emulation: frames sent by the consoles are queued to it without a lock,
+// and received frames are passed to the callback from that thread
+// if that thread falls so far behind that the queue fills up, new frames are dropped,
+// as a congested network would
 class Net_Slirp : public NetDriver
 {
 public:
     explicit Net_Slirp(const Platform::SendPacketCallback& callback) noexcept;
     Net_Slirp(const Net_Slirp&) = delete;
     Net_Slirp& operator=(const Net_Slirp&) = delete;
-    Net_Slirp(Net_Slirp&& other) noexcept;
-    Net_Slirp& operator=(Net_Slirp&& other) noexcept;
+    // Not movable because the I/O thread points to this object
+    Net_Slirp(Net_Slirp&& other) = delete;
+    Net_Slirp& operator=(Net_Slirp&& other) = delete;
     ~Net_Slirp() noexcept override;
 
     int SendPacket(u8* data, int len) noexcept override;
     void RecvCheck() noexcept override;
 private:
     static constexpr int PollListMax = 64;
+    static constexpr u32 kMaxFrameSize = 2048;
+    static constexpr u32 kTXSlots = 64;
+    using TXRing = FrameQueue<u32, kMaxFrameSize, kTXSlots>;
+
     static const SlirpCb cb;
     static int SlirpCbGetREvents(int idx, void* opaque) noexcept;
     static int SlirpCbAddPoll(int fd, int events, void* opaque) noexcept;
     static ssize_t SlirpCbSendPacket(const void* buf, size_t len, void* opaque) noexcept;
     void HandleDNSFrame(u8* data, int len) noexcept;
+    void HandleFrame(u8* data, int len) noexcept;
+    void IOThreadFunc() noexcept;
+    void WakeIOThread() noexcept;
 
     Platform::SendPacketCallback Callback;
-    pollfd PollList[PollListMax] {};
+    pollfd PollList[PollListMax + 1] {}; // plus the wakeup pipe
     int PollListSize = 0;
     FIFO<u32, (0x8000 >> 2)> RXBuffer {};
     u32 IPv4ID = 0;
     Slirp* Ctx = nullptr;
+
+    std::unique_ptr<TXRing> TXQueue;
+    std::atomic<u32> TXDropped = 0;
+    Platform::Thread* IOThread = nullptr;
+    std::atomic<bool> IOThreadRunning = false;
+    std::atomic<bool> WakePending = false;
+    int WakePipe[2] = {-1, -1};
 };
 }
 #endif // NET_SLIRP_H
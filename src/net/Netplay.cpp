@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <queue>
+#include <memory>
+#include <algorithm>
 
 #include <enet/enet.h>
 
@@ -27,6 +29,9 @@
 #include "NDSCart.h"
 //#include "IPC.h"
 #include "Netplay.h"
+#include "InputDelay.h"
+#include "Rollback.h"
+#include "StateHash.h"
 //#include "Input.h"
 //#include "ROMManager.h"
 //#include "Config.h"
@@ -54,16 +59,23 @@ bool Lag;
 
 int NumMirrorClients;
 
-struct InputFrame
-{
-    u32 FrameNum;
-    u32 KeyMask;
-    u32 Touching;
-    u32 TouchX, TouchY;
-};
-
 std::queue<InputFrame> InputQueue;
 
+// set when mirror clients run in rollback mode instead of waiting on InputQueue
+std::unique_ptr<RollbackSession> Rollback;
+u64 RollbackWaitStart;
+
+std::unique_ptr<StateHasher> Hasher;
+StateHash LastHash;
+
+const double kFrameTime = 1000.0 / 59.8261; // ms
+
+InputDelayController InputDelay(4);
+bool AdaptiveInputDelay;
+u32 LastInputFrame;
+
+Stats CurStats;
+
 enum
 {
     Blob_CartROM = 0,
@@ -95,6 +107,11 @@ bool Init()
 
     NumMirrorClients = 0;
 
+    InputDelay.SetDelay(4);
+    AdaptiveInputDelay = true;
+    LastInputFrame = 0;
+    CurStats = {};
+
     for (int i = 0; i < Blob_MAX; i++)
     {
         Blobs[i] = nullptr;
@@ -116,6 +133,8 @@ bool Init()
 void DeInit()
 {
     // TODO: cleanup resources properly!!
+    Rollback = nullptr;
+    Hasher = nullptr;
 
     //enet_deinitialize();
 }
@@ -151,7 +170,7 @@ void StartHost(const char* playername, int port)
     mirroraddr.host = ENET_HOST_ANY;
     mirroraddr.port = port + 1;
 printf("host mirror host connecting to %08X:%d\n", mirroraddr.host, mirroraddr.port);
-    MirrorHost = enet_host_create(&mirroraddr, 16, 2, 0, 0);
+    MirrorHost = enet_host_create(&mirroraddr, 16, 3, 0, 0);
     if (!MirrorHost)
     {
         printf("mirror host shat itself :(\n");
@@ -227,7 +246,7 @@ void StartMirror(const Player* player)
     CurBlobType = -1;
     CurBlobLen = 0;
 
-    MirrorHost = enet_host_create(nullptr, 1, 2, 0, 0);
+    MirrorHost = enet_host_create(nullptr, 1, 3, 0, 0);
     if (!MirrorHost)
     {
         printf("mirror shat itself :(\n");
@@ -240,7 +259,7 @@ void StartMirror(const Player* player)
     addr.host = player->Address;
     addr.port = 8064+1 + player->ID; // FIXME!!!!!!!!!!
     printf("mirror client connecting to %08X:%d\n", addr.host, addr.port);
-    ENetPeer* peer = enet_host_connect(MirrorHost, &addr, 2, 0);
+    ENetPeer* peer = enet_host_connect(MirrorHost, &addr, 3, 0);
     if (!peer)
     {
         printf("connect shat itself :(\n");
@@ -275,6 +294,135 @@ void StartMirror(const Player* player)
 }
 
 
+void StartRollback(NDS& nds, int maxframes)
+{
+    Rollback = std::make_unique<RollbackSession>(nds, maxframes);
+    RollbackWaitStart = 0;
+}
+
+void StopRollback()
+{
+    Rollback = nullptr;
+}
+
+static void AddWaitTime(u64 time)
+{
+    CurStats.LastWaitTime = (u32)time;
+    CurStats.TotalWaitTime += time;
+    if (time) CurStats.WaitFrames++;
+}
+
+bool RunRollbackFrame()
+{
+    if (!Rollback) return false;
+
+    // a frame that can't run yet gets retried, the wait lasts until it finally runs
+    bool ret = Rollback->RunFrame();
+    u64 now = Platform::GetUSCount();
+    if (!ret)
+    {
+        if (!RollbackWaitStart) RollbackWaitStart = now;
+    }
+    else
+    {
+        AddWaitTime(RollbackWaitStart ? (now - RollbackWaitStart) : 0);
+        RollbackWaitStart = 0;
+    }
+
+    CurStats.Rollbacks = Rollback->GetNumRollbacks();
+    CurStats.ResimulatedFrames = Rollback->GetNumResimulatedFrames();
+    return ret;
+}
+
+void StartStateHashing(NDS& nds)
+{
+    Hasher = std::make_unique<StateHasher>(nds);
+    LastHash = {};
+}
+
+void StopStateHashing()
+{
+    Hasher = nullptr;
+}
+
+bool GetDesync(StateDesync& desync)
+{
+    if (!Hasher) return false;
+    return Hasher->GetDesync(desync);
+}
+
+static void UpdateStateHash()
+{
+    if (!Hasher) return;
+
+    // with rollback, only a state that didn't come from predicted input can be compared
+    if (Rollback && !Rollback->IsStateFinal()) return;
+
+    LastHash = Hasher->Update();
+}
+
+// RTT and jitter come from ENet's own estimates, which it keeps up from the acks of reliable packets
+static bool SampleConnection(ENetHost* host, u32& rtt, u32& jitter)
+{
+    if (!host) return false;
+
+    bool connected = false;
+    for (size_t i = 0; i < host->peerCount; i++)
+    {
+        ENetPeer* peer = &host->peers[i];
+        if (peer->state != ENET_PEER_STATE_CONNECTED) continue;
+
+        rtt = std::max(rtt, (u32)peer->roundTripTime);
+        jitter = std::max(jitter, (u32)peer->roundTripTimeVariance);
+        connected = true;
+    }
+
+    return connected;
+}
+
+static u32 TakeTraffic(ENetHost* host)
+{
+    if (!host) return 0;
+
+    u32 sent = host->totalSentData;
+    CurStats.BytesReceived += host->totalReceivedData;
+    host->totalSentData = 0;
+    host->totalReceivedData = 0;
+    return sent;
+}
+
+static void UpdateStats()
+{
+    u32 rtt = 0, jitter = 0;
+    bool connected = SampleConnection(Host, rtt, jitter);
+    connected |= SampleConnection(MirrorHost, rtt, jitter);
+
+    u32 sent = TakeTraffic(Host) + TakeTraffic(MirrorHost);
+    CurStats.LastFrameBytesSent = sent;
+    CurStats.BytesSent += sent;
+
+    if (!connected) return;
+    CurStats.RTT = rtt;
+    CurStats.Jitter = jitter;
+
+    // mirror clients go by the frame numbers the host puts on the input
+    if (AdaptiveInputDelay && !IsMirror)
+        InputDelay.Update(rtt, jitter, kFrameTime);
+}
+
+void GetStats(Stats& stats)
+{
+    stats = CurStats;
+    stats.InputDelay = InputDelay.GetDelay();
+}
+
+void SetInputDelay(int delay, bool adaptive)
+{
+    InputDelay.SetDelay((u32)std::max(delay, 0));
+    AdaptiveInputDelay = adaptive;
+}
+
+
 u32 PlayerAddress(int id)
 {
     if (id < 0 || id > 16) return 0;
@@ -770,7 +918,7 @@ void ProcessClient()
                         mirroraddr.host = ENET_HOST_ANY;
                         mirroraddr.port = 8064+1 + data[1]; // FIXME!!!!
 printf("client mirror host connecting to %08X:%d\n", mirroraddr.host, mirroraddr.port);
-                        MirrorHost = enet_host_create(&mirroraddr, 16, 2, 0, 0);
+                        MirrorHost = enet_host_create(&mirroraddr, 16, 3, 0, 0);
                         if (!MirrorHost)
                         {
                             printf("mirror host shat itself :(\n");
@@ -927,12 +1075,14 @@ void ProcessMirrorClient()
     if (!MirrorHost) return;
 #if 0
     bool block = false;
-    if (emuThread->emuIsRunning())// && NDS::NumFrames > 4)
+    if (emuThread->emuIsRunning() && !Rollback)// && NDS::NumFrames > 4)
     {
         if (InputQueue.empty())
             block = true;
     }
 
+    u64 waitstart = block ? Platform::GetUSCount() : 0;
+
     ENetEvent event;
     while (enet_host_service(MirrorHost, &event, block ? 5000 : 0) > 0)
     {
@@ -958,7 +1108,10 @@ void ProcessMirrorClient()
                 u8* data = (u8*)event.packet->data;
                 InputFrame frame;
                 memcpy(&frame, data, sizeof(InputFrame));
-                InputQueue.push(frame);
+                if (Rollback)
+                    Rollback->AddInput(frame);
+                else
+                    InputQueue.push(frame);
 
                 /*bool lag = (InputQueue.size() > 4*2);
                 if (lag != Lag)
@@ -981,16 +1134,30 @@ printf("mirror client lag notify: %d\n", lag);
             {
                 RecvBlobFromMirrorHost(event.peer, event.packet);
             }
+            else if (event.channelID == 2)
+            {
+                if (event.packet->dataLength != sizeof(StateHash)) break;
+
+                StateHash hash;
+                memcpy(&hash, event.packet->data, sizeof(StateHash));
+                if (Hasher)
+                    Hasher->AddRemoteHash(hash);
+            }
             break;
         }
 
         if (block) break;
     }
+
+    if (!Rollback)
+        AddWaitTime(block ? (Platform::GetUSCount() - waitstart) : 0);
 #endif
 }
 
 void ProcessFrame()
 {
+    UpdateStateHash();
+
     if (IsMirror)
     {
         ProcessMirrorClient();
@@ -1008,6 +1175,8 @@ void ProcessFrame()
 
         ProcessMirrorHost();
     }
+
+    UpdateStats();
 }
 
 void ProcessInput()
@@ -1029,23 +1198,37 @@ void ProcessInput()
 #if 0
     if (!IsMirror)
     {
-        u32 lag = 4; // TODO: make configurable!!
+        u32 target = NDS::NumFrames + InputDelay.GetDelay();
 
         InputFrame frame;
-        frame.FrameNum = NDS::NumFrames + lag;
         frame.KeyMask = Input::InputMask;
         frame.Touching = Input::Touching ? 1:0;
         frame.TouchX = Input::TouchX;
         frame.TouchY = Input::TouchY;
         // TODO: other shit! (some hotkeys for example?)
 
-        InputQueue.push(frame);
+        // when the delay goes up, the frames in between get the current input too
+        // when it goes down, input is skipped until the frames catch up with the input already sent
+        u32 first = LastInputFrame ? (LastInputFrame + 1) : target;
+        for (u32 f = first; (s32)(target - f) >= 0; f++)
+        {
+            frame.FrameNum = f;
+            InputQueue.push(frame);
+
+            u8 cmd[sizeof(InputFrame)];
+            memcpy(cmd, &frame, sizeof(InputFrame));
+            ENetPacket* pkt = enet_packet_create(cmd, sizeof(cmd), ENET_PACKET_FLAG_RELIABLE);
+            enet_host_broadcast(MirrorHost, 0, pkt);
+            //enet_host_flush(MirrorHost);
+
+            LastInputFrame = f;
+        }
 
-        u8 cmd[sizeof(InputFrame)];
-        memcpy(cmd, &frame, sizeof(InputFrame));
-        ENetPacket* pkt = enet_packet_create(cmd, sizeof(cmd), ENET_PACKET_FLAG_RELIABLE);
-        enet_host_broadcast(MirrorHost, 0, pkt);
-        //enet_host_flush(MirrorHost);
+        if (Hasher)
+        {
+            pkt = enet_packet_create(&LastHash, sizeof(StateHash), ENET_PACKET_FLAG_RELIABLE);
+            enet_host_broadcast(MirrorHost, 2, pkt);
+        }
     }
 
     if (InputQueue.empty())
@@ -20,6 +20,12 @@
 #define NETPLAY_H
 
 #include "types.h"
+#include "StateHash.h"
+
+namespace melonDS
+{
+class NDS;
+}
 
 namespace Netplay
 {
@@ -42,6 +48,45 @@ void StartHost(const char* player, int port);
 void StartClient(const char* player, const char* host, int port);
 void StartMirror(const Player* player);
 
+// rollback mode for mirror clients: instead of running a frame once its input has arrived,
+// RunRollbackFrame() runs ahead on predicted input, and goes back when the prediction was wrong
+// it returns false when the frame couldn't be run yet
+void StartRollback(melonDS::NDS& nds, int maxframes);
+void StopRollback();
+bool RunRollbackFrame();
+
+// desync detection: the host sends a hash of part of the console state along with every frame
+// of input, and mirror clients check it against their own
+// to be started once the console is set up, the same way on both sides
+// GetDesync() returns false as long as everything matched
+void StartStateHashing(melonDS::NDS& nds);
+void StopStateHashing();
+bool GetDesync(StateDesync& desync);
+
+// connection and frame pacing stats, for display
+// times are in milliseconds unless noted otherwise, byte counts are since netplay was started
+struct Stats
+{
+    melonDS::u32 RTT;               // round-trip time to the worst connected peer
+    melonDS::u32 Jitter;            // variance of that round-trip time
+    melonDS::u32 InputDelay;        // frames between input being taken and the frame it's for
+
+    melonDS::u32 WaitFrames;        // frames that had to wait for remote input
+    melonDS::u32 LastWaitTime;      // in microseconds, time spent waiting for the last frame
+    melonDS::u64 TotalWaitTime;     // in microseconds
+    melonDS::u32 Rollbacks;
+    melonDS::u32 ResimulatedFrames;
+
+    melonDS::u64 BytesSent;
+    melonDS::u64 BytesReceived;
+    melonDS::u32 LastFrameBytesSent;
+};
+
+void GetStats(Stats& stats);
+
+// adaptive: the delay follows the connection, starting from the given value
+void SetInputDelay(int delay, bool adaptive);
+
 melonDS::u32 PlayerAddress(int id);
 
 void StartGame();
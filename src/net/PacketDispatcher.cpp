@@ -16,64 +16,46 @@
     with melonDS. If not, see http://www.gnu.org/licenses/.
 */
 
+#include <cstring>
+
 #include "PacketDispatcher.h"
 
 using namespace melonDS;
 
-struct PacketHeader
-{
-    u32 magic;
-    u32 senderID;
-    u32 headerLength;
-    u32 dataLength;
-};
-
 const u32 kPacketMagic = 0x4B504C4D;
 
 
-PacketDispatcher::PacketDispatcher() : mutex(Platform::Mutex_Create())
+PacketDispatcher::PacketDispatcher() : packetRing(std::make_unique<PacketRing>())
 {
     instanceMask = 0;
 }
 
 PacketDispatcher::~PacketDispatcher()
 {
-    Platform::Mutex_Free(mutex);
 }
 
 
 void PacketDispatcher::registerInstance(int inst)
 {
-    Mutex_Lock(mutex);
-
+    packetRing->Reset(inst);
     instanceMask |= (1 << inst);
-    packetQueues[inst] = std::make_unique<PacketQueue>();
-
-    Mutex_Unlock(mutex);
 }
 
 void PacketDispatcher::unregisterInstance(int inst)
 {
-    Mutex_Lock(mutex);
-
     instanceMask &= ~(1 << inst);
-    packetQueues[inst] = nullptr;
-
-    Mutex_Unlock(mutex);
 }
 
 
 void PacketDispatcher::clear()
 {
-    Mutex_Lock(mutex);
     for (int i = 0; i < 16; i++)
     {
         if (!(instanceMask & (1 << i)))
             continue;
 
-        packetQueues[i]->Clear();
+        packetRing->Reset(i);
     }
-    Mutex_Unlock(mutex);
 }
 
 
@@ -82,42 +64,25 @@ void PacketDispatcher::sendPacket(const void* header, int headerlen, const void*
     if (!header) headerlen = 0;
     if (!data) datalen = 0;
     if ((!headerlen) && (!datalen)) return;
-    if ((sizeof(PacketHeader) + headerlen + datalen) >= 0x8000) return;
+    if ((headerlen + datalen) > (int)sizeof(PacketRing::Slot::Data)) return;
     if (sender < 0 || sender > 16) return;
 
     recv_mask &= instanceMask;
     if (sender < 16) recv_mask &= ~(1 << sender);
     if (!recv_mask) return;
 
-    PacketHeader phdr;
-    phdr.magic = kPacketMagic;
-    phdr.senderID = sender;
-    phdr.headerLength = headerlen;
-    phdr.dataLength = datalen;
-
-    int totallen = sizeof(phdr) + headerlen + datalen;
-
-    Mutex_Lock(mutex);
-    for (int i = 0; i < 16; i++)
-    {
-        if (!(recv_mask & (1 << i)))
-            continue;
+    PacketRing::Slot* slot = packetRing->BeginWrite();
 
-        PacketQueue* queue = packetQueues[i].get();
+    slot->Header.magic = kPacketMagic;
+    slot->Header.senderID = sender;
+    slot->Header.headerLength = headerlen;
+    slot->Header.dataLength = datalen;
 
-        // if we run out of space: discard old packets
-        while (!queue->CanFit(totallen))
-        {
-            PacketHeader tmp;
-            queue->Read(&tmp, sizeof(tmp));
-            queue->Skip(tmp.headerLength + tmp.dataLength);
-        }
+    if (headerlen) memcpy(slot->Data, header, headerlen);
+    if (datalen) memcpy(&slot->Data[headerlen], data, datalen);
 
-        queue->Write(&phdr, sizeof(phdr));
-        if (headerlen) queue->Write(header, headerlen);
-        if (datalen) queue->Write(data, datalen);
-    }
-    Mutex_Unlock(mutex);
+    // if a receiver falls behind by a whole ring, it loses the packets it hadn't read yet
+    packetRing->EndWrite(slot, recv_mask);
 }
 
 bool PacketDispatcher::recvPacket(void *header, int *headerlen, void *data, int *datalen, int receiver)
@@ -125,36 +90,32 @@ bool PacketDispatcher::recvPacket(void *header, int *headerlen, void *data, int
     if ((!header) && (!data)) return false;
     if (receiver < 0 || receiver > 15) return false;
 
-    Mutex_Lock(mutex);
-    PacketQueue* queue = packetQueues[receiver].get();
-
-    PacketHeader phdr;
-    if (!queue->Read(&phdr, sizeof(phdr)))
-    {
-        Mutex_Unlock(mutex);
+    const PacketRing::Slot* slot = packetRing->Peek(receiver);
+    if (!slot)
         return false;
-    }
 
+    PacketHeader phdr = slot->Header;
     if (phdr.magic != kPacketMagic)
     {
-        Mutex_Unlock(mutex);
+        packetRing->Pop(receiver, slot);
         return false;
     }
 
     if (phdr.headerLength)
     {
         if (headerlen) *headerlen = phdr.headerLength;
-        if (header) queue->Read(header, phdr.headerLength);
-        else queue->Skip(phdr.headerLength);
+        if (header) memcpy(header, slot->Data, phdr.headerLength);
     }
 
     if (phdr.dataLength)
     {
         if (datalen) *datalen = phdr.dataLength;
-        if (data) queue->Read(data, phdr.dataLength);
-        else queue->Skip(phdr.dataLength);
+        if (data) memcpy(data, &slot->Data[phdr.headerLength], phdr.dataLength);
     }
 
-    Mutex_Unlock(mutex);
+    // the packet was overwritten while it was being read
+    if (!packetRing->Pop(receiver, slot))
+        return false;
+
     return true;
 }
@@ -19,13 +19,18 @@
 #ifndef PACKETDISPATCHER_H
 #define PACKETDISPATCHER_H
 
-#include <array>
+#include <atomic>
 #include <memory>
-#include "Platform.h"
 #include "types.h"
-#include "FIFO.h"
+#include "BroadcastRing.h"
 
-using PacketQueue = melonDS::RingBuffer<0x8000>;
+struct PacketHeader
+{
+    melonDS::u32 magic;
+    melonDS::u32 senderID;
+    melonDS::u32 headerLength;
+    melonDS::u32 dataLength;
+};
 
 class PacketDispatcher
 {
@@ -42,9 +47,13 @@ public:
     bool recvPacket(void* header, int* headerlen, void* data, int* datalen, int receiver);
 
 private:
-    melonDS::Platform::Mutex* mutex;
-    melonDS::u16 instanceMask;
-    std::array<std::unique_ptr<PacketQueue>, 16> packetQueues {};
+    // packets are written once, for all the instances they're for
+    // header and data are stored one after the other
+    // the ring holds 64 packets of up to 2K each, where every instance used to have a 32K queue
+    using PacketRing = melonDS::BroadcastRing<PacketHeader, 0x800, 64>;
+
+    std::atomic<melonDS::u16> instanceMask;
+    std::unique_ptr<PacketRing> packetRing;
 };
 
 #endif // PACKETDISPATCHER_H
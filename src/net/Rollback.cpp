@@ -0,0 +1,267 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <algorithm>
+
+#include "NDS.h"
+#include "Savestate.h"
+#include "Platform.h"
+#include "Rollback.h"
+
+using namespace melonDS;
+using Platform::Log;
+using Platform::LogLevel;
+
+namespace Netplay
+{
+
+static bool SameInput(const InputFrame& a, const InputFrame& b)
+{
+    if (a.KeyMask != b.KeyMask) return false;
+    if (a.Touching != b.Touching) return false;
+    if (a.Touching && (a.TouchX != b.TouchX || a.TouchY != b.TouchY)) return false;
+    return true;
+}
+
+
+RollbackSession::RollbackSession(melonDS::NDS& nds, int maxframes) noexcept : NDS(nds)
+{
+    MaxFrames = std::clamp(maxframes, 1, kMaxFrames);
+
+    for (auto& snap : Snapshots)
+        snap.Valid = false;
+
+    for (int i = 0; i < kInputRingSize; i++)
+        InputValid[i] = false;
+
+    // until some input has been received, predict no keys pressed
+    ConfirmedFrame = NDS.NumFrames;
+    LastConfirmedInput.FrameNum = ConfirmedFrame;
+    LastConfirmedInput.KeyMask = 0xFFF;
+    LastConfirmedInput.Touching = 0;
+    LastConfirmedInput.TouchX = 0;
+    LastConfirmedInput.TouchY = 0;
+}
+
+RollbackSession::~RollbackSession() noexcept = default;
+
+void RollbackSession::AddInput(const InputFrame& frame) noexcept
+{
+    u32 framenum = frame.FrameNum;
+    u32 curframe = NDS.NumFrames;
+
+    if ((s32)(framenum - ConfirmedFrame) < 0)
+        return; // already have it
+
+    // the input ring has to keep the input for every frame that may be run again
+    u32 oldest = std::min(ConfirmedFrame, curframe) - (kMaxFrames + 1);
+    if ((framenum - oldest) >= kInputRingSize)
+    {
+        Log(LogLevel::Warn, "Netplay: input for frame %u is too far ahead, dropped\n", framenum);
+        return;
+    }
+
+    int slot = framenum % kInputRingSize;
+    Inputs[slot] = frame;
+    InputValid[slot] = true;
+
+    // if this frame was already run, check that the prediction was right
+    if ((s32)(framenum - curframe) < 0)
+    {
+        const Snapshot& snap = Snapshots[framenum % (MaxFrames + 1)];
+        if (snap.Valid && snap.Input.FrameNum == framenum && !SameInput(snap.Input, frame))
+        {
+            if ((!RollbackPending) || ((s32)(framenum - RollbackFrame) < 0))
+                RollbackFrame = framenum;
+            RollbackPending = true;
+        }
+    }
+
+    for (;;)
+    {
+        int cslot = ConfirmedFrame % kInputRingSize;
+        if (!InputValid[cslot] || Inputs[cslot].FrameNum != ConfirmedFrame)
+            break;
+
+        LastConfirmedInput = Inputs[cslot];
+        ConfirmedFrame++;
+    }
+}
+
+bool RollbackSession::CanRunFrame() const noexcept
+{
+    // every predicted frame needs a snapshot to go back to
+    return (s32)(NDS.NumFrames - ConfirmedFrame) < MaxFrames;
+}
+
+bool RollbackSession::IsStateFinal() const noexcept
+{
+    return (!RollbackPending) && ((s32)(NDS.NumFrames - ConfirmedFrame) <= 0);
+}
+
+bool RollbackSession::RunFrame() noexcept
+{
+    if (RollbackPending)
+    {
+        if (!Resimulate())
+            return false;
+    }
+
+    if (!CanRunFrame())
+        return false;
+
+    return RunOneFrame(true);
+}
+
+InputFrame RollbackSession::GetInput(u32 framenum) const noexcept
+{
+    int slot = framenum % kInputRingSize;
+    if (InputValid[slot] && Inputs[slot].FrameNum == framenum)
+        return Inputs[slot];
+
+    // predict: the remote player keeps doing what they were doing
+    InputFrame ret = LastConfirmedInput;
+    ret.FrameNum = framenum;
+    return ret;
+}
+
+bool RollbackSession::MeasureSnapshot(Snapshot& snap) noexcept
+{
+    // save into a growable buffer to find out how big the state is
+    // then snapshot buffers are sized after that, instead of the default savestate size
+    Savestate state;
+    if (state.Error)
+        return false;
+
+    NDS.DoSavestate(&state);
+    state.Finish();
+    if (state.Error)
+        return false;
+
+    SnapshotSize = std::max(SnapshotSize, state.Length() + kSnapshotSlack);
+
+    const u8* data = (const u8*)state.Buffer();
+    snap.Data.reserve(SnapshotSize);
+    snap.Data.assign(data, data + state.Length());
+    snap.Data.resize(SnapshotSize);
+    snap.Length = state.Length();
+    return true;
+}
+
+bool RollbackSession::SaveSnapshot(Snapshot& snap) noexcept
+{
+    snap.Valid = false;
+
+    // snapshot buffers are allocated once and reused, the state is saved straight into them
+    // if it doesn't fit anymore, it's measured again
+    if (SnapshotSize != 0)
+    {
+        if (snap.Data.size() < SnapshotSize)
+            snap.Data.resize(SnapshotSize);
+
+        Savestate state(snap.Data.data(), snap.Data.size(), true);
+        NDS.DoSavestate(&state);
+        state.Finish();
+
+        if (!state.Error)
+        {
+            snap.Length = state.Length();
+            snap.Valid = true;
+            return true;
+        }
+
+        Log(LogLevel::Debug, "Netplay: rollback snapshot outgrew its %u-byte buffer\n", SnapshotSize);
+    }
+
+    snap.Valid = MeasureSnapshot(snap);
+    return snap.Valid;
+}
+
+bool RollbackSession::RunOneFrame(bool savestate) noexcept
+{
+    u32 framenum = NDS.NumFrames;
+    Snapshot& snap = Snapshots[framenum % (MaxFrames + 1)];
+
+    if (savestate && !SaveSnapshot(snap))
+    {
+        Log(LogLevel::Error, "Netplay: failed to save rollback snapshot for frame %u\n", framenum);
+        return false;
+    }
+
+    InputFrame input = GetInput(framenum);
+    snap.Input = input;
+
+    NDS.SetKeyMask(input.KeyMask);
+    if (input.Touching)
+        NDS.TouchScreen(input.TouchX, input.TouchY);
+    else
+        NDS.ReleaseScreen();
+
+    NDS.RunFrame();
+    return true;
+}
+
+bool RollbackSession::Resimulate() noexcept
+{
+    RollbackPending = false;
+
+    u32 endframe = NDS.NumFrames;
+    Snapshot& snap = Snapshots[RollbackFrame % (MaxFrames + 1)];
+    if (!snap.Valid || snap.Input.FrameNum != RollbackFrame)
+    {
+        Log(LogLevel::Error, "Netplay: no snapshot to roll back to frame %u\n", RollbackFrame);
+        return false;
+    }
+
+    Savestate state(snap.Data.data(), snap.Length, false);
+    if (state.Error || !NDS.DoSavestate(&state) || state.Error)
+    {
+        Log(LogLevel::Error, "Netplay: failed to load rollback snapshot for frame %u\n", RollbackFrame);
+        return false;
+    }
+
+    NumRollbacks++;
+
+    // the frames being caught up on aren't shown or heard
+    // the last one is rendered normally, since the 3D scene it renders is shown next
+    u32 frameskip = NDS.GetFrameSkip();
+    bool audioout = NDS.SPU.IsOutputEnabled();
+    NDS.SetFrameSkip(0xFFFFFFFF);
+    NDS.SPU.SetOutputEnabled(false);
+
+    bool ret = true;
+    while (NDS.NumFrames != endframe)
+    {
+        if ((NDS.NumFrames + 1) == endframe)
+            NDS.SetFrameSkip(frameskip);
+
+        // the snapshot for the frame that was rolled back to is the one just loaded
+        if (!RunOneFrame(NDS.NumFrames != RollbackFrame))
+        {
+            ret = false;
+            break;
+        }
+        NumResimulatedFrames++;
+    }
+
+    NDS.SetFrameSkip(frameskip);
+    NDS.SPU.SetOutputEnabled(audioout);
+    return ret;
+}
+
+}
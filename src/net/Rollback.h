@@ -0,0 +1,118 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <vector>
+
+#include "types.h"
+
+namespace melonDS
+{
+class NDS;
+class Savestate;
+}
+
+namespace Netplay
+{
+
+struct InputFrame
+{
+    melonDS::u32 FrameNum;
+    melonDS::u32 KeyMask;
+    melonDS::u32 Touching;
+    melonDS::u32 TouchX, TouchY;
+};
+
+// rollback mode: instead of waiting for input that hasn't arrived yet, the last known input
+// is repeated, and the console state is saved in memory before every frame
+// when input arrives that doesn't match what was predicted, the console is taken back
+// to that frame, and the frames since are run again with rendering and audio output left out
+class RollbackSession
+{
+public:
+    static constexpr int kMaxFrames = 15;
+
+    RollbackSession(melonDS::NDS& nds, int maxframes) noexcept;
+    RollbackSession(const RollbackSession&) = delete;
+    RollbackSession& operator=(const RollbackSession&) = delete;
+    ~RollbackSession() noexcept;
+
+    // input for a given frame, local or received from the network
+    // if that frame was already run with a different prediction, a rollback is scheduled
+    void AddInput(const InputFrame& frame) noexcept;
+
+    // false if running another frame would predict more frames than can be rolled back
+    // (the caller should wait for input instead)
+    bool CanRunFrame() const noexcept;
+
+    // runs the pending rollback if there is one, then the current frame
+    // returns false if no frame was run
+    bool RunFrame() noexcept;
+
+    // all frames before this one have confirmed input
+    melonDS::u32 GetConfirmedFrame() const noexcept { return ConfirmedFrame; }
+
+    // true if the current state didn't come from predicted input
+    bool IsStateFinal() const noexcept;
+
+    melonDS::u32 GetNumRollbacks() const noexcept { return NumRollbacks; }
+    melonDS::u32 GetNumResimulatedFrames() const noexcept { return NumResimulatedFrames; }
+
+private:
+    static constexpr int kInputRingSize = 64;
+
+    // room left in snapshot buffers past the largest state seen, so the state can grow a bit
+    static constexpr melonDS::u32 kSnapshotSlack = 64 * 1024;
+
+    struct Snapshot
+    {
+        std::vector<melonDS::u8> Data;
+        melonDS::u32 Length; // of the state in Data
+        InputFrame Input; // input the frame was run with
+        bool Valid;
+    };
+
+    bool Resimulate() noexcept;
+    bool RunOneFrame(bool savestate) noexcept;
+    bool SaveSnapshot(Snapshot& snap) noexcept;
+    bool MeasureSnapshot(Snapshot& snap) noexcept;
+    InputFrame GetInput(melonDS::u32 framenum) const noexcept;
+
+    melonDS::NDS& NDS;
+    int MaxFrames;
+
+    Snapshot Snapshots[kMaxFrames + 1];
+    melonDS::u32 SnapshotSize = 0; // buffer size for snapshots, 0 until a state was measured
+
+    InputFrame Inputs[kInputRingSize];
+    bool InputValid[kInputRingSize];
+    InputFrame LastConfirmedInput;
+    melonDS::u32 ConfirmedFrame;
+
+    bool RollbackPending = false;
+    melonDS::u32 RollbackFrame = 0;
+
+    melonDS::u32 NumRollbacks = 0;
+    melonDS::u32 NumResimulatedFrames = 0;
+};
+
+}
+
+#endif // ROLLBACK_H
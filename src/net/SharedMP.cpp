@@ -0,0 +1,605 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#ifndef __WIN32__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "SharedMP.h"
+#include "BroadcastRing.h"
+#include "Platform.h"
+
+using namespace melonDS;
+using namespace melonDS::Platform;
+
+using Platform::Log;
+using Platform::LogLevel;
+
+namespace melonDS
+{
+
+// the segment layout is only compatible between identical builds
+// bump the version whenever it changes
+const char* const kSegmentName = "/melonDS-mp-2";
+const u32 kSegmentMagic = 0x504D4853;
+
+// which process is alive and using what is tracked with record locks on the segment file,
+// which the system drops when the process dies, whatever PID namespace it is in:
+// - the setup lock is held while the segment is being set up
+// - every process using the segment holds a read lock on the attach byte
+// - every slot in use is write-locked by the process using it
+const off_t kLockSetup = 0;
+const off_t kLockAttach = 1;
+const off_t kLockSlot = 2;
+
+#ifdef F_OFD_SETLK
+// these belong to the file descriptor rather than the process
+const int kSetLock = F_OFD_SETLK;
+const int kSetLockWait = F_OFD_SETLKW;
+#else
+const int kSetLock = F_SETLK;
+const int kSetLockWait = F_SETLKW;
+#endif
+
+using PacketRing = BroadcastRing<MPPacketHeader, kMaxFrameSize, 64, true>;
+using ReplyRing = BroadcastRing<MPPacketHeader, kMaxFrameSize, 32, true>;
+
+static_assert(std::atomic<u64>::is_always_lock_free, "shared memory atomics need to be lock-free");
+static_assert(sizeof(std::atomic<u32>) == sizeof(u32), "futexes need plain 32-bit words");
+
+struct SharedMP::WakeCounter
+{
+    std::atomic<u32> Seq;
+    std::atomic<u32> Waiters;
+};
+
+// everything starts out zeroed, which is a valid state for everything but the rings
+struct SharedMP::Segment
+{
+    u32 Magic;
+    u32 Size;
+
+    std::atomic<u16> ConnectedBitmask;
+    std::atomic<u16> MPHostInst;
+    std::atomic<u32> Owners[kMaxInstances]; // ID of the process using each slot, 0 if free
+
+    WakeCounter PacketWake[kMaxInstances];
+    WakeCounter ReplyWake[kMaxInstances];
+
+    PacketRing Packets;
+    ReplyRing Replies;
+};
+
+
+#ifndef __WIN32__
+static bool LockByte(int fd, int cmd, short type, off_t pos)
+{
+    struct flock fl = {};
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = pos;
+    fl.l_len = 1;
+
+    while (fcntl(fd, cmd, &fl) < 0)
+    {
+        if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+#endif
+
+
+static void Wake(std::atomic<u32>& seq, std::atomic<u32>& waiters)
+{
+    seq.fetch_add(1);
+
+#ifdef __linux__
+    // the syscall is only needed if someone is asleep
+    if (waiters.load())
+        syscall(SYS_futex, reinterpret_cast<u32*>(&seq), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+// waits until the counter has moved on from the given value, for at most the given time in milliseconds
+static void WaitForWake(std::atomic<u32>& seq, std::atomic<u32>& waiters, u32 value, int timeout)
+{
+#ifdef __linux__
+    waiters.fetch_add(1);
+    if (seq.load() == value)
+    {
+        struct timespec ts;
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+        syscall(SYS_futex, reinterpret_cast<u32*>(&seq), FUTEX_WAIT, value, &ts, nullptr, 0);
+    }
+    waiters.fetch_sub(1);
+#else
+    for (int i = 0; (i < timeout * 10) && (seq.load() == value); i++)
+        Platform::Sleep(100);
+#endif
+}
+
+
+SharedMP::SharedMP() noexcept : SharedMP(kSegmentName)
+{
+}
+
+SharedMP::SharedMP(const char* segmentname) noexcept
+{
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        SlotID[i] = -1;
+        LastHostID[i] = -1;
+    }
+
+#ifdef __WIN32__
+    Log(LogLevel::Error, "MP: shared memory comm is not supported on this platform\n");
+#else
+    int fd = shm_open(segmentname, O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+    {
+        Log(LogLevel::Error, "MP: failed to open shared memory segment %s (errno %d)\n", segmentname, errno);
+        return;
+    }
+
+    if (!LockByte(fd, kSetLockWait, F_WRLCK, kLockSetup))
+    {
+        Log(LogLevel::Error, "MP: failed to lock shared memory segment (errno %d)\n", errno);
+        close(fd);
+        return;
+    }
+
+    // if nobody else is using the segment, it is set up from scratch
+    // so whatever a process that died left in it is gone
+    bool alone = LockByte(fd, kSetLock, F_WRLCK, kLockAttach);
+
+    struct stat st;
+    if (alone)
+    {
+        // truncating it and sizing it back up zero-fills it
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, sizeof(Segment)) < 0)
+        {
+            Log(LogLevel::Error, "MP: failed to set up shared memory segment (errno %d)\n", errno);
+            close(fd);
+            return;
+        }
+    }
+    else if (fstat(fd, &st) < 0 || st.st_size != sizeof(Segment))
+    {
+        Log(LogLevel::Error, "MP: shared memory segment %s is from an incompatible build\n", segmentname);
+        close(fd);
+        return;
+    }
+
+    void* mem = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        Log(LogLevel::Error, "MP: failed to map shared memory segment (errno %d)\n", errno);
+        close(fd);
+        return;
+    }
+
+    Segment* seg = (Segment*)mem;
+
+    if (alone)
+    {
+        new (&seg->Packets) PacketRing();
+        new (&seg->Replies) ReplyRing();
+        seg->Magic = kSegmentMagic;
+        seg->Size = sizeof(Segment);
+    }
+
+    if (seg->Magic != kSegmentMagic || seg->Size != sizeof(Segment) ||
+        !LockByte(fd, kSetLockWait, F_RDLCK, kLockAttach))
+    {
+        Log(LogLevel::Error, "MP: shared memory segment %s is not usable\n", segmentname);
+        munmap(mem, sizeof(Segment));
+        close(fd);
+        return;
+    }
+
+    LockByte(fd, kSetLock, F_UNLCK, kLockSetup);
+
+    Shared = seg;
+    SegmentFD = fd;
+    FreeDeadSlots();
+
+    Log(LogLevel::Info, "MP comm init OK (shared memory)\n");
+#endif
+}
+
+SharedMP::~SharedMP() noexcept
+{
+#ifndef __WIN32__
+    if (!Shared) return;
+
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        if (SlotID[i] != -1)
+            End(i);
+    }
+
+    // the segment itself is left in place for the other processes, and for the next run
+    // closing it drops all our locks
+    munmap(Shared, sizeof(Segment));
+    close(SegmentFD);
+    Shared = nullptr;
+    SegmentFD = -1;
+#endif
+}
+
+bool SharedMP::IsOwnSlot(int slot) const noexcept
+{
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        if (SlotID[i] == slot)
+            return true;
+    }
+    return false;
+}
+
+void SharedMP::FreeDeadSlots() noexcept
+{
+#ifndef __WIN32__
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        u32 owner = Shared->Owners[i].load();
+        if (!owner) continue;
+
+        // our own locks never get in our way, so they can't be checked that way
+        if (IsOwnSlot(i)) continue;
+
+        // getting the lock means the process that had it is gone
+        if (!LockByte(SegmentFD, kSetLock, F_WRLCK, kLockSlot + i)) continue;
+
+        Log(LogLevel::Info, "MP: freeing slot %d, left behind by process %u\n", i, owner);
+        Shared->ConnectedBitmask.fetch_and(~(1 << i));
+        Shared->Owners[i].compare_exchange_strong(owner, 0);
+
+        LockByte(SegmentFD, kSetLock, F_UNLCK, kLockSlot + i);
+    }
+#endif
+}
+
+void SharedMP::Process()
+{
+    if (!Shared) return;
+
+    // catch processes that went away without ending their comm
+    if (++ProcessFrames >= 60)
+    {
+        ProcessFrames = 0;
+        FreeDeadSlots();
+    }
+}
+
+void SharedMP::Begin(int inst)
+{
+#ifndef __WIN32__
+    if (!Shared) return;
+    if (SlotID[inst] != -1)
+        End(inst);
+
+    u32 pid = (u32)getpid();
+    int slot = -1;
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        if (IsOwnSlot(i)) continue;
+
+        // the lock is held for as long as the slot is in use
+        if (!LockByte(SegmentFD, kSetLock, F_WRLCK, kLockSlot + i)) continue;
+
+        u32 owner = Shared->Owners[i].load();
+        if (owner)
+        {
+            Log(LogLevel::Info, "MP: reusing slot %d, left behind by process %u\n", i, owner);
+            Shared->ConnectedBitmask.fetch_and(~(1 << i));
+        }
+
+        Shared->Owners[i].store(pid);
+        slot = i;
+        break;
+    }
+
+    if (slot == -1)
+    {
+        Log(LogLevel::Warn, "MP: no free slot in shared memory segment\n");
+        return;
+    }
+
+    SlotID[inst] = slot;
+    LastHostID[inst] = -1;
+
+    Shared->Packets.Reset(slot);
+    Shared->Replies.Reset(slot);
+    Shared->ConnectedBitmask.fetch_or(1 << slot);
+#endif
+}
+
+void SharedMP::End(int inst)
+{
+    if (!Shared) return;
+
+    int slot = SlotID[inst];
+    if (slot == -1) return;
+
+    Shared->ConnectedBitmask.fetch_and(~(1 << slot));
+    Shared->Owners[slot].store(0);
+    SlotID[inst] = -1;
+
+#ifndef __WIN32__
+    LockByte(SegmentFD, kSetLock, F_UNLCK, kLockSlot + slot);
+#endif
+}
+
+int SharedMP::SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 timestamp) noexcept
+{
+    if (!Shared) return 0;
+
+    int self = SlotID[inst];
+    if (self == -1) return 0;
+
+    if (len > kMaxFrameSize)
+    {
+        Log(LogLevel::Warn, "wifi: attempting to send frame too big (len=%d max=%d)\n", len, kMaxFrameSize);
+        return 0;
+    }
+
+    u16 mask = Shared->ConnectedBitmask.load();
+
+    MPPacketHeader pktheader;
+    pktheader.Magic = 0x4946494E;
+    pktheader.SenderID = self;
+    pktheader.Type = type;
+    pktheader.Length = len;
+    pktheader.Timestamp = timestamp;
+
+    type &= 0xFFFF;
+
+    if (type == 2)
+    {
+        u16 host = Shared->MPHostInst.load();
+
+        ReplyRing::Slot* frame = Shared->Replies.BeginWrite();
+        if (!frame)
+        {
+            Log(LogLevel::Warn, "MP: reply dropped, the reply ring was stuck\n");
+            return 0;
+        }
+
+        frame->Header = pktheader;
+        if (len) memcpy(frame->Data, packet, len);
+        if (!Shared->Replies.EndWrite(frame, 1 << host))
+            return 0;
+
+        Wake(Shared->ReplyWake[host].Seq, Shared->ReplyWake[host].Waiters);
+        return len;
+    }
+
+    if (type == 1)
+    {
+        // leftover replies are dropped before the CMD goes out, so none of the new ones are
+        Shared->MPHostInst.store(self);
+        Shared->Replies.Reset(self);
+    }
+
+    mask &= ~(1 << self);
+
+    PacketRing::Slot* frame = Shared->Packets.BeginWrite();
+    if (!frame)
+    {
+        Log(LogLevel::Warn, "MP: packet dropped, the packet ring was stuck\n");
+        return 0;
+    }
+
+    frame->Header = pktheader;
+    if (len) memcpy(frame->Data, packet, len);
+    if (!Shared->Packets.EndWrite(frame, mask))
+        return 0;
+
+    for (int i = 0; i < kMaxInstances; i++)
+    {
+        if (mask & (1<<i))
+            Wake(Shared->PacketWake[i].Seq, Shared->PacketWake[i].Waiters);
+    }
+
+    return len;
+}
+
+int SharedMP::RecvPacketGeneric(int inst, u8* packet, bool block, u64* timestamp) noexcept
+{
+    if (!Shared) return 0;
+
+    int self = SlotID[inst];
+    if (self == -1) return 0;
+
+    WakeCounter& wake = Shared->PacketWake[self];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RecvTimeout);
+
+    for (;;)
+    {
+        // read the counter first, so nothing sent after the check below is slept through
+        u32 seq = wake.Seq.load();
+
+        bool overrun;
+        const PacketRing::Slot* frame = Shared->Packets.Peek(self, &overrun);
+        if (frame)
+        {
+            MPPacketHeader pktheader = frame->Header;
+            if (pktheader.Length)
+                memcpy(packet, frame->Data, pktheader.Length);
+
+            if (Shared->Packets.Pop(self, frame))
+            {
+                if (pktheader.Length && pktheader.Type == 1)
+                    LastHostID[inst] = pktheader.SenderID;
+
+                if (timestamp) *timestamp = pktheader.Timestamp;
+                return pktheader.Length;
+            }
+
+            overrun = true;
+        }
+
+        if (overrun)
+        {
+            Log(LogLevel::Warn, "PACKET FIFO OVERFLOW\n");
+            return 0;
+        }
+
+        if (!block) return 0;
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) return 0;
+
+        WaitForWake(wake.Seq, wake.Waiters, seq, remaining.count());
+    }
+}
+
+int SharedMP::SendPacket(int inst, u8* packet, int len, u64 timestamp)
+{
+    return SendPacketGeneric(inst, 0, packet, len, timestamp);
+}
+
+int SharedMP::RecvPacket(int inst, u8* packet, u64* timestamp)
+{
+    return RecvPacketGeneric(inst, packet, false, timestamp);
+}
+
+int SharedMP::SendCmd(int inst, u8* packet, int len, u64 timestamp)
+{
+    return SendPacketGeneric(inst, 1, packet, len, timestamp);
+}
+
+int SharedMP::SendReply(int inst, u8* packet, int len, u64 timestamp, u16 aid)
+{
+    return SendPacketGeneric(inst, 2 | (aid<<16), packet, len, timestamp);
+}
+
+int SharedMP::SendAck(int inst, u8* packet, int len, u64 timestamp)
+{
+    return SendPacketGeneric(inst, 3, packet, len, timestamp);
+}
+
+int SharedMP::RecvHostPacket(int inst, u8* packet, u64* timestamp)
+{
+    if (!Shared) return 0;
+
+    int host = LastHostID[inst];
+    if (host != -1)
+    {
+        // check if the host is still connected
+        if (!(Shared->ConnectedBitmask.load() & (1 << host)))
+            return -1;
+    }
+
+    return RecvPacketGeneric(inst, packet, true, timestamp);
+}
+
+u16 SharedMP::RecvReplies(int inst, u8* packets, u64 timestamp, u16 aidmask)
+{
+    if (!Shared) return 0;
+
+    int self = SlotID[inst];
+    if (self == -1) return 0;
+
+    u16 ret = 0;
+    u16 myinstmask = (1 << self);
+    u16 curinstmask = Shared->ConnectedBitmask.load();
+
+    // if all clients have left: return early
+    if ((myinstmask & curinstmask) == curinstmask)
+        return 0;
+
+    WakeCounter& wake = Shared->ReplyWake[self];
+
+    for (;;)
+    {
+        u32 seq = wake.Seq.load();
+
+        bool overrun;
+        const ReplyRing::Slot* frame = Shared->Replies.Peek(self, &overrun);
+        if (!frame)
+        {
+            if (overrun)
+            {
+                Log(LogLevel::Warn, "REPLY FIFO OVERFLOW\n");
+                return 0;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            WaitForWake(wake.Seq, wake.Waiters, seq, RecvTimeout);
+
+            // no more replies available
+            if (wake.Seq.load() == seq &&
+                (std::chrono::steady_clock::now() - start) >= std::chrono::milliseconds(RecvTimeout))
+                return ret;
+
+            continue;
+        }
+
+        MPPacketHeader pktheader = frame->Header;
+
+        if ((pktheader.SenderID == (u32)self) || // packet we sent out (shouldn't happen, but hey)
+            (pktheader.Timestamp < (timestamp - 32))) // stale packet
+        {
+            // skip this packet
+            Shared->Replies.Pop(self, frame);
+            continue;
+        }
+
+        if (pktheader.Length)
+        {
+            u32 aid = (pktheader.Type >> 16);
+            memcpy(&packets[(aid-1)*1024], frame->Data, pktheader.Length);
+            ret |= (1 << aid);
+        }
+
+        if (!Shared->Replies.Pop(self, frame))
+        {
+            Log(LogLevel::Warn, "REPLY FIFO OVERFLOW\n");
+            return 0;
+        }
+
+        myinstmask |= (1 << pktheader.SenderID);
+        if (((myinstmask & curinstmask) == curinstmask) ||
+            ((ret & aidmask) == aidmask))
+        {
+            // all the clients have sent their reply
+            return ret;
+        }
+    }
+}
+
+}
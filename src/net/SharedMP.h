@@ -0,0 +1,85 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef SHAREDMP_H
+#define SHAREDMP_H
+
+#include "types.h"
+#include "MPInterface.h"
+#include "LocalMP.h"
+
+namespace melonDS
+{
+
+// local MP between separate processes on the same machine
+//
+// works like LocalMP, with the packet rings in a POSIX shared memory segment that all
+// the processes map. every instance gets a slot in the segment when it starts wifi comm;
+// slots left behind by processes that died are freed up again, and the segment is set up
+// anew whenever a process finds it is the only one using it.
+// waiting for packets is done with futexes on Linux, by polling elsewhere.
+// not available on Windows.
+class SharedMP : public MPInterface
+{
+public:
+    SharedMP() noexcept;
+    // uses the given shared memory segment instead of the default one
+    explicit SharedMP(const char* segmentname) noexcept;
+    SharedMP(const SharedMP&) = delete;
+    SharedMP& operator=(const SharedMP&) = delete;
+    SharedMP(SharedMP&& other) = delete;
+    SharedMP& operator=(SharedMP&& other) = delete;
+    ~SharedMP() noexcept;
+
+    // false if the shared memory segment couldn't be set up
+    bool IsOpen() const noexcept { return Shared != nullptr; }
+
+    void Process();
+
+    void Begin(int inst);
+    void End(int inst);
+
+    int SendPacket(int inst, u8* data, int len, u64 timestamp);
+    int RecvPacket(int inst, u8* data, u64* timestamp);
+    int SendCmd(int inst, u8* data, int len, u64 timestamp);
+    int SendReply(int inst, u8* data, int len, u64 timestamp, u16 aid);
+    int SendAck(int inst, u8* data, int len, u64 timestamp);
+    int RecvHostPacket(int inst, u8* data, u64* timestamp);
+    u16 RecvReplies(int inst, u8* data, u64 timestamp, u16 aidmask);
+
+private:
+    struct Segment;
+    struct WakeCounter;
+
+    static constexpr int kMaxInstances = 16;
+
+    bool IsOwnSlot(int slot) const noexcept;
+    void FreeDeadSlots() noexcept;
+    int SendPacketGeneric(int inst, u32 type, u8* packet, int len, u64 timestamp) noexcept;
+    int RecvPacketGeneric(int inst, u8* packet, bool block, u64* timestamp) noexcept;
+
+    Segment* Shared = nullptr;
+    int SegmentFD = -1;
+    int SlotID[kMaxInstances]; // slot in the segment of each local instance, -1 if none
+    int LastHostID[kMaxInstances];
+    u32 ProcessFrames = 0;
+};
+
+}
+
+#endif // SHAREDMP_H
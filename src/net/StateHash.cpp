@@ -0,0 +1,228 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <algorithm>
+#include <string.h>
+
+#include "NDS.h"
+#include "Platform.h"
+#include "StateHash.h"
+
+using namespace melonDS;
+using Platform::Log;
+using Platform::LogLevel;
+
+namespace Netplay
+{
+
+const u64 kPrime1 = 0x9E3779B185EBCA87ULL;
+const u64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const u64 kPrime3 = 0x165667B19E3779F9ULL;
+
+static inline u64 Rotl(u64 val, int shift)
+{
+    return (val << shift) | (val >> (64 - shift));
+}
+
+static inline u64 Read64(const u8* data)
+{
+    u64 ret;
+    memcpy(&ret, data, 8);
+    return ret;
+}
+
+// 64-bit hash going over four independent lanes, so it runs at memory speed
+// (the hashes are only compared between machines of the same endianness)
+static u64 HashBytes(const u8* data, u32 len)
+{
+    u64 acc[4] = {kPrime1 + kPrime2, kPrime2, 0, -kPrime1};
+
+    u32 i = 0;
+    for (; (i + 32) <= len; i += 32)
+    {
+        for (int l = 0; l < 4; l++)
+            acc[l] = Rotl(acc[l] + Read64(&data[i + l*8]) * kPrime2, 31) * kPrime1;
+    }
+
+    u64 hash = Rotl(acc[0], 1) + Rotl(acc[1], 7) + Rotl(acc[2], 12) + Rotl(acc[3], 18);
+    hash += len;
+
+    for (; (i + 8) <= len; i += 8)
+        hash = Rotl(hash ^ (Rotl(Read64(&data[i]) * kPrime2, 31) * kPrime1), 27) * kPrime1 + kPrime3;
+
+    for (; i < len; i++)
+        hash = Rotl(hash ^ (data[i] * kPrime3), 11) * kPrime1;
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+
+StateHasher::StateHasher(melonDS::NDS& nds, u32 chunksize) noexcept : NDS(nds)
+{
+    ChunkSize = std::max(chunksize, 0x1000u);
+
+    for (int i = 0; i < kHistorySize; i++)
+    {
+        LocalValid[i] = false;
+        RemoteValid[i] = false;
+    }
+
+    AddRegion(StateRegion_MainRAM, 0, NDS.MainRAM, NDS.MainRAMMask + 1);
+    AddRegion(StateRegion_SharedWRAM, 0, NDS.SharedWRAM, NDS.SharedWRAMSize);
+    AddRegion(StateRegion_ARM7WRAM, 0, NDS.ARM7WRAM, NDS.ARM7WRAMSize);
+
+    u32 offset = 0;
+    for (int i = 0; i < 9; i++)
+    {
+        u32 len = NDS.GPU.VRAMMask[i] + 1;
+        AddRegion(StateRegion_VRAM, offset, NDS.GPU.VRAM[i], len);
+        offset += len;
+    }
+
+    AddRegion(StateRegion_Palette, 0, NDS.GPU.Palette, sizeof(NDS.GPU.Palette));
+    AddRegion(StateRegion_Palette, sizeof(NDS.GPU.Palette), NDS.GPU.OAM, sizeof(NDS.GPU.OAM));
+}
+
+StateHasher::~StateHasher() noexcept = default;
+
+void StateHasher::AddRegion(StateRegion region, u32 offset, const u8* data, u32 len) noexcept
+{
+    for (u32 pos = 0; pos < len; pos += ChunkSize)
+    {
+        Chunk chunk;
+        chunk.Region = region;
+        chunk.Offset = offset + pos;
+        chunk.Data = &data[pos];
+        chunk.Length = std::min(ChunkSize, len - pos);
+        Chunks.push_back(chunk);
+    }
+}
+
+u64 StateHasher::HashCPU() const noexcept
+{
+    // every byte of the buffer has to be filled, anything left over would hash whatever was on the stack
+    constexpr u32 kRegsSize = sizeof(ARM::R) + sizeof(ARM::CPSR) + sizeof(ARM::R_FIQ) +
+        sizeof(ARM::R_SVC) + sizeof(ARM::R_ABT) + sizeof(ARM::R_IRQ) + sizeof(ARM::R_UND);
+    u8 regs[2][kRegsSize];
+
+    const ARM* cpus[2] = {&NDS.ARM9, &NDS.ARM7};
+    for (int c = 0; c < 2; c++)
+    {
+        const ARM* cpu = cpus[c];
+        u8* dst = regs[c];
+
+        memcpy(dst, cpu->R, sizeof(cpu->R)); dst += sizeof(cpu->R);
+        memcpy(dst, &cpu->CPSR, sizeof(cpu->CPSR)); dst += sizeof(cpu->CPSR);
+        memcpy(dst, cpu->R_FIQ, sizeof(cpu->R_FIQ)); dst += sizeof(cpu->R_FIQ);
+        memcpy(dst, cpu->R_SVC, sizeof(cpu->R_SVC)); dst += sizeof(cpu->R_SVC);
+        memcpy(dst, cpu->R_ABT, sizeof(cpu->R_ABT)); dst += sizeof(cpu->R_ABT);
+        memcpy(dst, cpu->R_IRQ, sizeof(cpu->R_IRQ)); dst += sizeof(cpu->R_IRQ);
+        memcpy(dst, cpu->R_UND, sizeof(cpu->R_UND));
+    }
+
+    return HashBytes(&regs[0][0], sizeof(regs));
+}
+
+StateHash StateHasher::Update() noexcept
+{
+    StateHash ret;
+    ret.FrameNum = NDS.NumFrames;
+    ret.Chunk = ret.FrameNum % Chunks.size();
+
+    const Chunk& chunk = Chunks[ret.Chunk];
+    ret.MemHash = HashBytes(chunk.Data, chunk.Length);
+    ret.CPUHash = HashCPU();
+
+    int slot = ret.FrameNum % kHistorySize;
+    Local[slot] = ret;
+    LocalValid[slot] = true;
+
+    Compare(ret.FrameNum);
+    return ret;
+}
+
+void StateHasher::AddRemoteHash(const StateHash& hash) noexcept
+{
+    int slot = hash.FrameNum % kHistorySize;
+    Remote[slot] = hash;
+    RemoteValid[slot] = true;
+
+    Compare(hash.FrameNum);
+}
+
+void StateHasher::Compare(u32 framenum) noexcept
+{
+    int slot = framenum % kHistorySize;
+    if (!LocalValid[slot] || !RemoteValid[slot])
+        return;
+
+    const StateHash& local = Local[slot];
+    const StateHash& remote = Remote[slot];
+    if (local.FrameNum != remote.FrameNum)
+        return;
+
+    if (local.MemHash == remote.MemHash && local.CPUHash == remote.CPUHash)
+        return;
+
+    // only the earliest desync is worth anything, everything after it follows from it
+    if (Desynced && (s32)(framenum - FirstDesync.FrameNum) >= 0)
+        return;
+
+    FirstDesync.FrameNum = framenum;
+    if (local.Chunk != remote.Chunk || local.Chunk >= Chunks.size())
+    {
+        // not even hashing the same thing: the consoles aren't set up the same way
+        FirstDesync.Region = StateRegion_MainRAM;
+        FirstDesync.Offset = 0;
+        FirstDesync.Length = NDS.MainRAMMask + 1;
+    }
+    else if (local.MemHash != remote.MemHash)
+    {
+        const Chunk& chunk = Chunks[local.Chunk];
+        FirstDesync.Region = chunk.Region;
+        FirstDesync.Offset = chunk.Offset;
+        FirstDesync.Length = chunk.Length;
+    }
+    else
+    {
+        FirstDesync.Region = StateRegion_CPU;
+        FirstDesync.Offset = 0;
+        FirstDesync.Length = 0;
+    }
+
+    if (!Desynced)
+        Log(LogLevel::Warn, "Netplay: desync at frame %u (region %d, %08X+%X)\n",
+            framenum, FirstDesync.Region, FirstDesync.Offset, FirstDesync.Length);
+    Desynced = true;
+}
+
+bool StateHasher::GetDesync(StateDesync& desync) const noexcept
+{
+    if (!Desynced)
+        return false;
+
+    desync = FirstDesync;
+    return true;
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include <vector>
+
+#include "types.h"
+
+namespace melonDS
+{
+class NDS;
+}
+
+namespace Netplay
+{
+
+enum StateRegion
+{
+    StateRegion_MainRAM,
+    StateRegion_SharedWRAM,
+    StateRegion_ARM7WRAM,
+    StateRegion_VRAM,       // banks A to I, one after the other
+    StateRegion_Palette,    // palettes, then OAM
+    StateRegion_CPU,
+};
+
+// hash of the console state at the start of a given frame
+// the memory hash only covers one chunk of memory, the CPU hash covers the registers of both CPUs
+struct StateHash
+{
+    melonDS::u32 FrameNum;
+    melonDS::u32 Chunk;
+    melonDS::u64 MemHash;
+    melonDS::u64 CPUHash;
+};
+
+struct StateDesync
+{
+    melonDS::u32 FrameNum;
+    StateRegion Region;
+    melonDS::u32 Offset, Length; // part of the region that differs, nothing for the CPU
+};
+
+// desync detection: every frame, one chunk of the console memory is hashed along with
+// the CPU registers, going over all of it every few seconds
+// which chunk is hashed depends on the frame number only, so two consoles that are
+// in sync come up with the same hashes for the same frames
+//
+// the hashes are sent along with the input, and the first one that doesn't match
+// says which frame and which part of the state went wrong, so that just that part
+// can be sent over again
+class StateHasher
+{
+public:
+    StateHasher(melonDS::NDS& nds, melonDS::u32 chunksize = kDefaultChunkSize) noexcept;
+    StateHasher(const StateHasher&) = delete;
+    StateHasher& operator=(const StateHasher&) = delete;
+    ~StateHasher() noexcept;
+
+    // hashes the current state, to be called between frames
+    StateHash Update() noexcept;
+
+    // hash received from the other side, checked against ours for the same frame
+    void AddRemoteHash(const StateHash& hash) noexcept;
+
+    // the first frame where the hashes didn't match, if any
+    bool GetDesync(StateDesync& desync) const noexcept;
+    void ClearDesync() noexcept { Desynced = false; }
+
+    melonDS::u32 GetNumChunks() const noexcept { return Chunks.size(); }
+
+private:
+    static constexpr melonDS::u32 kDefaultChunkSize = 0x10000;
+    static constexpr int kHistorySize = 256;
+
+    struct Chunk
+    {
+        StateRegion Region;
+        melonDS::u32 Offset;
+        const melonDS::u8* Data;
+        melonDS::u32 Length;
+    };
+
+    void AddRegion(StateRegion region, melonDS::u32 offset, const melonDS::u8* data, melonDS::u32 len) noexcept;
+    melonDS::u64 HashCPU() const noexcept;
+    void Compare(melonDS::u32 framenum) noexcept;
+
+    melonDS::NDS& NDS;
+    melonDS::u32 ChunkSize;
+    std::vector<Chunk> Chunks;
+
+    StateHash Local[kHistorySize];
+    StateHash Remote[kHistorySize];
+    bool LocalValid[kHistorySize];
+    bool RemoteValid[kHistorySize];
+
+    bool Desynced = false;
+    StateDesync FirstDesync;
+};
+
+}
+
+#endif // STATEHASH_H
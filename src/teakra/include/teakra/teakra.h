@@ -78,6 +78,7 @@ public:
 
     // core
     void Run(unsigned cycle);
+    void InvalidateProgramCache();
 
     void SetSharedMemoryCallback(const SharedMemoryCallback& callback);
     void SetAHBMCallback(const AHBMCallback& callback);
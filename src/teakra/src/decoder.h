@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <bitset>
+#include <memory>
 #include <type_traits>
 #include <vector>
 #include "crash.h"
@@ -61,22 +64,23 @@ struct MatcherCreator {
 
     template <typename... OperandAtTs>
     struct Proxy<OperandList<OperandAtTs...>> {
-        F func;
-        auto operator()(V& visitor, [[maybe_unused]] u16 opcode,
-                        [[maybe_unused]] u16 expansion) const {
+        template <F func>
+        static typename V::instruction_return_type Call(V& visitor, [[maybe_unused]] u16 opcode,
+                                                        [[maybe_unused]] u16 expansion) {
             return (visitor.*func)(OperandAtTs::Extract(opcode, expansion)...);
         }
     };
 
-    static Matcher<V> Create(const char* name, F func) {
+    template <F func>
+    static Matcher<V> Create(const char* name) {
         // Operands shouldn't overlap each other, nor overlap with the expected ones
         static_assert(NoOverlap<u16, expected, OperandAtT::Mask...>, "Error");
 
-        Proxy<typename FilterOperand<OperandAtT...>::result> proxy{func};
+        using ProxyT = Proxy<typename FilterOperand<OperandAtT...>::result>;
 
         constexpr u16 mask = (~OperandAtT::Mask & ... & 0xFFFF);
         constexpr bool expanded = (OperandAtT::NeedExpansion || ...);
-        return Matcher<V>(name, mask, expected, expanded, proxy);
+        return Matcher<V>(name, mask, expected, expanded, &ProxyT::template Call<func>);
     }
 };
 
@@ -91,7 +95,7 @@ template <typename V>
 std::vector<Matcher<V>> GetDecodeTable() {
     return {
 
-#define INST(name, ...) MatcherCreator<V, __VA_ARGS__>::Create(#name, &V::name)
+#define INST(name, ...) MatcherCreator<V, __VA_ARGS__>::template Create<&V::name>(#name)
 #define EXCEPT(...) Except(RejectorCreator<__VA_ARGS__>::rejector)
 
     // <<< Misc >>>
@@ -711,12 +715,26 @@ Matcher<V> Decode(u16 instruction) {
     }
 }
 
+// Flat per-opcode dispatch table: one plain handler pointer and one expansion bit per opcode, so
+// the interpreter loop doesn't have to go through a full Matcher for every instruction.
 template <typename V>
-std::vector<Matcher<V>> GetDecoderTable() {
-    std::vector<Matcher<V>> table;
-    table.reserve(0x10000);
-    for (u32 i = 0; i < 0x10000; ++i) {
-        table.push_back(Decode<V>((u16)i));
-    }
-    return table;
+struct DecoderTable {
+    using handler_function = typename Matcher<V>::handler_function;
+
+    std::array<handler_function, 0x10000> handlers;
+    std::bitset<0x10000> expanded;
+};
+
+template <typename V>
+const DecoderTable<V>& GetDecoderTable() {
+    static const auto table = [] {
+        auto result = std::make_unique<DecoderTable<V>>();
+        for (u32 i = 0; i < 0x10000; ++i) {
+            auto matcher = Decode<V>((u16)i);
+            result->handlers[i] = matcher.GetHandler();
+            result->expanded[i] = matcher.NeedExpansion();
+        }
+        return result;
+    }();
+    return *table;
 }
@@ -12,6 +12,7 @@
 #include "decoder.h"
 #include "memory_interface.h"
 #include "operand.h"
+#include "program_cache.h"
 #include "register.h"
 #include "../../Savestate.h"
 
@@ -37,6 +38,15 @@ public:
         vinterrupt_address = 0;
 
         idle = false;
+
+        program_cache.InvalidateAll();
+    }
+
+    void InvalidateProgram(u32 address) {
+        program_cache.Invalidate(address);
+    }
+    void InvalidateProgramCache() {
+        program_cache.InvalidateAll();
     }
 
     void DoSavestate(melonDS::Savestate* file) {
@@ -55,6 +65,8 @@ public:
             file->Bool32(&tmpb); vinterrupt_pending = tmpb;
             file->Bool32(&tmpb); vinterrupt_context_switch = tmpb;
             file->Var32(&tmp32); vinterrupt_address = tmp32;
+
+            program_cache.InvalidateAll();
         }
 
         file->Bool32(&idle);
@@ -89,6 +101,12 @@ public:
         regs.pc = new_pc;
     }
 
+    const auto& FetchInstruction() {
+        const auto& inst = program_cache.Fetch(regs.pc | (regs.prpage << 18));
+        regs.pc += inst.expanded ? 2 : 1;
+        return inst;
+    }
+
     void undefined(u16 opcode) {
         UNREACHABLE();
     }
@@ -117,12 +135,8 @@ public:
                 regs.ipv = 1;
             }
 
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            }
+            // copied, as the instruction may invalidate its own cache entry
+            const auto inst = FetchInstruction();
 
             if (regs.rep) {
                 if (regs.repc == 0) {
@@ -143,7 +157,7 @@ public:
                 }
             }
 
-            decoder.call(*this, opcode, expand_value);
+            inst.handler(*this, inst.opcode, inst.expansion);
 
             // I am not sure if a single-instruction loop is interruptable and how it is handled,
             // so just disable interrupt for it for now.
@@ -1218,14 +1232,9 @@ public:
         // retd is supposed to kick in after 2 cycles
 
         for (int i = 0; i < 2; i++) {
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            }
+            const auto inst = FetchInstruction();
 
-            decoder.call(*this, opcode, expand_value);
+            inst.handler(*this, inst.opcode, inst.expansion);
         }
 
         PopPC();
@@ -3675,7 +3684,8 @@ private:
         return map.at(in);
     }
 
-    const std::vector<Matcher<Interpreter>> decoders = GetDecoderTable<Interpreter>();
+    const DecoderTable<Interpreter>& decoders = GetDecoderTable<Interpreter>();
+    ProgramCache<Interpreter> program_cache{mem, decoders};
 };
 
 } // namespace Teakra
@@ -39,4 +39,11 @@ void Processor::SignalVectoredInterrupt(u32 address, bool context_switch) {
     impl->interpreter.SignalVectoredInterrupt(address, context_switch);
 }
 
+void Processor::InvalidateProgram(u32 address) {
+    impl->interpreter.InvalidateProgram(address);
+}
+void Processor::InvalidateProgramCache() {
+    impl->interpreter.InvalidateProgramCache();
+}
+
 } // namespace Teakra
@@ -17,6 +17,8 @@ public:
     void Run(unsigned cycles);
     void SignalInterrupt(u32 i);
     void SignalVectoredInterrupt(u32 address, bool context_switch);
+    void InvalidateProgram(u32 address);
+    void InvalidateProgramCache();
 
 private:
     struct Impl;
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <memory>
+#include "common_types.h"
+#include "decoder.h"
+#include "memory_interface.h"
+
+namespace Teakra {
+
+// Decoded instruction cache for program memory. Every cached word holds the handler for the
+// instruction starting at it, along with its opcode and expansion word, so loops run without
+// going back through the shared memory callbacks and the decoder on every iteration.
+// Program memory doesn't change behind the DSP's back except through ProgramWrite or the host
+// remapping its memory, both of which have to invalidate the cache.
+template <typename V>
+class ProgramCache {
+public:
+    using handler_function = typename DecoderTable<V>::handler_function;
+
+    struct Entry {
+        handler_function handler; // nullptr if not decoded yet
+        u16 opcode;
+        u16 expansion;
+        bool expanded;
+    };
+
+    ProgramCache(MemoryInterface& mem, const DecoderTable<V>& decoders)
+        : mem(mem), decoders(decoders) {}
+
+    const Entry& Fetch(u32 address) {
+        // only the first 128K words are cached: the upper half of the program address space
+        // reads data memory, which the DSP can write to freely
+        // (the last cached word is left out so expansion words never cross into it)
+        if (address >= CachedWords - 1) {
+            Decode(uncached, address);
+            return uncached;
+        }
+
+        auto& page = pages[address >> PageBits];
+        if (!page)
+            page = std::make_unique<Page>();
+
+        Entry& entry = (*page)[address & PageMask];
+        if (!entry.handler)
+            Decode(entry, address);
+        return entry;
+    }
+
+    void Invalidate(u32 address) {
+        // the written word may also be the expansion of the previous instruction
+        InvalidateEntry(address);
+        InvalidateEntry(address - 1);
+    }
+
+    void InvalidateAll() {
+        for (auto& page : pages)
+            page.reset();
+    }
+
+private:
+    static constexpr u32 CachedWords = 0x20000;
+    static constexpr u32 PageBits = 8;
+    static constexpr u32 PageMask = (1 << PageBits) - 1;
+
+    using Page = std::array<Entry, 1 << PageBits>;
+
+    void Decode(Entry& entry, u32 address) {
+        entry.opcode = mem.ProgramRead(address);
+        entry.expanded = decoders.expanded[entry.opcode];
+        entry.expansion = entry.expanded ? mem.ProgramRead(address + 1) : 0;
+        entry.handler = decoders.handlers[entry.opcode];
+    }
+
+    void InvalidateEntry(u32 address) {
+        if (address >= CachedWords)
+            return;
+        auto& page = pages[address >> PageBits];
+        if (page)
+            (*page)[address & PageMask].handler = nullptr;
+    }
+
+    MemoryInterface& mem;
+    const DecoderTable<V>& decoders;
+    std::array<std::unique_ptr<Page>, (CachedWords >> PageBits)> pages;
+    Entry uncached{};
+};
+
+} // namespace Teakra
@@ -47,6 +47,9 @@ struct Teakra::Impl {
         btdmp[1].SetInterruptHandler([this]() { icu.TriggerSingle(0xC); });
 
         dma.SetInterruptHandler([this]() { icu.TriggerSingle(0xF); });
+
+        memory_interface.SetProgramWriteHandler(
+            std::bind(&Processor::InvalidateProgram, &processor, _1));
     }
 
     void Reset() {
@@ -93,6 +96,10 @@ void Teakra::Run(unsigned cycle) {
     impl->processor.Run(cycle);
 }
 
+void Teakra::InvalidateProgramCache() {
+    impl->processor.InvalidateProgramCache();
+}
+
 void Teakra::SampleClock(std::int16_t output[2], std::int16_t input) {
     impl->btdmp[0].SampleClock(output, input);
 }
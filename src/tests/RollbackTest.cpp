@@ -0,0 +1,171 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// checks that a console run through a rollback session, with its input arriving late,
+// ends up in the same state as one that was run with all of its input known up front
+
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "NDS.h"
+#include "Savestate.h"
+#include "Rollback.h"
+
+using namespace melonDS;
+using namespace Netplay;
+
+static int Failures = 0;
+
+static void Check(bool cond, const char* what)
+{
+    if (cond) return;
+
+    printf("FAILED: %s\n", what);
+    Failures++;
+}
+
+static u32 RandState;
+static u32 Random()
+{
+    RandState = RandState * 1103515245 + 12345;
+    return RandState >> 8;
+}
+
+// a console with the sound channels playing noise, so that there's state changing every frame
+static std::unique_ptr<NDS> CreateConsole()
+{
+    NDSArgs args;
+    args.JIT = std::nullopt;
+    auto console = std::make_unique<NDS>(std::move(args));
+    NDS& nds = *console;
+    nds.Reset();
+    nds.Start();
+
+    RandState = 777;
+    for (u32 addr = 0; addr < 0x40000; addr += 4)
+        nds.ARM7Write32(0x02000000 + addr, Random());
+
+    nds.ARM7IOWrite16(0x04000304, 0x0001);
+    nds.ARM7IOWrite32(0x04000500, 0x807F);
+    for (int ch = 0; ch < 16; ch++)
+    {
+        u32 base = 0x04000400 + ch*16;
+        nds.ARM7IOWrite32(base+0x4, 0x02000000 + ch*0x4000);
+        nds.ARM7IOWrite16(base+0x8, 0x10000 - 200 - ch*37);
+        nds.ARM7IOWrite32(base+0xC, 0x800);
+        nds.ARM7IOWrite32(base, 0x40 | (ch*7 << 16) | (1u << 27) | (1u << 31) | ((ch % 3) << 29));
+    }
+
+    // the ARM9 keeps folding the keys into a word of main RAM, so that the state depends on all the input
+    const u32 code[] =
+    {
+        0xE1D430B0, // ldrh r3, [r4]
+        0xE0855285, // add r5, r5, r5, lsl #5
+        0xE0855003, // add r5, r5, r3
+        0xE5815000, // str r5, [r1]
+        0xEAFFFFFA, // b 0
+    };
+    for (u32 i = 0; i < sizeof(code)/sizeof(code[0]); i++)
+        nds.ARM9Write32(0x02300000 + i*4, code[i]);
+
+    nds.ARM9.R[1] = 0x02200000;
+    nds.ARM9.R[4] = 0x04000130;
+    nds.ARM9.JumpTo(0x02300000);
+    nds.ARM7.Halt(1);
+    return console;
+}
+
+static std::vector<u8> SaveState(NDS& nds)
+{
+    Savestate state;
+    nds.DoSavestate(&state);
+    state.Finish();
+
+    const u8* buf = (const u8*)state.Buffer();
+    return std::vector<u8>(buf, buf + state.Length());
+}
+
+int main()
+{
+    const int numframes = 120;
+    const int delay = 4;
+
+    // the key mask changes every now and then, so that some predictions are wrong
+    std::vector<InputFrame> inputs(numframes + 1);
+    RandState = 1234;
+    u32 keymask = 0xFFF;
+    for (int i = 0; i <= numframes; i++)
+    {
+        if ((i % 23) == 0)
+            keymask = Random() & 0xFFF;
+        inputs[i] = {(u32)i, keymask, 0, 0, 0};
+    }
+
+    auto reference = CreateConsole();
+    u32 base = reference->NumFrames;
+    for (int i = 0; i <= numframes; i++)
+    {
+        reference->SetKeyMask(inputs[i].KeyMask);
+        reference->RunFrame();
+    }
+
+    auto mirror = CreateConsole();
+    Check(mirror->NumFrames == base, "both consoles start at the same frame");
+
+    RollbackSession session(*mirror, 8);
+    for (int tick = 0; (mirror->NumFrames - base) < (u32)numframes; tick++)
+    {
+        // the input for each frame only arrives a few frames later
+        if (tick >= delay && (tick - delay) < numframes)
+        {
+            InputFrame input = inputs[tick - delay];
+            input.FrameNum += base;
+            session.AddInput(input);
+        }
+
+        session.RunFrame();
+    }
+
+    // the rest of the input arrives, and the next frame resolves the last rollback
+    for (int i = 0; i <= numframes; i++)
+    {
+        InputFrame input = inputs[i];
+        input.FrameNum += base;
+        session.AddInput(input);
+    }
+    session.RunFrame();
+
+    Check(session.GetNumRollbacks() > 0, "some frames were rolled back");
+    Check(session.IsStateFinal(), "the state is final once all input is in");
+    Check(mirror->NumFrames == reference->NumFrames, "both consoles are at the same frame");
+
+    std::vector<u8> refstate = SaveState(*reference);
+    std::vector<u8> mirrorstate = SaveState(*mirror);
+    Check(refstate.size() == mirrorstate.size() &&
+          memcmp(refstate.data(), mirrorstate.data(), refstate.size()) == 0,
+          "same state as with all input known up front");
+
+    if (Failures)
+        return 1;
+
+    printf("rollback tests passed (%u rollbacks, %u frames run again)\n",
+           session.GetNumRollbacks(), session.GetNumResimulatedFrames());
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// runs a host and a few clients as separate processes over the shared memory MP
+// transport, and checks that the slots of processes that died get reused
+
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "SharedMP.h"
+
+using namespace melonDS;
+
+static int Failures = 0;
+
+static void Check(bool cond, const char* what)
+{
+    if (cond) return;
+
+    printf("FAILED: %s\n", what);
+    Failures++;
+}
+
+static char SegmentName[64];
+
+const int kNumClients = 3;
+const int kNumRounds = 200;
+const int kRecvTimeout = 2000;
+const int kCmdLen = 100;
+const int kReplyLen = 32;
+const int kDoneLen = 4;
+
+static void SignalReady(int fd)
+{
+    u8 ready = 1;
+    if (write(fd, &ready, 1) != 1)
+        _exit(1);
+}
+
+static bool WaitReady(int fd, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        u8 ready;
+        if (read(fd, &ready, 1) != 1)
+            return false;
+    }
+
+    return true;
+}
+
+// answers every CMD with a reply filled with the CMD's first byte, until the host says it's done
+static int RunClient(u16 aid, int readyfd)
+{
+    SharedMP mp(SegmentName);
+    if (!mp.IsOpen())
+        return 1;
+
+    mp.SetRecvTimeout(kRecvTimeout);
+    mp.Begin(0);
+    SignalReady(readyfd);
+
+    u8 packet[0x1000];
+    int timeouts = 0;
+    for (;;)
+    {
+        u64 timestamp;
+        int len = mp.RecvHostPacket(0, packet, &timestamp);
+        if (len < 0)
+            return 1;
+        if (len == 0)
+        {
+            if (++timeouts > 10) return 1;
+            continue;
+        }
+        if (len == kDoneLen)
+            break;
+
+        timeouts = 0;
+        u8 reply[kReplyLen];
+        memset(reply, packet[0], sizeof(reply));
+        if (mp.SendReply(0, reply, sizeof(reply), timestamp, aid) != sizeof(reply))
+            return 1;
+    }
+
+    mp.End(0);
+    return 0;
+}
+
+// the host sends CMDs, and each round has to get a reply from every client
+// without running into the receive timeout, ie. without waiting for a slot nobody answers for
+static void RunExchange(SharedMP& host, const char* phase)
+{
+    char what[128];
+
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        Check(false, "creating the pipe");
+        return;
+    }
+
+    host.SetRecvTimeout(kRecvTimeout);
+    host.Begin(0);
+
+    pid_t clients[kNumClients];
+    for (int i = 0; i < kNumClients; i++)
+    {
+        clients[i] = fork();
+        if (clients[i] == 0)
+        {
+            close(fds[0]);
+            _exit(RunClient(i + 1, fds[1]));
+        }
+    }
+    close(fds[1]);
+
+    snprintf(what, sizeof(what), "%s: all clients joined", phase);
+    Check(WaitReady(fds[0], kNumClients), what);
+    close(fds[0]);
+
+    // stops at the first round that goes wrong, as the rest would all wait out the timeout
+    int badrounds = 0, slowrounds = 0;
+    for (int round = 1; round <= kNumRounds && !badrounds && !slowrounds; round++)
+    {
+        u64 timestamp = round * 1000;
+        u8 cmd[kCmdLen];
+        memset(cmd, round & 0xFF, sizeof(cmd));
+        if (host.SendCmd(0, cmd, sizeof(cmd), timestamp) != sizeof(cmd))
+        {
+            badrounds++;
+            continue;
+        }
+
+        static u8 replies[15 * 1024];
+        memset(replies, 0, sizeof(replies));
+
+        auto start = std::chrono::steady_clock::now();
+        u16 got = host.RecvReplies(0, replies, timestamp, 0xFFFF);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed >= std::chrono::milliseconds(kRecvTimeout))
+            slowrounds++;
+
+        bool ok = (got == (((1 << kNumClients) - 1) << 1));
+        for (int aid = 1; aid <= kNumClients && ok; aid++)
+        {
+            const u8* reply = &replies[(aid-1) * 1024];
+            for (int i = 0; i < kReplyLen; i++)
+                ok = ok && (reply[i] == (round & 0xFF));
+        }
+        if (!ok) badrounds++;
+    }
+
+    snprintf(what, sizeof(what), "%s: every client replied to every CMD", phase);
+    Check(badrounds == 0, what);
+    snprintf(what, sizeof(what), "%s: no round waited out the receive timeout", phase);
+    Check(slowrounds == 0, what);
+
+    u8 done[kDoneLen] = {0};
+    host.SendPacket(0, done, sizeof(done), 0);
+
+    int clientfailures = 0;
+    for (int i = 0; i < kNumClients; i++)
+    {
+        int status;
+        if (waitpid(clients[i], &status, 0) != clients[i] ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            clientfailures++;
+    }
+    snprintf(what, sizeof(what), "%s: all clients finished cleanly", phase);
+    Check(clientfailures == 0, what);
+
+    host.End(0);
+}
+
+// fills every slot with a process that then gets killed, without ever leaving
+static void KillSlotHolders()
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        Check(false, "creating the pipe");
+        return;
+    }
+
+    pid_t holders[16];
+    for (int i = 0; i < 16; i++)
+    {
+        holders[i] = fork();
+        if (holders[i] == 0)
+        {
+            close(fds[0]);
+            SharedMP mp(SegmentName);
+            if (!mp.IsOpen())
+                _exit(1);
+
+            mp.Begin(0);
+            SignalReady(fds[1]);
+            for (;;) pause();
+        }
+    }
+    close(fds[1]);
+
+    Check(WaitReady(fds[0], 16), "all slots were taken");
+    close(fds[0]);
+
+    for (int i = 0; i < 16; i++)
+    {
+        kill(holders[i], SIGKILL);
+        waitpid(holders[i], nullptr, 0);
+    }
+}
+
+int main()
+{
+    snprintf(SegmentName, sizeof(SegmentName), "/melonDS-mp-test-%d", (int)getpid());
+    shm_unlink(SegmentName);
+
+    {
+        // stays attached throughout, so that the segment isn't set up anew between the phases
+        SharedMP host(SegmentName);
+        Check(host.IsOpen(), "segment opened");
+
+        if (host.IsOpen())
+        {
+            RunExchange(host, "fresh segment");
+
+            KillSlotHolders();
+            RunExchange(host, "after killing all slot holders");
+        }
+    }
+
+    shm_unlink(SegmentName);
+
+    if (Failures)
+        return 1;
+
+    printf("shared MP tests passed\n");
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// checks that hashing the same console state always gives the same hash,
+// whatever was on the stack before, and that a difference does show up as a desync
+
+#include <memory>
+#include <stdio.h>
+
+#include "NDS.h"
+#include "StateHash.h"
+
+using namespace melonDS;
+using namespace Netplay;
+
+static int Failures = 0;
+
+static void Check(bool cond, const char* what)
+{
+    if (cond) return;
+
+    printf("FAILED: %s\n", what);
+    Failures++;
+}
+
+static void FillStack(u8 val)
+{
+    volatile u8 buf[0x4000];
+    for (u32 i = 0; i < sizeof(buf); i++)
+        buf[i] = val;
+}
+
+// called through a pointer so it can't be inlined, and uses the stack the hasher will use next
+static void (*volatile FillStackFunc)(u8) = FillStack;
+
+int main()
+{
+    NDSArgs args;
+    args.JIT = std::nullopt;
+    auto console = std::make_unique<NDS>(std::move(args));
+    NDS& nds = *console;
+    nds.Reset();
+
+    StateHasher hasher1(nds);
+    StateHasher hasher2(nds);
+
+    FillStackFunc(0x00);
+    StateHash hash1 = hasher1.Update();
+    FillStackFunc(0xFF);
+    StateHash hash2 = hasher2.Update();
+
+    Check(hash1.FrameNum == hash2.FrameNum, "same frame number");
+    Check(hash1.Chunk == hash2.Chunk, "same chunk");
+    Check(hash1.MemHash == hash2.MemHash, "same memory hash");
+    Check(hash1.CPUHash == hash2.CPUHash, "same CPU hash");
+
+    StateDesync desync;
+    hasher1.AddRemoteHash(hash2);
+    Check(!hasher1.GetDesync(desync), "no desync for the same state");
+
+    // the first chunk is the start of main RAM
+    StateHasher hasher3(nds);
+    nds.MainRAM[0] ^= 0xFF;
+    StateHash hash3 = hasher3.Update();
+    nds.MainRAM[0] ^= 0xFF;
+
+    Check(hash3.MemHash != hash1.MemHash, "different memory hash for different RAM");
+    hasher3.AddRemoteHash(hash1);
+    Check(hasher3.GetDesync(desync) && desync.Region == StateRegion_MainRAM && desync.Offset == 0,
+          "desync found in main RAM");
+
+    StateHasher hasher4(nds);
+    nds.ARM9.R[0] ^= 1;
+    StateHash hash4 = hasher4.Update();
+    nds.ARM9.R[0] ^= 1;
+
+    Check(hash4.CPUHash != hash1.CPUHash, "different CPU hash for different registers");
+    hasher4.AddRemoteHash(hash1);
+    Check(hasher4.GetDesync(desync) && desync.Region == StateRegion_CPU, "desync found in the CPU state");
+
+    if (Failures)
+        return 1;
+
+    printf("state hash tests passed\n");
+    return 0;
+}
@@ -0,0 +1,234 @@
+/*
+    Copyright 2016-2026 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// minimal platform for the unit tests: files and threads go straight to the C and C++
+// standard libraries, everything a test doesn't need does nothing
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include "Platform.h"
+#include "SPI_Firmware.h"
+
+namespace melonDS::Platform
+{
+
+void SignalStop(StopReason reason, void* userdata) {}
+
+std::string GetLocalFilePath(const std::string& filename) { return filename; }
+
+FileHandle* OpenFile(const std::string& path, FileMode mode)
+{
+    const char* fmode;
+    if (mode & FileMode::Write)
+        fmode = (mode & FileMode::Read) ? "w+b" : "wb";
+    else
+        fmode = "rb";
+
+    return (FileHandle*)fopen(path.c_str(), fmode);
+}
+
+FileHandle* OpenLocalFile(const std::string& path, FileMode mode) { return OpenFile(path, mode); }
+
+bool FileExists(const std::string& name)
+{
+    FILE* f = fopen(name.c_str(), "rb");
+    if (!f) return false;
+    fclose(f);
+    return true;
+}
+
+bool LocalFileExists(const std::string& name) { return FileExists(name); }
+bool CheckFileWritable(const std::string& filepath) { return true; }
+bool CheckLocalFileWritable(const std::string& filepath) { return true; }
+bool CloseFile(FileHandle* file) { return fclose((FILE*)file) == 0; }
+bool IsEndOfFile(FileHandle* file) { return feof((FILE*)file) != 0; }
+bool FileReadLine(char* str, int count, FileHandle* file) { return fgets(str, count, (FILE*)file) != nullptr; }
+u64 FilePosition(FileHandle* file) { return ftell((FILE*)file); }
+
+bool FileSeek(FileHandle* file, s64 offset, FileSeekOrigin origin)
+{
+    int whence;
+    switch (origin)
+    {
+    case FileSeekOrigin::Start: whence = SEEK_SET; break;
+    case FileSeekOrigin::Current: whence = SEEK_CUR; break;
+    default: whence = SEEK_END; break;
+    }
+
+    return fseek((FILE*)file, offset, whence) == 0;
+}
+
+void FileRewind(FileHandle* file) { rewind((FILE*)file); }
+u64 FileRead(void* data, u64 size, u64 count, FileHandle* file) { return fread(data, size, count, (FILE*)file); }
+bool FileFlush(FileHandle* file) { return fflush((FILE*)file) == 0; }
+u64 FileWrite(const void* data, u64 size, u64 count, FileHandle* file) { return fwrite(data, size, count, (FILE*)file); }
+
+u64 FileWriteFormatted(FileHandle* file, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int ret = vfprintf((FILE*)file, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+u64 FileLength(FileHandle* file)
+{
+    long pos = ftell((FILE*)file);
+    fseek((FILE*)file, 0, SEEK_END);
+    long len = ftell((FILE*)file);
+    fseek((FILE*)file, pos, SEEK_SET);
+    return len;
+}
+
+void Log(LogLevel level, const char* fmt, ...)
+{
+    if (level < LogLevel::Warn) return;
+
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+struct Thread { std::thread Impl; };
+
+Thread* Thread_Create(std::function<void()> func)
+{
+    Thread* thread = new Thread;
+    thread->Impl = std::thread(func);
+    return thread;
+}
+
+void Thread_Free(Thread* thread)
+{
+    if (thread->Impl.joinable()) thread->Impl.detach();
+    delete thread;
+}
+
+void Thread_Wait(Thread* thread) { thread->Impl.join(); }
+
+struct Semaphore
+{
+    std::mutex Lock;
+    std::condition_variable Cond;
+    int Count = 0;
+};
+
+Semaphore* Semaphore_Create() { return new Semaphore; }
+void Semaphore_Free(Semaphore* sema) { delete sema; }
+
+void Semaphore_Reset(Semaphore* sema)
+{
+    std::lock_guard lock(sema->Lock);
+    sema->Count = 0;
+}
+
+void Semaphore_Wait(Semaphore* sema)
+{
+    std::unique_lock lock(sema->Lock);
+    sema->Cond.wait(lock, [&] { return sema->Count > 0; });
+    sema->Count--;
+}
+
+bool Semaphore_TryWait(Semaphore* sema, int timeout_ms)
+{
+    std::unique_lock lock(sema->Lock);
+    if (!sema->Cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] { return sema->Count > 0; }))
+        return false;
+    sema->Count--;
+    return true;
+}
+
+void Semaphore_Post(Semaphore* sema, int count)
+{
+    {
+        std::lock_guard lock(sema->Lock);
+        sema->Count += count;
+    }
+    sema->Cond.notify_all();
+}
+
+struct Mutex { std::mutex Impl; };
+
+Mutex* Mutex_Create() { return new Mutex; }
+void Mutex_Free(Mutex* mutex) { delete mutex; }
+void Mutex_Lock(Mutex* mutex) { mutex->Impl.lock(); }
+void Mutex_Unlock(Mutex* mutex) { mutex->Impl.unlock(); }
+bool Mutex_TryLock(Mutex* mutex) { return mutex->Impl.try_lock(); }
+
+void Sleep(u64 usecs) { std::this_thread::sleep_for(std::chrono::microseconds(usecs)); }
+
+u64 GetMSCount()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+u64 GetUSCount()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WriteNDSSave(const u8* savedata, u32 savelen, u32 writeoffset, u32 writelen, void* userdata) {}
+void WriteGBASave(const u8* savedata, u32 savelen, u32 writeoffset, u32 writelen, void* userdata) {}
+void WriteFirmware(const Firmware& firmware, u32 writeoffset, u32 writelen, void* userdata) {}
+void WriteDateTime(int year, int month, int day, int hour, int minute, int second, void* userdata) {}
+
+void MP_Begin(void* userdata) {}
+void MP_End(void* userdata) {}
+int MP_SendPacket(u8* data, int len, u64 timestamp, void* userdata) { return 0; }
+int MP_RecvPacket(u8* data, u64* timestamp, void* userdata) { return 0; }
+int MP_SendCmd(u8* data, int len, u64 timestamp, void* userdata) { return 0; }
+int MP_SendReply(u8* data, int len, u64 timestamp, u16 aid, void* userdata) { return 0; }
+int MP_SendAck(u8* data, int len, u64 timestamp, void* userdata) { return 0; }
+int MP_RecvHostPacket(u8* data, u64* timestamp, void* userdata) { return 0; }
+u16 MP_RecvReplies(u8* data, u64 timestamp, u16 aidmask, void* userdata) { return 0; }
+void MP_SetTime(u64 timestamp, void* userdata) {}
+
+int Net_SendPacket(u8* data, int len, void* userdata) { return 0; }
+int Net_RecvPacket(u8* data, void* userdata) { return 0; }
+
+void Camera_Start(int num, void* userdata) {}
+void Camera_Stop(int num, void* userdata) {}
+void Camera_CaptureFrame(int num, u32* frame, int width, int height, bool yuv, void* userdata) {}
+
+void Mic_Start(void* userdata) {}
+void Mic_Stop(void* userdata) {}
+int Mic_ReadInput(s16* data, int maxlength, void* userdata) { return 0; }
+
+AACDecoder* AAC_Init() { return nullptr; }
+void AAC_DeInit(AACDecoder* dec) {}
+bool AAC_Configure(AACDecoder* dec, int frequency, int channels) { return false; }
+bool AAC_DecodeFrame(AACDecoder* dec, const void* input, int inputlen, void* output, int outputlen) { return false; }
+
+bool Addon_KeyDown(KeyType type, void* userdata) { return false; }
+void Addon_RumbleStart(u32 len, void* userdata) {}
+void Addon_RumbleStop(void* userdata) {}
+float Addon_MotionQuery(MotionQueryType type, void* userdata) { return 0; }
+
+DynamicLibrary* DynamicLibrary_Load(const char* lib) { return nullptr; }
+void DynamicLibrary_Unload(DynamicLibrary* lib) {}
+void* DynamicLibrary_LoadFunction(DynamicLibrary* lib, const char* name) { return nullptr; }
+
+}